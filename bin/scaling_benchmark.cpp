@@ -0,0 +1,96 @@
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include "../lib/ConcurrentBST.hpp"
+#include "../lib/FineGrainedBST.hpp"
+
+constexpr size_t kOperations = 1 << 21;
+
+template <typename Tree>
+double Run(size_t threads) {
+  Tree tree;
+  std::vector<std::thread> workers;
+  auto start = std::chrono::steady_clock::now();
+
+  for (size_t t = 0; t < threads; ++t) {
+    workers.emplace_back([&tree, threads, t] {
+      std::mt19937_64 random(t);
+
+      for (size_t i = 0; i < kOperations / threads; ++i) {
+        uint64_t key = random() % (kOperations * 4);
+        switch (random() % 4) {
+          case 0:
+            tree.insert(key);
+            break;
+          case 1:
+            tree.erase(key);
+            break;
+          default:
+            tree.contains(key);
+        }
+      }
+    });
+  }
+
+  for (std::thread& worker : workers) {
+    worker.join();
+  }
+
+  std::chrono::duration<double> elapsed =
+      std::chrono::steady_clock::now() - start;
+
+  return kOperations / elapsed.count() / 1e6;
+}
+
+// Ingest: ids handed out by one shared counter, so every thread inserts at
+// the right edge of the tree.
+template <typename Tree>
+double RunAscending(size_t threads) {
+  Tree tree;
+  std::atomic<uint64_t> next_id = 0;
+  std::vector<std::thread> workers;
+  auto start = std::chrono::steady_clock::now();
+
+  for (size_t t = 0; t < threads; ++t) {
+    workers.emplace_back([&tree, &next_id] {
+      for (uint64_t id = next_id.fetch_add(1); id < kOperations;
+           id = next_id.fetch_add(1)) {
+        tree.insert(id);
+      }
+    });
+  }
+
+  for (std::thread& worker : workers) {
+    worker.join();
+  }
+
+  std::chrono::duration<double> elapsed =
+      std::chrono::steady_clock::now() - start;
+
+  return kOperations / elapsed.count() / 1e6;
+}
+
+int main() {
+  std::cout << "threads  ConcurrentBST  FineGrainedBST  (Mops/s)\n";
+
+  for (size_t threads = 1; threads <= 16; threads *= 2) {
+    std::cout << threads << '\t' << Run<ConcurrentBST<uint64_t>>(threads)
+              << '\t' << Run<FineGrainedBST<uint64_t>>(threads) << '\n';
+  }
+
+  std::cout << "\nascending ids\nthreads  ConcurrentBST  FineGrainedBST  "
+               "(Mops/s)\n";
+
+  for (size_t threads = 1; threads <= 16; threads *= 2) {
+    std::cout << threads << '\t'
+              << RunAscending<ConcurrentBST<uint64_t>>(threads) << '\t'
+              << RunAscending<FineGrainedBST<uint64_t>>(threads) << '\n';
+  }
+
+  return 0;
+}
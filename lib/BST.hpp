@@ -1,23 +1,30 @@
 #pragma once
-#include <sys/_types/_size_t.h>
-#include <sys/wait.h>
 
 #include <cstddef>
+#include <functional>
 #include <initializer_list>
 #include <iostream>
 #include <iterator>
+#include <limits>
 #include <locale>
 #include <memory>
+#include <memory_resource>
+#include <random>
+#include <span>
+#include <stdexcept>
+#include <type_traits>
 #include <utility>
+#include <vector>
 
+#include "FrozenBST.hpp"
+#include "NodePool.hpp"
+#include "PersistentBST.hpp"
 #include "Tree.hpp"
 
-enum class IteratorType { INORDER, POSTORDER, PREORDER };
-
-template <typename T, typename Allocator = std::allocator<Node<T>>>
+template <typename T, typename Allocator = std::allocator<Node<T>>,
+          typename Balance = Unbalanced, typename Compare = std::less<T>>
 class BST {
   friend Node<T>;
-  std::allocator<Node<T>> allocator_;
   typedef T value_type;
   typedef T& reference;
   typedef const T& const_reference;
@@ -27,14 +34,29 @@ class BST {
   typedef typename std::allocator_traits<Allocator>::pointer pointer;
   typedef
       typename std::allocator_traits<Allocator>::const_pointer const_pointer;
-  typedef Node<value_type>* node_type;
+  typedef Compare key_compare;
+  typedef Compare value_compare;
+  typedef Tree<value_type, Allocator, Balance, Compare> tree_type;
+  typedef typename tree_type::node_type tree_node;
 
 
 public:
+  typedef typename tree_type::node_handle node_type;
+
   template <IteratorType type>
   class const_iterator {
    public:
-    const_iterator(Node<value_type>* ptr);
+    typedef std::conditional_t<type == IteratorType::INORDER &&
+                                   Balance::kCounted,
+                               std::random_access_iterator_tag,
+                               std::bidirectional_iterator_tag>
+        iterator_category;
+    typedef T value_type;
+    typedef std::ptrdiff_t difference_type;
+    typedef const T* pointer;
+    typedef const T& reference;
+
+    const_iterator(tree_node* ptr, const tree_type* tree = nullptr);
     const_iterator(const const_iterator& other);
     const_iterator() = default;
 
@@ -46,6 +68,38 @@ public:
     const_iterator& operator--();
     const_iterator operator--(int);
 
+    const_iterator& operator+=(difference_type offset)
+      requires(type == IteratorType::INORDER);
+    const_iterator& operator-=(difference_type offset)
+      requires(type == IteratorType::INORDER);
+
+    const_iterator operator+(difference_type offset) const
+      requires(type == IteratorType::INORDER);
+    const_iterator operator-(difference_type offset) const
+      requires(type == IteratorType::INORDER);
+
+    difference_type operator-(const const_iterator& other) const
+      requires(type == IteratorType::INORDER);
+
+    friend const_iterator operator+(difference_type offset,
+                                    const const_iterator& it)
+      requires(type == IteratorType::INORDER)
+    {
+      return it + offset;
+    }
+
+    const value_type& operator[](difference_type offset) const
+      requires(type == IteratorType::INORDER);
+
+    bool operator<(const const_iterator& other) const
+      requires(type == IteratorType::INORDER);
+    bool operator>(const const_iterator& other) const
+      requires(type == IteratorType::INORDER);
+    bool operator<=(const const_iterator& other) const
+      requires(type == IteratorType::INORDER);
+    bool operator>=(const const_iterator& other) const
+      requires(type == IteratorType::INORDER);
+
     const_iterator& operator=(const const_iterator& other);
 
     const value_type& operator*();
@@ -54,7 +108,11 @@ public:
     bool operator==(const const_iterator& other) const;
 
    private:
-    const Node<T>* ptr_;
+    friend BST;
+
+    const tree_node* ptr_;
+    // Lets end() step back to the last node; nothing else needs it.
+    const tree_type* tree_ = nullptr;
   };
 
   template <typename It>
@@ -63,7 +121,7 @@ public:
     It current = It();
 
    public:
-    const_reverse_iterator(Node<value_type>* ptr);
+    const_reverse_iterator(tree_node* ptr);
     const_reverse_iterator(const const_reverse_iterator& other);
     const_reverse_iterator() = default;
 
@@ -84,11 +142,30 @@ public:
   };
 
  public:
-  BST() { tree_ = Tree<T, Allocator>(); }
+  BST() = default;
+  explicit BST(const Compare& compare) : tree_(compare) {}
+  explicit BST(const allocator_type& allocator)
+      : tree_(Compare(), tree_type::Rebind(allocator)) {}
+  BST(const Compare& compare, const allocator_type& allocator)
+      : tree_(compare, tree_type::Rebind(allocator)) {}
   BST(const BST& other);
-  BST(const std::initializer_list<value_type>& ilist);
+  BST(const BST& other, const allocator_type& allocator);
+  BST(BST&& other) noexcept(std::is_nothrow_move_constructible_v<tree_type>)
+      : tree_(std::move(other.tree_)) {}
+  BST(const std::initializer_list<value_type>& ilist,
+      const allocator_type& allocator = allocator_type());
+
+  template <class InputIt>
+  BST(InputIt first, InputIt last,
+      const allocator_type& allocator = allocator_type());
+
+  template <class InputIt>
+  BST(sorted_unique_t, InputIt first, InputIt last,
+      const allocator_type& allocator = allocator_type());
 
   BST& operator=(const BST& other);
+  BST& operator=(BST&& other) noexcept(
+      std::is_nothrow_move_assignable_v<tree_type>);
   BST& operator=(const std::initializer_list<value_type>& ilist);
 
   ~BST();
@@ -121,30 +198,63 @@ public:
 
   bool operator!=(const BST& second);
 
-  void swap(BST& other);
+  void swap(BST& other) noexcept;
+
+  friend void swap(BST& first, BST& second) noexcept { first.swap(second); }
 
-  std::allocator<Node<value_type>> get_allocator() { return this->tree_.get_allocator(); }
+  allocator_type get_allocator() const;
 
   size_type size();
   size_type max_size();
 
   bool empty();
 
-  void Insert(int value);
+  void reserve(size_type count);
 
-  void Remove(int value);
+  key_compare key_comp() const { return this->tree_.GetCompare(); }
+
+  value_compare value_comp() const { return this->tree_.GetCompare(); }
 
   template <IteratorType type>
   std::pair<const_iterator<type>, bool> insert(const value_type& value);
 
+  template <IteratorType type>
+  std::pair<const_iterator<type>, bool> insert(value_type&& value);
+
+  template <IteratorType type>
+  const_iterator<type> insert(const_iterator<type> hint,
+                              const value_type& value);
+
+  template <IteratorType type>
+  const_iterator<type> insert(const_iterator<type> hint, value_type&& value);
+
   template <class InputIt>
   void insert(InputIt first, InputIt last);
 
   void insert(std::initializer_list<value_type> ilist);
 
+  template <class InputIt>
+  void assign(InputIt first, InputIt last);
+
+  template <class InputIt>
+  void assign(sorted_unique_t, InputIt first, InputIt last);
+
   template <IteratorType type, typename... Args>
   std::pair<const_iterator<type>, bool> emplace(Args&&... args);
 
+  template <IteratorType type, typename... Values>
+    requires(std::is_convertible_v<Values&&, value_type> && ...)
+  std::pair<const_iterator<type>, bool> insert_each(Values&&... values);
+
+  template <IteratorType type, typename Function>
+  void for_each(Function&& function) const;
+
+  template <IteratorType type>
+  size_type copy_to(std::span<value_type> out) const;
+
+  template <IteratorType type>
+  std::vector<value_type> to_vector() const;
+
   template <IteratorType type>
   const_iterator<type> erase(const_iterator<type> pos);
 
@@ -154,64 +264,143 @@ public:
 
   size_type erase(const value_type& key);
 
+  size_type erase_range(const value_type& low, const value_type& high);
+
+  size_type count_range(const value_type& low, const value_type& high) const;
+
   size_type count(const value_type& key);
 
   template <typename K>
+    requires Transparent<Compare>
   size_type count(const K& x) const;
 
   template <IteratorType type>
   const_iterator<type> find(const value_type& key);
 
   template <IteratorType type, typename K>
+    requires Transparent<Compare>
   const_iterator<type> find(const K& key);
 
   bool contains(const value_type& key);
 
+  template <IteratorType type>
+  void find_batch(std::span<const value_type> keys,
+                  std::span<const_iterator<type>> out) const;
+
+  template <IteratorType type, typename K>
+    requires Transparent<Compare>
+  void find_batch(std::span<const K> keys,
+                  std::span<const_iterator<type>> out) const;
+
+  void contains_batch(std::span<const value_type> keys,
+                      std::span<bool> out) const;
+
+  template <typename K>
+    requires Transparent<Compare>
+  void contains_batch(std::span<const K> keys, std::span<bool> out) const;
+
   template <typename K>
+    requires Transparent<Compare>
   bool contains(const K& x) const;
 
   template <IteratorType type>
   const_iterator<type> lower_bound(const value_type& key);
 
   template <IteratorType type, typename K>
+    requires Transparent<Compare>
   const_iterator<type> lower_bound(const K& key);
 
   template <IteratorType type>
   const_iterator<type> upper_bound(const value_type& key);
 
+  template <IteratorType type>
+  std::pair<const_iterator<type>, const_iterator<type>> equal_range(
+      const value_type& key);
+
+  template <IteratorType type, typename K>
+    requires Transparent<Compare>
+  std::pair<const_iterator<type>, const_iterator<type>> equal_range(
+      const K& key);
+
   template <IteratorType type, typename K>
+    requires Transparent<Compare>
   const_iterator<type> upper_bound(const K& key);
 
-  Node<value_type>* extract(const value_type& key);
+  size_type rank(const value_type& key);
+
+  template <IteratorType type>
+  const_iterator<type> nth(size_type index);
+
+  template <IteratorType type, typename Generator>
+  const_iterator<type> sample(Generator& generator);
+
+  node_type extract(const value_type& key);
+
+  template <IteratorType type>
+  node_type extract(const_iterator<type> pos);
+
+  template <IteratorType type>
+  std::pair<const_iterator<type>, bool> insert(node_type&& node);
 
   void merge(BST& source);
 
-  void clear();
+  FrozenBST<value_type, Compare> freeze();
 
- private:
-  Tree<value_type, Allocator> tree_;
+  PersistentBST<value_type, Compare> persist();
+
+  template <ExecutionPolicy policy = ExecutionPolicy::SEQUENTIAL>
+  void set_union(const BST& other);
 
-  Node<value_type>* Insert(Node<value_type>* node, int value);
+  template <ExecutionPolicy policy = ExecutionPolicy::SEQUENTIAL>
+  void set_intersection(const BST& other);
 
-  Node<value_type>* Min(Node<value_type>* node);
+  template <ExecutionPolicy policy = ExecutionPolicy::SEQUENTIAL>
+  void set_difference(const BST& other);
+
+  void clear();
 
-  Node<value_type>* Remove(Node<value_type>* node, int value);
+  size_t parallel_threshold() const {
+    return tree_.GetParallelThreshold();
+  }
 
-  Node<value_type>* Copy(Node<value_type>* node);
+  void set_parallel_threshold(size_t threshold) {
+    tree_.SetParallelThreshold(threshold);
+  }
 
-  void Deallocate(Node<value_type>* node);
+ private:
+  tree_type tree_;
 
-  void UpdateParentPointers(Node<value_type>* node, Node<value_type>* parent);
+  template <class ForwardIt>
+  bool IsSortedUnique(ForwardIt first, ForwardIt last) const;
 };
 
-template <typename T, typename Allocator>
-BST<T, Allocator>::BST(const std::initializer_list<value_type>& ilist) {
-  this->tree_.Deallocate();
+template <typename T, typename Allocator, typename Balance, typename Compare>
+BST<T, Allocator, Balance, Compare>::BST(
+    const std::initializer_list<value_type>& ilist,
+    const allocator_type& allocator)
+    : tree_(Compare(), tree_type::Rebind(allocator)) {
   this->insert(ilist);
 }
 
-template <typename T, typename Allocator>
-BST<T, Allocator>& BST<T, Allocator>::operator=(
+template <typename T, typename Allocator, typename Balance, typename Compare>
+template <class InputIt>
+BST<T, Allocator, Balance, Compare>::BST(InputIt first, InputIt last,
+                                         const allocator_type& allocator)
+    : tree_(Compare(), tree_type::Rebind(allocator)) {
+  this->insert(first, last);
+}
+
+template <typename T, typename Allocator, typename Balance, typename Compare>
+template <class InputIt>
+BST<T, Allocator, Balance, Compare>::BST(sorted_unique_t, InputIt first,
+                                         InputIt last,
+                                         const allocator_type& allocator)
+    : tree_(Compare(), tree_type::Rebind(allocator)) {
+  this->assign(sorted_unique, first, last);
+}
+
+template <typename T, typename Allocator, typename Balance, typename Compare>
+BST<T, Allocator, Balance, Compare>& BST<T, Allocator, Balance, Compare>::operator=(
     const std::initializer_list<value_type>& ilist) {
   this->tree_.Deallocate();
   this->insert(ilist);
@@ -219,109 +408,135 @@ BST<T, Allocator>& BST<T, Allocator>::operator=(
   return *this;
 }
 
-template <typename T, typename Allocator>
+template <typename T, typename Allocator, typename Balance, typename Compare>
 template <IteratorType type>
-typename BST<T, Allocator>::template const_iterator<type>
-BST<T, Allocator>::begin() {
+typename BST<T, Allocator, Balance, Compare>::template const_iterator<type>
+BST<T, Allocator, Balance, Compare>::begin() {
   return cbegin<type>();
 }
 
-template <typename T, typename Allocator>
+template <typename T, typename Allocator, typename Balance, typename Compare>
 template <IteratorType type>
-typename BST<T, Allocator>::template const_iterator<type>
-BST<T, Allocator>::end() {
+typename BST<T, Allocator, Balance, Compare>::template const_iterator<type>
+BST<T, Allocator, Balance, Compare>::end() {
   return cend<type>();
 }
 
-template <typename T, typename Allocator>
-BST<T, Allocator>::BST(const BST<T, Allocator>& other) {
-  this->root_ = Copy(other.root_);
+template <typename T, typename Allocator, typename Balance, typename Compare>
+BST<T, Allocator, Balance, Compare>::BST(
+    const BST<T, Allocator, Balance, Compare>& other)
+    : tree_(other.tree_.GetCompare(),
+            std::allocator_traits<typename tree_type::node_allocator_type>::
+                select_on_container_copy_construction(
+                    other.tree_.GetAllocator())) {
+  this->tree_.SetParallelThreshold(other.tree_.GetParallelThreshold());
+  this->tree_.SetRoot(
+      this->tree_.Copy(other.tree_.GetRoot(), other.tree_.GetSize()));
+  this->tree_.SetSize(other.tree_.GetSize());
 }
 
-template <typename T, typename Allocator>
-Node<T>* BST<T, Allocator>::Copy(Node<T>* node) {
-  if (node == nullptr) return node;
-
-  Node<T>* new_node = allocator_.allocate(1);
-  std::allocator_traits<Allocator>::construct(allocator_, new_node,
-                                              node->value);
-  new_node->right = Copy(node->right);
+template <typename T, typename Allocator, typename Balance, typename Compare>
+BST<T, Allocator, Balance, Compare>::BST(
+    const BST<T, Allocator, Balance, Compare>& other,
+    const allocator_type& allocator)
+    : tree_(other.tree_.GetCompare(), tree_type::Rebind(allocator)) {
+  this->tree_.SetParallelThreshold(other.tree_.GetParallelThreshold());
+  this->tree_.SetRoot(
+      this->tree_.Copy(other.tree_.GetRoot(), other.tree_.GetSize()));
+  this->tree_.SetSize(other.tree_.GetSize());
+}
 
-  if (new_node->right != nullptr) {
-    new_node->right->parent = new_node;
-  }
+template <typename T, typename Allocator, typename Balance, typename Compare>
+BST<T, Allocator, Balance, Compare>& BST<T, Allocator, Balance, Compare>::operator=(
+    const BST<T, Allocator, Balance, Compare>& other) {
+  if (this == &other) return *this;
 
-  new_node->left = Copy(node->left);
-  if (new_node->left != nullptr) {
-    new_node->left->parent = new_node;
-  }
+  this->tree_.Assign(other.tree_);
 
-  return new_node;
+  return *this;
 }
 
-template <typename T, typename Allocator>
-BST<T, Allocator>& BST<T, Allocator>::operator=(
-    const BST<T, Allocator>& other) {
-  this->root_ = Copy(other.root_);
+template <typename T, typename Allocator, typename Balance, typename Compare>
+BST<T, Allocator, Balance, Compare>& BST<T, Allocator, Balance, Compare>::operator=(
+    BST<T, Allocator, Balance, Compare>&& other) noexcept(
+    std::is_nothrow_move_assignable_v<tree_type>) {
+  this->tree_ = std::move(other.tree_);
+
+  return *this;
 }
 
-template <typename T, typename Allocator>
-BST<T, Allocator>::~BST() {
+template <typename T, typename Allocator, typename Balance, typename Compare>
+BST<T, Allocator, Balance, Compare>::~BST() {
   tree_.Deallocate();
 }
 
-template <typename T, typename Allocator>
-void BST<T, Allocator>::swap(BST<T, Allocator>& other) {
-  auto temp = this->tree_.GetRoot();
-  this->tree_.SetRoot(other.tree_.GetRoot());
-  other.tree_.SetRoot(temp);
+template <typename T, typename Allocator, typename Balance, typename Compare>
+void BST<T, Allocator, Balance, Compare>::swap(
+    BST<T, Allocator, Balance, Compare>& other) noexcept {
+  this->tree_.Swap(other.tree_);
+}
 
-  size_t temp_size = this->tree_.GetSize();
-  this->tree_.SetSize(other.tree_.GetSize());
-  other.tree_.SetSize(temp_size);
+template <typename T, typename Allocator, typename Balance, typename Compare>
+typename BST<T, Allocator, Balance, Compare>::allocator_type
+BST<T, Allocator, Balance, Compare>::get_allocator() const {
+  if constexpr (std::is_constructible_v<
+                    allocator_type,
+                    const typename tree_type::node_allocator_type&>) {
+    return allocator_type(this->tree_.GetAllocator());
+  } else {
+    return allocator_type();
+  }
 }
 
-template <typename T, typename Allocator>
-typename BST<T, Allocator>::size_type BST<T, Allocator>::size() {
+template <typename T, typename Allocator, typename Balance, typename Compare>
+typename BST<T, Allocator, Balance, Compare>::size_type BST<T, Allocator, Balance, Compare>::size() {
   return this->tree_.GetSize();
 }
 
-template <typename T, typename Allocator>
-typename BST<T, Allocator>::size_type BST<T, Allocator>::max_size() {
+template <typename T, typename Allocator, typename Balance, typename Compare>
+typename BST<T, Allocator, Balance, Compare>::size_type BST<T, Allocator, Balance, Compare>::max_size() {
   return std::numeric_limits<size_type>::max() / sizeof(value_type);
 }
 
-template <typename T, typename Allocator>
-bool BST<T, Allocator>::empty() {
+template <typename T, typename Allocator, typename Balance, typename Compare>
+void BST<T, Allocator, Balance, Compare>::reserve(size_type count) {
+  this->tree_.Reserve(count);
+}
+
+template <typename T, typename Allocator, typename Balance, typename Compare>
+bool BST<T, Allocator, Balance, Compare>::empty() {
   return begin<IteratorType::INORDER>() == end<IteratorType::INORDER>();
 }
 
-template <typename T, typename Allocator>
+template <typename T, typename Allocator, typename Balance, typename Compare>
 template <IteratorType type>
-BST<T, Allocator>::const_iterator<type>::const_iterator(Node<T>* ptr)
-    : ptr_(ptr) {}
+BST<T, Allocator, Balance, Compare>::const_iterator<type>::const_iterator(
+    tree_node* ptr, const tree_type* tree)
+    : ptr_(ptr), tree_(tree) {}
 
-template <typename T, typename Allocator>
+template <typename T, typename Allocator, typename Balance, typename Compare>
 template <IteratorType type>
-BST<T, Allocator>::const_iterator<type>::const_iterator(
+BST<T, Allocator, Balance, Compare>::const_iterator<type>::const_iterator(
     const const_iterator<type>& other) {
   this->ptr_ = other.ptr_;
+  this->tree_ = other.tree_;
 }
 
-template <typename T, typename Allocator>
+template <typename T, typename Allocator, typename Balance, typename Compare>
 template <IteratorType type>
-typename BST<T, Allocator>::template const_iterator<type>&
-BST<T, Allocator>::const_iterator<type>::operator=(
+typename BST<T, Allocator, Balance, Compare>::template const_iterator<type>&
+BST<T, Allocator, Balance, Compare>::const_iterator<type>::operator=(
     const const_iterator<type>& other) {
   this->ptr_ = other.ptr_;
+  this->tree_ = other.tree_;
 
   return *this;
 }
 
-template <typename T, typename Allocator>
+template <typename T, typename Allocator, typename Balance, typename Compare>
 template <IteratorType type>
-typename BST<T, Allocator>::template const_iterator<type>&
-BST<T, Allocator>::const_iterator<type>::operator++() {
+typename BST<T, Allocator, Balance, Compare>::template const_iterator<type>&
+BST<T, Allocator, Balance, Compare>::const_iterator<type>::operator++() {
   if (type == IteratorType::PREORDER) {
     if (ptr_->left != nullptr) {
       ptr_ = ptr_->left;
@@ -340,7 +555,9 @@ BST<T, Allocator>::const_iterator<type>::operator++() {
       }
     }
   } else if (type == IteratorType::INORDER) {
-    if (ptr_->right != nullptr) {
+    if constexpr (tree_node::kThreaded) {
+      ptr_ = ptr_->next;
+    } else if (ptr_->right != nullptr) {
       ptr_ = ptr_->right;
       while (ptr_->left != nullptr) {
         ptr_ = ptr_->left;
@@ -377,20 +594,20 @@ BST<T, Allocator>::const_iterator<type>::operator++() {
   return *this;
 }
 
-template <typename T, typename Allocator>
+template <typename T, typename Allocator, typename Balance, typename Compare>
 template <IteratorType type>
-typename BST<T, Allocator>::template const_iterator<type>
-BST<T, Allocator>::const_iterator<type>::operator++(int) {
+typename BST<T, Allocator, Balance, Compare>::template const_iterator<type>
+BST<T, Allocator, Balance, Compare>::const_iterator<type>::operator++(int) {
   const_iterator<type> temp = *this;
   ++(*this);
 
   return temp;
 }
 
-template <typename T, typename Allocator>
+template <typename T, typename Allocator, typename Balance, typename Compare>
 template <IteratorType type>
-const typename BST<T, Allocator>::value_type&
-BST<T, Allocator>::const_iterator<type>::operator*() {
+const typename BST<T, Allocator, Balance, Compare>::value_type&
+BST<T, Allocator, Balance, Compare>::const_iterator<type>::operator*() {
   if (this->ptr_ != nullptr) {
   return this->ptr_->value;
   } else {
@@ -398,26 +615,37 @@ BST<T, Allocator>::const_iterator<type>::operator*() {
   }
 }
 
-template <typename T, typename Allocator>
+template <typename T, typename Allocator, typename Balance, typename Compare>
 template <IteratorType type>
-bool BST<T, Allocator>::const_iterator<type>::operator!=(
-    const typename BST<T, Allocator>::const_iterator<type>& other) const {
+bool BST<T, Allocator, Balance, Compare>::const_iterator<type>::operator!=(
+    const typename BST<T, Allocator, Balance, Compare>::const_iterator<type>& other) const {
   return this->ptr_ != other.ptr_;
 }
 
-template <typename T, typename Allocator>
+template <typename T, typename Allocator, typename Balance, typename Compare>
 template <IteratorType type>
-bool BST<T, Allocator>::const_iterator<type>::operator==(
-    const typename BST<T, Allocator>::const_iterator<type>& other) const {
+bool BST<T, Allocator, Balance, Compare>::const_iterator<type>::operator==(
+    const typename BST<T, Allocator, Balance, Compare>::const_iterator<type>& other) const {
   return this->ptr_ == other.ptr_;
 }
 
-template <typename T, typename Allocator>
+template <typename T, typename Allocator, typename Balance, typename Compare>
 template <IteratorType type>
-typename BST<T, Allocator>::template const_iterator<type>&
-BST<T, Allocator>::const_iterator<type>::operator--() {
+typename BST<T, Allocator, Balance, Compare>::template const_iterator<type>&
+BST<T, Allocator, Balance, Compare>::const_iterator<type>::operator--() {
   if (type == IteratorType::INORDER) {
-    if (ptr_->left != nullptr) {
+    if (ptr_ == nullptr) {
+      if (tree_ == nullptr || tree_->GetRoot() == nullptr) {
+        throw std::invalid_argument("Decrementing an empty end iterator.");
+      }
+
+      ptr_ = tree_->GetRoot();
+      while (ptr_->right != nullptr) {
+        ptr_ = ptr_->right;
+      }
+    } else if constexpr (tree_node::kThreaded) {
+      ptr_ = ptr_->prev;
+    } else if (ptr_->left != nullptr) {
       ptr_ = ptr_->left;
       while (ptr_->right != nullptr) {
         ptr_ = ptr_->right;
@@ -472,35 +700,155 @@ BST<T, Allocator>::const_iterator<type>::operator--() {
   return *this;
 }
 
-template <typename T, typename Allocator>
+template <typename T, typename Allocator, typename Balance, typename Compare>
 template <IteratorType type>
-typename BST<T, Allocator>::template const_iterator<type>
-BST<T, Allocator>::const_iterator<type>::operator--(int) {
-  const_iterator<type> temp = const_iterator<type>(this->ptr_);
+typename BST<T, Allocator, Balance, Compare>::template const_iterator<type>
+BST<T, Allocator, Balance, Compare>::const_iterator<type>::operator--(int) {
+  const_iterator<type> temp = *this;
   --(*this);
 
   return temp;
 }
 
-template <typename T, typename Allocator>
+template <typename T, typename Allocator, typename Balance, typename Compare>
+template <IteratorType type>
+typename BST<T, Allocator, Balance, Compare>::template const_iterator<type>&
+BST<T, Allocator, Balance, Compare>::const_iterator<type>::operator+=(
+    difference_type offset)
+  requires(type == IteratorType::INORDER)
+{
+  if (offset == 0) return *this;
+
+  if (this->ptr_ == nullptr) {
+    if (offset > 0) throw std::invalid_argument("Advancing past the end.");
+
+    --(*this);
+    ++offset;
+    if (offset == 0) return *this;
+  }
+
+  this->ptr_ =
+      tree_type::Advance(const_cast<tree_node*>(this->ptr_), offset);
+
+  return *this;
+}
+
+template <typename T, typename Allocator, typename Balance, typename Compare>
+template <IteratorType type>
+typename BST<T, Allocator, Balance, Compare>::template const_iterator<type>&
+BST<T, Allocator, Balance, Compare>::const_iterator<type>::operator-=(
+    difference_type offset)
+  requires(type == IteratorType::INORDER)
+{
+  return *this += -offset;
+}
+
+template <typename T, typename Allocator, typename Balance, typename Compare>
+template <IteratorType type>
+typename BST<T, Allocator, Balance, Compare>::template const_iterator<type>
+BST<T, Allocator, Balance, Compare>::const_iterator<type>::operator+(
+    difference_type offset) const
+  requires(type == IteratorType::INORDER)
+{
+  const_iterator<type> temp = *this;
+  temp += offset;
+
+  return temp;
+}
+
+template <typename T, typename Allocator, typename Balance, typename Compare>
+template <IteratorType type>
+typename BST<T, Allocator, Balance, Compare>::template const_iterator<type>
+BST<T, Allocator, Balance, Compare>::const_iterator<type>::operator-(
+    difference_type offset) const
+  requires(type == IteratorType::INORDER)
+{
+  const_iterator<type> temp = *this;
+  temp -= offset;
+
+  return temp;
+}
+
+template <typename T, typename Allocator, typename Balance, typename Compare>
 template <IteratorType type>
-typename BST<T, Allocator>::template const_iterator<type>
-BST<T, Allocator>::cbegin() {
+typename BST<T, Allocator, Balance, Compare>::template const_iterator<
+    type>::difference_type
+BST<T, Allocator, Balance, Compare>::const_iterator<type>::operator-(
+    const const_iterator& other) const
+  requires(type == IteratorType::INORDER)
+{
+  return tree_type::Distance(other.ptr_, this->ptr_);
+}
+
+template <typename T, typename Allocator, typename Balance, typename Compare>
+template <IteratorType type>
+const typename BST<T, Allocator, Balance, Compare>::value_type&
+BST<T, Allocator, Balance, Compare>::const_iterator<type>::operator[](
+    difference_type offset) const
+  requires(type == IteratorType::INORDER)
+{
+  return *(*this + offset);
+}
+
+template <typename T, typename Allocator, typename Balance, typename Compare>
+template <IteratorType type>
+bool BST<T, Allocator, Balance, Compare>::const_iterator<type>::operator<(
+    const const_iterator& other) const
+  requires(type == IteratorType::INORDER)
+{
+  return *this - other < 0;
+}
+
+template <typename T, typename Allocator, typename Balance, typename Compare>
+template <IteratorType type>
+bool BST<T, Allocator, Balance, Compare>::const_iterator<type>::operator>(
+    const const_iterator& other) const
+  requires(type == IteratorType::INORDER)
+{
+  return other < *this;
+}
+
+template <typename T, typename Allocator, typename Balance, typename Compare>
+template <IteratorType type>
+bool BST<T, Allocator, Balance, Compare>::const_iterator<type>::operator<=(
+    const const_iterator& other) const
+  requires(type == IteratorType::INORDER)
+{
+  return !(other < *this);
+}
+
+template <typename T, typename Allocator, typename Balance, typename Compare>
+template <IteratorType type>
+bool BST<T, Allocator, Balance, Compare>::const_iterator<type>::operator>=(
+    const const_iterator& other) const
+  requires(type == IteratorType::INORDER)
+{
+  return !(*this < other);
+}
+
+template <typename T, typename Allocator, typename Balance, typename Compare>
+template <IteratorType type>
+typename BST<T, Allocator, Balance, Compare>::template const_iterator<type>
+BST<T, Allocator, Balance, Compare>::cbegin() {
   if (type == IteratorType::INORDER) {
-    if (this->tree_.GetRoot() == nullptr) return const_iterator<type>(nullptr);
-    Node<T>* cur = this->tree_.GetRoot();
+    if (this->tree_.GetRoot() == nullptr) {
+      return const_iterator<type>(nullptr, &this->tree_);
+    }
+    tree_node* cur = this->tree_.GetRoot();
 
     while (cur->left != nullptr) {
       cur = cur->left;
     }
 
-    return const_iterator<type>(cur);
+    return const_iterator<type>(cur, &this->tree_);
   } else if (type == IteratorType::PREORDER) {
-    return const_iterator<type>(this->tree_.GetRoot());
+    return const_iterator<type>(this->tree_.GetRoot(), &this->tree_);
   } else if (type == IteratorType::POSTORDER) {
-    if (this->tree_.GetRoot() == nullptr) return const_iterator<type>(nullptr);
+    if (this->tree_.GetRoot() == nullptr) {
+      return const_iterator<type>(nullptr, &this->tree_);
+    }
 
-    Node<T>* cur = this->tree_.GetRoot();
+    tree_node* cur = this->tree_.GetRoot();
     while (cur->left != nullptr || cur->right != nullptr) {
       if (cur->left != nullptr) {
         cur = cur->left;
@@ -509,337 +857,629 @@ BST<T, Allocator>::cbegin() {
       }
     }
 
-    return const_iterator<type>(cur);
+    return const_iterator<type>(cur, &this->tree_);
   }
 }
-template <typename T, typename Allocator>
+template <typename T, typename Allocator, typename Balance, typename Compare>
 template <IteratorType type>
-typename BST<T, Allocator>::template const_iterator<type>
-BST<T, Allocator>::cend() {
-  return const_iterator<type>(nullptr);
+typename BST<T, Allocator, Balance, Compare>::template const_iterator<type>
+BST<T, Allocator, Balance, Compare>::cend() {
+  return const_iterator<type>(nullptr, &this->tree_);
 }
 
-template <typename T, typename Allocator>
+template <typename T, typename Allocator, typename Balance, typename Compare>
 template <typename It>
-BST<T, Allocator>::template const_reverse_iterator<It>::const_reverse_iterator(
-    Node<value_type>* ptr) {
+BST<T, Allocator, Balance, Compare>::template const_reverse_iterator<It>::const_reverse_iterator(
+    tree_node* ptr) {
   this->current = It(ptr);
 }
 
-template <typename T, typename Allocator>
+template <typename T, typename Allocator, typename Balance, typename Compare>
 template <typename It>
-BST<T, Allocator>::template const_reverse_iterator<It>::const_reverse_iterator(
+BST<T, Allocator, Balance, Compare>::template const_reverse_iterator<It>::const_reverse_iterator(
     const const_reverse_iterator& other) {
   this->current = other.current;
 }
 
-template <typename T, typename Allocator>
+template <typename T, typename Allocator, typename Balance, typename Compare>
 template <typename It>
-typename BST<T, Allocator>::template const_reverse_iterator<It>&
-BST<T, Allocator>::const_reverse_iterator<It>::operator++() {
+typename BST<T, Allocator, Balance, Compare>::template const_reverse_iterator<It>&
+BST<T, Allocator, Balance, Compare>::const_reverse_iterator<It>::operator++() {
   --current;
 
   return *this;
 }
 
-template <typename T, typename Allocator>
+template <typename T, typename Allocator, typename Balance, typename Compare>
 template <typename It>
-typename BST<T, Allocator>::template const_reverse_iterator<It>
-BST<T, Allocator>::const_reverse_iterator<It>::operator++(int) {
+typename BST<T, Allocator, Balance, Compare>::template const_reverse_iterator<It>
+BST<T, Allocator, Balance, Compare>::const_reverse_iterator<It>::operator++(int) {
   const_reverse_iterator<It> temp = *this;
   ++(*this);
 
   return temp;
 }
 
-template <typename T, typename Allocator>
+template <typename T, typename Allocator, typename Balance, typename Compare>
 template <typename It>
-typename BST<T, Allocator>::template const_reverse_iterator<It>&
-BST<T, Allocator>::const_reverse_iterator<It>::operator--() {
+typename BST<T, Allocator, Balance, Compare>::template const_reverse_iterator<It>&
+BST<T, Allocator, Balance, Compare>::const_reverse_iterator<It>::operator--() {
   ++current;
 
   return *this;
 }
 
-template <typename T, typename Allocator>
+template <typename T, typename Allocator, typename Balance, typename Compare>
 template <typename It>
-typename BST<T, Allocator>::template const_reverse_iterator<It>
-BST<T, Allocator>::const_reverse_iterator<It>::operator--(int) {
+typename BST<T, Allocator, Balance, Compare>::template const_reverse_iterator<It>
+BST<T, Allocator, Balance, Compare>::const_reverse_iterator<It>::operator--(int) {
   const_reverse_iterator<It> temp = *this;
   --(*this);
 
   return temp;
 }
 
-template <typename T, typename Allocator>
+template <typename T, typename Allocator, typename Balance, typename Compare>
 template <typename It>
-const typename BST<T, Allocator>::value_type&
-BST<T, Allocator>::const_reverse_iterator<It>::operator*() {
+const typename BST<T, Allocator, Balance, Compare>::value_type&
+BST<T, Allocator, Balance, Compare>::const_reverse_iterator<It>::operator*() {
   return *(current);
 }
 
-template <typename T, typename Allocator>
+template <typename T, typename Allocator, typename Balance, typename Compare>
 template <typename It>
-typename BST<T, Allocator>::template const_reverse_iterator<It>&
-BST<T, Allocator>::const_reverse_iterator<It>::operator=(
-    const BST<T, Allocator>::const_reverse_iterator<It>& other) {
+typename BST<T, Allocator, Balance, Compare>::template const_reverse_iterator<It>&
+BST<T, Allocator, Balance, Compare>::const_reverse_iterator<It>::operator=(
+    const BST<T, Allocator, Balance, Compare>::const_reverse_iterator<It>& other) {
   this->current = other.current;
 
   return *this;
 }
 
-template <typename T, typename Allocator>
+template <typename T, typename Allocator, typename Balance, typename Compare>
 template <typename It>
-bool BST<T, Allocator>::const_reverse_iterator<It>::operator==(
-    const typename BST<T, Allocator>::const_reverse_iterator<It>& other) const {
+bool BST<T, Allocator, Balance, Compare>::const_reverse_iterator<It>::operator==(
+    const typename BST<T, Allocator, Balance, Compare>::const_reverse_iterator<It>& other) const {
   return this->current == other.current;
 }
 
-template <typename T, typename Allocator>
+template <typename T, typename Allocator, typename Balance, typename Compare>
 template <typename It>
-bool BST<T, Allocator>::const_reverse_iterator<It>::operator!=(
-    const typename BST<T, Allocator>::const_reverse_iterator<It>& other) const {
+bool BST<T, Allocator, Balance, Compare>::const_reverse_iterator<It>::operator!=(
+    const typename BST<T, Allocator, Balance, Compare>::const_reverse_iterator<It>& other) const {
   return this->current != other.current;
 }
 
-template <typename T, typename Allocator>
+template <typename T, typename Allocator, typename Balance, typename Compare>
 template <IteratorType type, typename... Args>
-std::pair<typename BST<T, Allocator>::template const_iterator<type>, bool>
-BST<T, Allocator>::emplace(Args&&... args) {
-  T arr[] = {std::forward<Args>(args)...};
-  size_t arr_size = sizeof(arr) / sizeof(arr[0]);
+std::pair<typename BST<T, Allocator, Balance, Compare>::template const_iterator<type>, bool>
+BST<T, Allocator, Balance, Compare>::emplace(Args&&... args) {
+  std::pair<tree_node*, bool> result =
+      this->tree_.Emplace(std::forward<Args>(args)...);
 
-  for (int i = 0; i < arr_size; ++i) {
-    Node<T>* find_node = this->tree_.Find(arr[i]);
+  return std::make_pair(const_iterator<type>(result.first, &this->tree_),
+                        result.second);
+}
 
-    if (find_node != nullptr) {
-      return std::make_pair(const_iterator<type>(find_node), false);
-    }
+template <typename T, typename Allocator, typename Balance, typename Compare>
+template <IteratorType type, typename... Values>
+  requires(std::is_convertible_v<Values&&, typename BST<T, Allocator, Balance,
+                                                       Compare>::value_type> &&
+           ...)
+std::pair<typename BST<T, Allocator, Balance, Compare>::template const_iterator<type>, bool>
+BST<T, Allocator, Balance, Compare>::insert_each(Values&&... values) {
+  std::pair<tree_node*, bool> result(nullptr, false);
+  ((result = this->tree_.Insert(value_type(std::forward<Values>(values)))), ...);
+
+  return std::make_pair(const_iterator<type>(result.first, &this->tree_),
+                        result.second);
+}
 
-    this->tree_.Insert(arr[i]);
-    Node<T>* inserted = this->tree_.Find(arr[i]);
-    if (i == arr_size - 1) {
-      return std::make_pair(const_iterator<type>(inserted), true);
-    }
-  }
+template <typename T, typename Allocator, typename Balance, typename Compare>
+template <IteratorType type, typename Function>
+void BST<T, Allocator, Balance, Compare>::for_each(Function&& function) const {
+  this->tree_.template Traverse<type>(function);
 }
 
-template <typename T, typename Allocator>
-void BST<T, Allocator>::UpdateParentPointers(Node<value_type>* node,
-                                             Node<value_type>* parent) {
-  if (node != nullptr) {
-    node->parent = parent;
-    UpdateParentPointers(node->left, node);
-    UpdateParentPointers(node->right, node);
+template <typename T, typename Allocator, typename Balance, typename Compare>
+template <IteratorType type>
+typename BST<T, Allocator, Balance, Compare>::size_type
+BST<T, Allocator, Balance, Compare>::copy_to(std::span<value_type> out) const {
+  if (out.size() < this->tree_.GetSize()) {
+    throw std::out_of_range("Span is smaller than the tree.");
   }
+
+  value_type* cursor = out.data();
+  this->tree_.template Traverse<type>(
+      [&cursor](const value_type& value) { *cursor++ = value; });
+
+  return this->tree_.GetSize();
+}
+
+template <typename T, typename Allocator, typename Balance, typename Compare>
+template <IteratorType type>
+std::vector<T> BST<T, Allocator, Balance, Compare>::to_vector() const {
+  std::vector<value_type> result;
+  result.reserve(this->tree_.GetSize());
+  this->tree_.template Traverse<type>(
+      [&result](const value_type& value) { result.push_back(value); });
+
+  return result;
 }
 
-template <typename T, typename Allocator>
+template <typename T, typename Allocator, typename Balance, typename Compare>
 template <IteratorType type>
-typename BST<T, Allocator>::template const_iterator<type>
-BST<T, Allocator>::erase(const_iterator<type> pos) {
+typename BST<T, Allocator, Balance, Compare>::template const_iterator<type>
+BST<T, Allocator, Balance, Compare>::erase(const_iterator<type> pos) {
   if (pos == this->cend<type>()) return cend<type>();
 
   const_iterator<type> following = pos;
-  value_type temp = *pos;
-  if (type != IteratorType::INORDER) {
-    ++following;
-    this->tree_.Remove(temp);
-  } else {
-    this->tree_.Remove(temp);
-    following = const_iterator<type>(this->tree_.Next(temp));
-  }
+  ++following;
+  this->tree_.Erase(const_cast<tree_node*>(pos.ptr_));
 
   return following;
 }
 
-template <typename T, typename Allocator>
+template <typename T, typename Allocator, typename Balance, typename Compare>
 template <IteratorType type>
-typename BST<T, Allocator>::template const_iterator<type>
-BST<T, Allocator>::erase(const_iterator<type> first,
-                         const_iterator<type> last) {
-  const_iterator<type> following;
-  value_type temp;
-  int length = 0;
-
-  for (auto it = first; it != last; ++it) {
-    ++length;
-  }
-
-  value_type* temp_arr = new value_type[length];
-  int i = 0;
-  for (auto it = first; it != last; ++it) {
-    temp_arr[i] = *it;
-    ++i;
-  }
-
-  for (int i = 0; i < length; ++i) {
-    this->tree_.Remove(temp_arr[i]);
-    if (i == length - 1) {
-      following = const_iterator<type>(this->tree_.Find(temp_arr[i]));
+typename BST<T, Allocator, Balance, Compare>::template const_iterator<type>
+BST<T, Allocator, Balance, Compare>::erase(const_iterator<type> first,
+                                           const_iterator<type> last) {
+  if constexpr (type == IteratorType::INORDER) {
+    this->tree_.EraseRange(const_cast<tree_node*>(first.ptr_),
+                           const_cast<tree_node*>(last.ptr_));
+  } else {
+    std::vector<tree_node*> nodes;
+    for (auto it = first; it != last; ++it) {
+      nodes.push_back(const_cast<tree_node*>(it.ptr_));
     }
-  }
 
-  if (type != IteratorType::INORDER) {
-    ++following;
-  } else {
-    following = const_iterator<type>(this->tree_.Next(temp));
+    for (tree_node* node : nodes) {
+      this->tree_.Erase(node);
+    }
   }
-  delete[] temp_arr;
 
-  return following;
+  return last;
 }
 
-template <typename T, typename Allocator>
-typename BST<T, Allocator>::size_type BST<T, Allocator>::erase(
+template <typename T, typename Allocator, typename Balance, typename Compare>
+typename BST<T, Allocator, Balance, Compare>::size_type BST<T, Allocator, Balance, Compare>::erase(
     const value_type& key) {
-  if (!this->tree_.Find(key)) return 0;
+  tree_node* node = this->tree_.Find(key);
+  if (node == nullptr) return 0;
 
-  this->tree_.Remove(key);
+  this->tree_.Erase(node);
 
   return 1;
 }
 
-template <typename T, typename Allocator>
-typename BST<T, Allocator>::size_type BST<T, Allocator>::count(
+template <typename T, typename Allocator, typename Balance, typename Compare>
+typename BST<T, Allocator, Balance, Compare>::size_type
+BST<T, Allocator, Balance, Compare>::erase_range(const value_type& low,
+                                                 const value_type& high) {
+  if (!this->tree_.GetCompare()(low, high)) return 0;
+
+  return this->tree_.EraseRange(this->tree_.LowerBound(low),
+                                this->tree_.LowerBound(high));
+}
+
+template <typename T, typename Allocator, typename Balance, typename Compare>
+typename BST<T, Allocator, Balance, Compare>::size_type
+BST<T, Allocator, Balance, Compare>::count_range(const value_type& low,
+                                                 const value_type& high) const {
+  return this->tree_.CountRange(low, high);
+}
+
+template <typename T, typename Allocator, typename Balance, typename Compare>
+typename BST<T, Allocator, Balance, Compare>::size_type BST<T, Allocator, Balance, Compare>::count(
     const value_type& key) {
   if (this->tree_.Find(key)) return 1;
 
   return 0;
 }
 
-template <typename T, typename Allocator>
+template <typename T, typename Allocator, typename Balance, typename Compare>
 template <typename K>
-typename BST<T, Allocator>::size_type BST<T, Allocator>::count(
-    const K& key) const {
+  requires Transparent<Compare>
+typename BST<T, Allocator, Balance, Compare>::size_type
+BST<T, Allocator, Balance, Compare>::count(const K& key) const {
   if (this->tree_.Find(key)) return 1;
 
   return 0;
 }
 
-template <typename T, typename Allocator>
+template <typename T, typename Allocator, typename Balance, typename Compare>
 template <IteratorType type>
-typename BST<T, Allocator>::template const_iterator<type>
-BST<T, Allocator>::find(const value_type& key) {
-  Node<value_type>* node = this->tree_.Find(key);
+typename BST<T, Allocator, Balance, Compare>::template const_iterator<type>
+BST<T, Allocator, Balance, Compare>::find(const value_type& key) {
+  tree_node* node = this->tree_.Find(key);
 
-  return const_iterator<type>(node);
+  return const_iterator<type>(node, &this->tree_);
 }
 
-template <typename T, typename Allocator>
+template <typename T, typename Allocator, typename Balance, typename Compare>
 template <IteratorType type, typename K>
-typename BST<T, Allocator>::template const_iterator<type>
-BST<T, Allocator>::find(const K& key) {
-  Node<value_type>* node = this->tree_.Find(key);
+  requires Transparent<Compare>
+typename BST<T, Allocator, Balance, Compare>::template const_iterator<type>
+BST<T, Allocator, Balance, Compare>::find(const K& key) {
+  tree_node* node = this->tree_.Find(key);
 
-  return const_iterator<type>(node);
+  return const_iterator<type>(node, &this->tree_);
 }
 
-template <typename T, typename Allocator>
-bool BST<T, Allocator>::contains(const value_type& key) {
+template <typename T, typename Allocator, typename Balance, typename Compare>
+bool BST<T, Allocator, Balance, Compare>::contains(const value_type& key) {
   return (this->tree_.Find(key) == nullptr) ? false : true;
 }
 
-template <typename T, typename Allocator>
+template <typename T, typename Allocator, typename Balance, typename Compare>
 template <typename K>
-bool BST<T, Allocator>::contains(const K& key) const {
+  requires Transparent<Compare>
+bool BST<T, Allocator, Balance, Compare>::contains(const K& key) const {
   return (this->tree_.Find(key) == nullptr) ? false : true;
 }
 
-template <typename T, typename Allocator>
+template <typename T, typename Allocator, typename Balance, typename Compare>
 template <IteratorType type>
-typename BST<T, Allocator>::template const_iterator<type>
-BST<T, Allocator>::lower_bound(const value_type& key) {
-  Node<value_type>* temp = this->tree_.Find(key);
+void BST<T, Allocator, Balance, Compare>::find_batch(
+    std::span<const value_type> keys,
+    std::span<const_iterator<type>> out) const {
+  if (out.size() < keys.size()) {
+    throw std::out_of_range("Output span is smaller than the key span.");
+  }
 
-  if (temp != nullptr) return const_iterator<type>(temp);
+  this->tree_.FindBatch(keys, [this, &out](size_t index,
+                                           tree_node* node) {
+    out[index] = const_iterator<type>(node, &this->tree_);
+  });
+}
+
+template <typename T, typename Allocator, typename Balance, typename Compare>
+template <IteratorType type, typename K>
+  requires Transparent<Compare>
+void BST<T, Allocator, Balance, Compare>::find_batch(
+    std::span<const K> keys, std::span<const_iterator<type>> out) const {
+  if (out.size() < keys.size()) {
+    throw std::out_of_range("Output span is smaller than the key span.");
+  }
 
-  return const_iterator<type>(this->tree_.Next(key));
+  this->tree_.FindBatch(keys, [this, &out](size_t index,
+                                           tree_node* node) {
+    out[index] = const_iterator<type>(node, &this->tree_);
+  });
 }
 
-template <typename T, typename Allocator>
+template <typename T, typename Allocator, typename Balance, typename Compare>
+void BST<T, Allocator, Balance, Compare>::contains_batch(
+    std::span<const value_type> keys, std::span<bool> out) const {
+  if (out.size() < keys.size()) {
+    throw std::out_of_range("Output span is smaller than the key span.");
+  }
+
+  this->tree_.FindBatch(keys, [&out](size_t index, tree_node* node) {
+    out[index] = (node != nullptr);
+  });
+}
+
+template <typename T, typename Allocator, typename Balance, typename Compare>
+template <typename K>
+  requires Transparent<Compare>
+void BST<T, Allocator, Balance, Compare>::contains_batch(
+    std::span<const K> keys, std::span<bool> out) const {
+  if (out.size() < keys.size()) {
+    throw std::out_of_range("Output span is smaller than the key span.");
+  }
+
+  this->tree_.FindBatch(keys, [&out](size_t index, tree_node* node) {
+    out[index] = (node != nullptr);
+  });
+}
+
+template <typename T, typename Allocator, typename Balance, typename Compare>
+template <IteratorType type>
+typename BST<T, Allocator, Balance, Compare>::template const_iterator<type>
+BST<T, Allocator, Balance, Compare>::lower_bound(const value_type& key) {
+  return const_iterator<type>(this->tree_.LowerBound(key), &this->tree_);
+}
+
+template <typename T, typename Allocator, typename Balance, typename Compare>
 template <IteratorType type, typename K>
-typename BST<T, Allocator>::template const_iterator<type>
-BST<T, Allocator>::lower_bound(const K& key) {
-  Node<value_type>* temp = this->tree_.Find(key);
+  requires Transparent<Compare>
+typename BST<T, Allocator, Balance, Compare>::template const_iterator<type>
+BST<T, Allocator, Balance, Compare>::lower_bound(const K& key) {
+  return const_iterator<type>(this->tree_.LowerBound(key), &this->tree_);
+}
 
-  if (temp != nullptr) return const_iterator<type>(temp);
+template <typename T, typename Allocator, typename Balance, typename Compare>
+template <IteratorType type>
+typename BST<T, Allocator, Balance, Compare>::template const_iterator<type>
+BST<T, Allocator, Balance, Compare>::upper_bound(const value_type& key) {
+  return const_iterator<type>(this->tree_.Next(key), &this->tree_);
+}
 
-  return const_iterator<type>(this->tree_.Next(key));
+template <typename T, typename Allocator, typename Balance, typename Compare>
+template <IteratorType type, typename K>
+  requires Transparent<Compare>
+typename BST<T, Allocator, Balance, Compare>::template const_iterator<type>
+BST<T, Allocator, Balance, Compare>::upper_bound(const K& key) {
+  return const_iterator<type>(this->tree_.Next(key), &this->tree_);
 }
 
-template <typename T, typename Allocator>
+template <typename T, typename Allocator, typename Balance, typename Compare>
 template <IteratorType type>
-typename BST<T, Allocator>::template const_iterator<type>
-BST<T, Allocator>::upper_bound(const value_type& key) {
-  return const_iterator<type>(this->tree_.Next(key));
+std::pair<typename BST<T, Allocator, Balance, Compare>::template const_iterator<
+              type>,
+          typename BST<T, Allocator, Balance, Compare>::template const_iterator<
+              type>>
+BST<T, Allocator, Balance, Compare>::equal_range(const value_type& key) {
+  std::pair<tree_node*, tree_node*> range = this->tree_.EqualRange(key);
+
+  return std::make_pair(const_iterator<type>(range.first, &this->tree_),
+                        const_iterator<type>(range.second, &this->tree_));
 }
 
-template <typename T, typename Allocator>
+template <typename T, typename Allocator, typename Balance, typename Compare>
 template <IteratorType type, typename K>
-typename BST<T, Allocator>::template const_iterator<type>
-BST<T, Allocator>::upper_bound(const K& key) {
-  return const_iterator<type>(this->tree_.Next(key));
+  requires Transparent<Compare>
+std::pair<typename BST<T, Allocator, Balance, Compare>::template const_iterator<
+              type>,
+          typename BST<T, Allocator, Balance, Compare>::template const_iterator<
+              type>>
+BST<T, Allocator, Balance, Compare>::equal_range(const K& key) {
+  std::pair<tree_node*, tree_node*> range = this->tree_.EqualRange(key);
+
+  return std::make_pair(const_iterator<type>(range.first, &this->tree_),
+                        const_iterator<type>(range.second, &this->tree_));
 }
 
-template <typename T, typename Allocator>
-void BST<T, Allocator>::clear() {
+template <typename T, typename Allocator, typename Balance, typename Compare>
+void BST<T, Allocator, Balance, Compare>::clear() {
   tree_.Deallocate();
 }
 
-template <typename T, typename Allocator>
+template <typename T, typename Allocator, typename Balance, typename Compare>
 template <IteratorType type>
-std::pair<typename BST<T, Allocator>::template const_iterator<type>, bool>
-BST<T, Allocator>::insert(const value_type& value) {
-  Node<value_type>* temp = this->tree_.Find(value);
-  if (temp != nullptr) return std::make_pair(const_iterator<type>(temp), false);
+std::pair<typename BST<T, Allocator, Balance, Compare>::template const_iterator<type>, bool>
+BST<T, Allocator, Balance, Compare>::insert(const value_type& value) {
+  std::pair<tree_node*, bool> result = this->tree_.Insert(value);
 
-  this->tree_.Insert(value);
+  return std::make_pair(const_iterator<type>(result.first, &this->tree_),
+                        result.second);
+}
+
+template <typename T, typename Allocator, typename Balance, typename Compare>
+template <IteratorType type>
+typename BST<T, Allocator, Balance, Compare>::template const_iterator<type>
+BST<T, Allocator, Balance, Compare>::insert(const_iterator<type> hint,
+                                            const value_type& value) {
+  return const_iterator<type>(
+      this->tree_.Insert(const_cast<tree_node*>(hint.ptr_), value)
+          .first,
+      &this->tree_);
+}
 
-  return std::make_pair(const_iterator<type>(this->tree_.Find(value)), true);
+template <typename T, typename Allocator, typename Balance, typename Compare>
+template <IteratorType type>
+std::pair<typename BST<T, Allocator, Balance, Compare>::template const_iterator<
+              type>,
+          bool>
+BST<T, Allocator, Balance, Compare>::insert(value_type&& value) {
+  std::pair<tree_node*, bool> result = this->tree_.Insert(std::move(value));
+
+  return std::make_pair(const_iterator<type>(result.first, &this->tree_),
+                        result.second);
+}
+
+template <typename T, typename Allocator, typename Balance, typename Compare>
+template <IteratorType type>
+typename BST<T, Allocator, Balance, Compare>::template const_iterator<type>
+BST<T, Allocator, Balance, Compare>::insert(const_iterator<type> hint,
+                                            value_type&& value) {
+  return const_iterator<type>(
+      this->tree_.Insert(const_cast<tree_node*>(hint.ptr_), std::move(value))
+          .first,
+      &this->tree_);
 }
 
-template <typename T, typename Allocator>
+template <typename T, typename Allocator, typename Balance, typename Compare>
 template <class InputIt>
-void BST<T, Allocator>::insert(InputIt first, InputIt last) {
+void BST<T, Allocator, Balance, Compare>::insert(InputIt first, InputIt last) {
+  if constexpr (std::forward_iterator<InputIt>) {
+    if (IsSortedUnique(first, last)) {
+      if (this->tree_.GetSize() == 0) {
+        this->tree_.Build(first, std::distance(first, last));
+
+        return;
+      }
+
+      tree_node* hint = nullptr;
+      for (auto it = first; it != last; ++it) {
+        hint = this->tree_.Insert(hint, *it).first;
+      }
+
+      return;
+    }
+  }
+
   for (auto it = first; it != last; ++it) {
     this->tree_.Insert(*it);
   }
 }
 
-template <typename T, typename Allocator>
-void BST<T, Allocator>::insert(std::initializer_list<value_type> ilist) {
-  for (auto it = ilist.begin(); it != ilist.end(); ++it) {
-    this->tree_.Insert(*it);
-  }
+template <typename T, typename Allocator, typename Balance, typename Compare>
+void BST<T, Allocator, Balance, Compare>::insert(std::initializer_list<value_type> ilist) {
+  this->insert(ilist.begin(), ilist.end());
+}
+
+template <typename T, typename Allocator, typename Balance, typename Compare>
+template <class InputIt>
+void BST<T, Allocator, Balance, Compare>::assign(InputIt first, InputIt last) {
+  this->tree_.Deallocate();
+  this->insert(first, last);
 }
 
-template <typename T, typename Allocator>
-Node<T>* BST<T, Allocator>::extract(const value_type& key) {
-  Node<T>* temp = allocator_.allocate(1);
-  temp->value = tree_.Find(key)->value;
-  this->tree_.Remove(key);
+template <typename T, typename Allocator, typename Balance, typename Compare>
+template <class InputIt>
+void BST<T, Allocator, Balance, Compare>::assign(sorted_unique_t, InputIt first,
+                                                 InputIt last) {
+  if constexpr (std::forward_iterator<InputIt>) {
+    this->tree_.Build(first, std::distance(first, last));
+  } else {
+    this->tree_.Deallocate();
 
-  return temp;
+    for (auto it = first; it != last; ++it) {
+      this->tree_.Insert(nullptr, *it);
+    }
+  }
 }
 
-template <typename T, typename Allocator>
-void BST<T, Allocator>::merge(BST<T, Allocator>& source) {
-  while (!source.empty()) {
-    this->insert<IteratorType::INORDER>(
-        source.extract(source.tree_.GetRoot()->value)->value);
+template <typename T, typename Allocator, typename Balance, typename Compare>
+template <class ForwardIt>
+bool BST<T, Allocator, Balance, Compare>::IsSortedUnique(ForwardIt first,
+                                                         ForwardIt last) const {
+  if (first == last) return true;
+
+  for (ForwardIt next = std::next(first); next != last; ++first, ++next) {
+    if (!this->tree_.GetCompare()(*first, *next)) return false;
   }
+
+  return true;
+}
+
+template <typename T, typename Allocator, typename Balance, typename Compare>
+typename BST<T, Allocator, Balance, Compare>::size_type BST<T, Allocator, Balance, Compare>::rank(
+    const value_type& key) {
+  return this->tree_.Rank(key);
+}
+
+template <typename T, typename Allocator, typename Balance, typename Compare>
+template <IteratorType type>
+typename BST<T, Allocator, Balance, Compare>::template const_iterator<type>
+BST<T, Allocator, Balance, Compare>::nth(size_type index) {
+  return const_iterator<type>(this->tree_.Select(index), &this->tree_);
+}
+
+template <typename T, typename Allocator, typename Balance, typename Compare>
+template <IteratorType type, typename Generator>
+typename BST<T, Allocator, Balance, Compare>::template const_iterator<type>
+BST<T, Allocator, Balance, Compare>::sample(Generator& generator) {
+  if (this->tree_.GetSize() == 0) return cend<type>();
+
+  std::uniform_int_distribution<size_t> distribution(
+      0, this->tree_.GetSize() - 1);
+
+  return nth<type>(distribution(generator));
+}
+
+template <typename T, typename Allocator, typename Balance, typename Compare>
+typename BST<T, Allocator, Balance, Compare>::node_type
+BST<T, Allocator, Balance, Compare>::extract(const value_type& key) {
+  return this->tree_.Extract(key);
 }
 
-template <typename T, typename Allocator>
+template <typename T, typename Allocator, typename Balance, typename Compare>
 template <IteratorType type>
-typename BST<T, Allocator>::template const_reverse_iterator<
-    typename BST<T, Allocator>::template const_iterator<type>>
-BST<T, Allocator>::rbegin() {
+typename BST<T, Allocator, Balance, Compare>::node_type
+BST<T, Allocator, Balance, Compare>::extract(const_iterator<type> pos) {
+  if (pos.ptr_ == nullptr) return node_type();
+
+  return this->tree_.Extract(const_cast<tree_node*>(pos.ptr_));
+}
+
+template <typename T, typename Allocator, typename Balance, typename Compare>
+template <IteratorType type>
+std::pair<typename BST<T, Allocator, Balance, Compare>::template const_iterator<
+              type>,
+          bool>
+BST<T, Allocator, Balance, Compare>::insert(node_type&& node) {
+  std::pair<tree_node*, bool> result = this->tree_.Insert(std::move(node));
+
+  return std::make_pair(const_iterator<type>(result.first, &this->tree_),
+                        result.second);
+}
+
+template <typename T, typename Allocator, typename Balance, typename Compare>
+FrozenBST<T, Compare> BST<T, Allocator, Balance, Compare>::freeze() {
+  return FrozenBST<T, Compare>(cbegin<IteratorType::INORDER>(),
+                               cend<IteratorType::INORDER>(), key_comp());
+}
+
+template <typename T, typename Allocator, typename Balance, typename Compare>
+PersistentBST<T, Compare> BST<T, Allocator, Balance, Compare>::persist() {
+  return PersistentBST<T, Compare>(sorted_unique,
+                                   cbegin<IteratorType::INORDER>(),
+                                   cend<IteratorType::INORDER>(), key_comp());
+}
+
+template <typename T, typename Allocator, typename Balance, typename Compare>
+void BST<T, Allocator, Balance, Compare>::merge(
+    BST<T, Allocator, Balance, Compare>& source) {
+  this->tree_.Merge(source.tree_);
+}
+
+template <typename T, typename Allocator, typename Balance, typename Compare>
+template <ExecutionPolicy policy>
+void BST<T, Allocator, Balance, Compare>::set_union(
+    const BST<T, Allocator, Balance, Compare>& other) {
+  this->tree_.Union(other.tree_, policy);
+}
+
+template <typename T, typename Allocator, typename Balance, typename Compare>
+template <ExecutionPolicy policy>
+void BST<T, Allocator, Balance, Compare>::set_intersection(
+    const BST<T, Allocator, Balance, Compare>& other) {
+  this->tree_.Intersection(other.tree_, policy);
+}
+
+template <typename T, typename Allocator, typename Balance, typename Compare>
+template <ExecutionPolicy policy>
+void BST<T, Allocator, Balance, Compare>::set_difference(
+    const BST<T, Allocator, Balance, Compare>& other) {
+  this->tree_.Difference(other.tree_, policy);
+}
+
+template <ExecutionPolicy policy = ExecutionPolicy::SEQUENTIAL, typename T,
+          typename Allocator, typename Balance, typename Compare>
+BST<T, Allocator, Balance, Compare> set_union(
+    const BST<T, Allocator, Balance, Compare>& first,
+    const BST<T, Allocator, Balance, Compare>& second) {
+  BST<T, Allocator, Balance, Compare> result(first);
+  result.template set_union<policy>(second);
+
+  return result;
+}
+
+template <ExecutionPolicy policy = ExecutionPolicy::SEQUENTIAL, typename T,
+          typename Allocator, typename Balance, typename Compare>
+BST<T, Allocator, Balance, Compare> set_intersection(
+    const BST<T, Allocator, Balance, Compare>& first,
+    const BST<T, Allocator, Balance, Compare>& second) {
+  BST<T, Allocator, Balance, Compare> result(first);
+  result.template set_intersection<policy>(second);
+
+  return result;
+}
+
+template <ExecutionPolicy policy = ExecutionPolicy::SEQUENTIAL, typename T,
+          typename Allocator, typename Balance, typename Compare>
+BST<T, Allocator, Balance, Compare> set_difference(
+    const BST<T, Allocator, Balance, Compare>& first,
+    const BST<T, Allocator, Balance, Compare>& second) {
+  BST<T, Allocator, Balance, Compare> result(first);
+  result.template set_difference<policy>(second);
+
+  return result;
+}
+
+template <typename T, typename Allocator, typename Balance, typename Compare>
+template <IteratorType type>
+typename BST<T, Allocator, Balance, Compare>::template const_reverse_iterator<
+    typename BST<T, Allocator, Balance, Compare>::template const_iterator<type>>
+BST<T, Allocator, Balance, Compare>::rbegin() {
   if (type == IteratorType::INORDER) {
     if (this->tree_.GetRoot() == nullptr)
       return const_reverse_iterator<const_iterator<type>>(nullptr);
-    Node<T>* cur = this->tree_.GetRoot();
+    tree_node* cur = this->tree_.GetRoot();
 
     while (cur->right != nullptr) {
       cur = cur->right;
@@ -847,7 +1487,7 @@ BST<T, Allocator>::rbegin() {
 
     return const_reverse_iterator<const_iterator<type>>(cur);
   } else if (type == IteratorType::PREORDER) {
-    Node<T>* cur = this->tree_.GetRoot();
+    tree_node* cur = this->tree_.GetRoot();
     while (cur->left != nullptr || cur->right != nullptr) {
       cur = cur->right;
     }
@@ -858,31 +1498,31 @@ BST<T, Allocator>::rbegin() {
   }
 }
 
-template <typename T, typename Allocator>
+template <typename T, typename Allocator, typename Balance, typename Compare>
 template <IteratorType type>
-typename BST<T, Allocator>::template const_reverse_iterator<
-    typename BST<T, Allocator>::template const_iterator<type>>
-BST<T, Allocator>::crbegin() {
+typename BST<T, Allocator, Balance, Compare>::template const_reverse_iterator<
+    typename BST<T, Allocator, Balance, Compare>::template const_iterator<type>>
+BST<T, Allocator, Balance, Compare>::crbegin() {
   return rbegin<type>();
 }
 
-template <typename T, typename Allocator>
+template <typename T, typename Allocator, typename Balance, typename Compare>
 template <IteratorType type>
-typename BST<T, Allocator>::template const_reverse_iterator<
-    typename BST<T, Allocator>::template const_iterator<type>>
-BST<T, Allocator>::crend() {
+typename BST<T, Allocator, Balance, Compare>::template const_reverse_iterator<
+    typename BST<T, Allocator, Balance, Compare>::template const_iterator<type>>
+BST<T, Allocator, Balance, Compare>::crend() {
   return rend<type>();
 }
 
-template <typename T, typename Allocator>
+template <typename T, typename Allocator, typename Balance, typename Compare>
 template <IteratorType type>
-typename BST<T, Allocator>::template const_reverse_iterator<
-    typename BST<T, Allocator>::template const_iterator<type>>
-BST<T, Allocator>::rend() {
+typename BST<T, Allocator, Balance, Compare>::template const_reverse_iterator<
+    typename BST<T, Allocator, Balance, Compare>::template const_iterator<type>>
+BST<T, Allocator, Balance, Compare>::rend() {
   if (type == IteratorType::INORDER) {
     if (this->tree_.GetRoot() == nullptr)
       return const_reverse_iterator<const_iterator<type>>(nullptr);
-    Node<T>* cur = this->tree_.GetRoot();
+    tree_node* cur = this->tree_.GetRoot();
 
     while (cur->right != nullptr) {
       cur = cur->right;
@@ -897,8 +1537,8 @@ BST<T, Allocator>::rend() {
   }
 }
 
-template <typename T, typename Allocator>
-bool BST<T, Allocator>::operator==(BST& second) {
+template <typename T, typename Allocator, typename Balance, typename Compare>
+bool BST<T, Allocator, Balance, Compare>::operator==(BST& second) {
 if (this->size() != second.size()) return false;
   bool res = true;
   value_type* arr1 = new value_type[this->size()];
@@ -921,7 +1561,18 @@ if (this->size() != second.size()) return false;
   return res;
 }
 
-template <typename T, typename Allocator>
-bool BST<T, Allocator>::operator!=(const BST& second) {
+template <typename T, typename Allocator, typename Balance, typename Compare>
+bool BST<T, Allocator, Balance, Compare>::operator!=(const BST& second) {
   return !(*this == second);
 }
+
+#include "BTree.hpp"
+
+namespace pmr {
+
+template <typename T, typename Balance = Unbalanced,
+          typename Compare = std::less<T>>
+using BST =
+    ::BST<T, std::pmr::polymorphic_allocator<Node<T>>, Balance, Compare>;
+
+}  // namespace pmr
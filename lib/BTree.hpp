@@ -0,0 +1,1212 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <functional>
+#include <initializer_list>
+#include <iterator>
+#include <limits>
+#include <memory>
+#include <optional>
+#include <utility>
+
+#include "BST.hpp"
+#include "KeySearch.hpp"
+#include "Tree.hpp"
+
+template <typename T, typename Allocator = std::allocator<T>,
+          typename Compare = std::less<T>>
+class BTreeIndex {
+  typedef T value_type;
+  typedef size_t size_type;
+  typedef KeySearch<T, Compare> search_type;
+
+ public:
+  class Inner;
+
+  class NodeBase {
+   public:
+    Inner* parent = nullptr;
+    size_type count = 0;
+    bool leaf = true;
+  };
+
+  // Nodes start on a cache line and hold as many keys as fit in two lines
+  // next to their header, links and child pointers. Keys too large for that
+  // still get the minimum fan-out of four.
+  static constexpr size_type kNodeBytes = 128;
+
+  static constexpr size_type kLeafCapacity = std::max<size_type>(
+      4, (kNodeBytes - sizeof(NodeBase) - 2 * sizeof(void*)) / sizeof(T));
+  static constexpr size_type kInnerCapacity = std::max<size_type>(
+      4, (kNodeBytes - sizeof(NodeBase) - sizeof(NodeBase*)) /
+             (sizeof(T) + sizeof(NodeBase*)));
+
+  // Only keys[0, count) are constructed; the rest of the array is raw
+  // storage, so empty slots cost neither a constructor nor a destructor.
+  class alignas(64) Leaf : public NodeBase {
+   public:
+    Leaf() {}
+    ~Leaf() { std::destroy_n(keys, this->count); }
+
+    union {
+      T keys[kLeafCapacity];
+    };
+    Leaf* prev = nullptr;
+    Leaf* next = nullptr;
+  };
+
+  class alignas(64) Inner : public NodeBase {
+   public:
+    Inner() { this->leaf = false; }
+    ~Inner() { std::destroy_n(keys, this->count); }
+
+    union {
+      T keys[kInnerCapacity];
+    };
+    NodeBase* children[kInnerCapacity + 1];
+  };
+
+  struct Position {
+    Leaf* leaf;
+    size_type index;
+  };
+
+  typedef typename std::allocator_traits<Allocator>::template rebind_alloc<
+      Leaf>
+      leaf_allocator_type;
+  typedef typename std::allocator_traits<Allocator>::template rebind_alloc<
+      Inner>
+      inner_allocator_type;
+
+  typedef std::allocator_traits<leaf_allocator_type> leaf_allocator_traits;
+
+  BTreeIndex() = default;
+  explicit BTreeIndex(const Compare& compare) : compare_(compare) {}
+  BTreeIndex(const Compare& compare, const Allocator& allocator)
+      : leaf_allocator_(allocator), inner_allocator_(allocator),
+        compare_(compare) {}
+
+  BTreeIndex(const BTreeIndex& other) = delete;
+  BTreeIndex& operator=(const BTreeIndex& other) = delete;
+
+  BTreeIndex(BTreeIndex&& other) noexcept;
+  BTreeIndex& operator=(BTreeIndex&& other) noexcept(kStealsOnMove);
+
+  ~BTreeIndex() { Clear(); }
+
+  template <typename K>
+  Position Find(const K& key) const;
+
+  template <typename K>
+  Position LowerBound(const K& key) const;
+
+  template <typename K>
+  Position UpperBound(const K& key) const;
+
+  template <typename V>
+  std::pair<Position, bool> Insert(V&& value);
+
+  template <typename K>
+  size_type Erase(const K& key);
+
+  Position Erase(Position position);
+
+  void Clear();
+
+  void Copy(const BTreeIndex& other);
+
+  void Swap(BTreeIndex& other) noexcept;
+
+  size_type GetSize() const { return size_; }
+
+  Leaf* GetFirst() const { return first_; }
+
+  Leaf* GetLast() const { return last_; }
+
+  const Compare& GetCompare() const { return compare_; }
+
+  void SetCompare(const Compare& compare) { compare_ = compare; }
+
+  const leaf_allocator_type& GetAllocator() const { return leaf_allocator_; }
+
+ private:
+  static constexpr bool kStealsOnMove =
+      leaf_allocator_traits::propagate_on_container_move_assignment::value ||
+      leaf_allocator_traits::is_always_equal::value;
+
+  void Steal(BTreeIndex& other) noexcept;
+
+  template <typename K>
+  Leaf* Descend(const K& key) const;
+  template <typename V>
+  static void Emplace(T* keys, size_type count, size_type index, V&& value);
+  static void EraseAt(T* keys, size_type count, size_type index);
+  static void Relocate(T* first, T* last, T* destination);
+  template <typename V>
+  static void InsertAt(Leaf* leaf, size_type index, V&& value);
+  static void InsertChild(Inner* node, size_type index, T&& separator,
+                          NodeBase* right);
+  void InsertIntoParent(NodeBase* left, T separator, NodeBase* right);
+  static size_type ChildIndex(const Inner* parent, const NodeBase* child);
+  static void RemoveFromInner(Inner* node, size_type index);
+  Position RebalanceLeaf(Position position);
+  void RebalanceInner(Inner* node);
+  void MergeLeaves(Leaf* left, Leaf* right, Inner* parent, size_type index);
+  void MergeInners(Inner* left, Inner* right, Inner* parent, size_type index);
+  Leaf* NewLeaf();
+  Inner* NewInner();
+  void Free(NodeBase* node);
+  NodeBase* Clone(const NodeBase* node, Inner* parent, Leaf*& previous);
+
+  static constexpr size_type kLeafMinimum = kLeafCapacity / 2;
+  static constexpr size_type kInnerMinimum = kInnerCapacity / 2;
+
+  leaf_allocator_type leaf_allocator_;
+  inner_allocator_type inner_allocator_;
+  [[no_unique_address]] Compare compare_;
+
+  NodeBase* root_ = nullptr;
+  Leaf* first_ = nullptr;
+  Leaf* last_ = nullptr;
+  size_type size_ = 0;
+};
+
+template <typename T, typename Allocator, typename Compare>
+template <typename K>
+typename BTreeIndex<T, Allocator, Compare>::Leaf*
+BTreeIndex<T, Allocator, Compare>::Descend(const K& key) const {
+  NodeBase* node = root_;
+
+  while (!node->leaf) {
+    Inner* inner = static_cast<Inner*>(node);
+    node = inner->children[search_type::UpperBound(inner->keys, inner->count,
+                                                   key, compare_)];
+  }
+
+  return static_cast<Leaf*>(node);
+}
+
+template <typename T, typename Allocator, typename Compare>
+template <typename K>
+typename BTreeIndex<T, Allocator, Compare>::Position
+BTreeIndex<T, Allocator, Compare>::Find(const K& key) const {
+  if (root_ == nullptr) return Position{nullptr, 0};
+
+  Leaf* leaf = Descend(key);
+  size_type index =
+      search_type::LowerBound(leaf->keys, leaf->count, key, compare_);
+
+  if (index == leaf->count || compare_(key, leaf->keys[index])) {
+    return Position{nullptr, 0};
+  }
+
+  return Position{leaf, index};
+}
+
+template <typename T, typename Allocator, typename Compare>
+template <typename K>
+typename BTreeIndex<T, Allocator, Compare>::Position
+BTreeIndex<T, Allocator, Compare>::LowerBound(const K& key) const {
+  if (root_ == nullptr) return Position{nullptr, 0};
+
+  Leaf* leaf = Descend(key);
+  size_type index =
+      search_type::LowerBound(leaf->keys, leaf->count, key, compare_);
+
+  if (index == leaf->count) return Position{leaf->next, 0};
+
+  return Position{leaf, index};
+}
+
+template <typename T, typename Allocator, typename Compare>
+template <typename K>
+typename BTreeIndex<T, Allocator, Compare>::Position
+BTreeIndex<T, Allocator, Compare>::UpperBound(const K& key) const {
+  if (root_ == nullptr) return Position{nullptr, 0};
+
+  Leaf* leaf = Descend(key);
+  size_type index =
+      search_type::UpperBound(leaf->keys, leaf->count, key, compare_);
+
+  if (index == leaf->count) return Position{leaf->next, 0};
+
+  return Position{leaf, index};
+}
+
+template <typename T, typename Allocator, typename Compare>
+template <typename V>
+std::pair<typename BTreeIndex<T, Allocator, Compare>::Position, bool>
+BTreeIndex<T, Allocator, Compare>::Insert(V&& value) {
+  if (root_ == nullptr) {
+    Leaf* leaf = NewLeaf();
+    root_ = leaf;
+    first_ = leaf;
+    last_ = leaf;
+  }
+
+  Leaf* leaf = Descend(value);
+  size_type index =
+      search_type::LowerBound(leaf->keys, leaf->count, value, compare_);
+
+  if (index < leaf->count && !compare_(value, leaf->keys[index])) {
+    return std::make_pair(Position{leaf, index}, false);
+  }
+
+  ++size_;
+
+  if (leaf->count < kLeafCapacity) {
+    InsertAt(leaf, index, std::forward<V>(value));
+    return std::make_pair(Position{leaf, index}, true);
+  }
+
+  Leaf* right = NewLeaf();
+  size_type half = (kLeafCapacity + 1) / 2;
+  Position position;
+
+  if (index < half) {
+    Relocate(leaf->keys + half - 1, leaf->keys + kLeafCapacity, right->keys);
+    right->count = kLeafCapacity - half + 1;
+    leaf->count = half - 1;
+    InsertAt(leaf, index, std::forward<V>(value));
+    position = Position{leaf, index};
+  } else {
+    Relocate(leaf->keys + half, leaf->keys + kLeafCapacity, right->keys);
+    right->count = kLeafCapacity - half;
+    leaf->count = half;
+    InsertAt(right, index - half, std::forward<V>(value));
+    position = Position{right, index - half};
+  }
+
+  right->next = leaf->next;
+  right->prev = leaf;
+  if (leaf->next != nullptr) {
+    leaf->next->prev = right;
+  } else {
+    last_ = right;
+  }
+  leaf->next = right;
+
+  InsertIntoParent(leaf, right->keys[0], right);
+
+  return std::make_pair(position, true);
+}
+
+template <typename T, typename Allocator, typename Compare>
+template <typename V>
+void BTreeIndex<T, Allocator, Compare>::Emplace(T* keys, size_type count,
+                                                size_type index, V&& value) {
+  if (index == count) {
+    std::construct_at(keys + count, std::forward<V>(value));
+    return;
+  }
+
+  std::construct_at(keys + count, std::move(keys[count - 1]));
+  std::move_backward(keys + index, keys + count - 1, keys + count);
+  keys[index] = std::forward<V>(value);
+}
+
+template <typename T, typename Allocator, typename Compare>
+void BTreeIndex<T, Allocator, Compare>::EraseAt(T* keys, size_type count,
+                                                size_type index) {
+  std::move(keys + index + 1, keys + count, keys + index);
+  std::destroy_at(keys + count - 1);
+}
+
+template <typename T, typename Allocator, typename Compare>
+void BTreeIndex<T, Allocator, Compare>::Relocate(T* first, T* last,
+                                                 T* destination) {
+  std::uninitialized_move(first, last, destination);
+  std::destroy(first, last);
+}
+
+template <typename T, typename Allocator, typename Compare>
+template <typename V>
+void BTreeIndex<T, Allocator, Compare>::InsertAt(Leaf* leaf, size_type index,
+                                                 V&& value) {
+  Emplace(leaf->keys, leaf->count, index, std::forward<V>(value));
+  ++leaf->count;
+}
+
+template <typename T, typename Allocator, typename Compare>
+void BTreeIndex<T, Allocator, Compare>::InsertChild(Inner* node,
+                                                    size_type index,
+                                                    T&& separator,
+                                                    NodeBase* right) {
+  Emplace(node->keys, node->count, index, std::move(separator));
+  std::move_backward(node->children + index + 1,
+                     node->children + node->count + 1,
+                     node->children + node->count + 2);
+  node->children[index + 1] = right;
+  right->parent = node;
+  ++node->count;
+}
+
+template <typename T, typename Allocator, typename Compare>
+void BTreeIndex<T, Allocator, Compare>::InsertIntoParent(NodeBase* left,
+                                                         T separator,
+                                                         NodeBase* right) {
+  Inner* parent = left->parent;
+
+  if (parent == nullptr) {
+    Inner* root = NewInner();
+    std::construct_at(root->keys, std::move(separator));
+    root->children[0] = left;
+    root->children[1] = right;
+    root->count = 1;
+    left->parent = root;
+    right->parent = root;
+    root_ = root;
+
+    return;
+  }
+
+  size_type index = ChildIndex(parent, left);
+
+  if (parent->count < kInnerCapacity) {
+    InsertChild(parent, index, std::move(separator), right);
+
+    return;
+  }
+
+  // Split around the middle of the kInnerCapacity + 1 keys the node would
+  // hold, then place the new key on its side without a scratch copy.
+  size_type middle = (kInnerCapacity + 1) / 2;
+  Inner* sibling = NewInner();
+
+  if (index == middle) {
+    Relocate(parent->keys + middle, parent->keys + kInnerCapacity,
+             sibling->keys);
+    sibling->children[0] = right;
+    std::copy(parent->children + middle + 1,
+              parent->children + kInnerCapacity + 1, sibling->children + 1);
+    parent->count = middle;
+    sibling->count = kInnerCapacity - middle;
+
+    for (size_type i = 0; i <= sibling->count; ++i) {
+      sibling->children[i]->parent = sibling;
+    }
+
+    InsertIntoParent(parent, std::move(separator), sibling);
+
+    return;
+  }
+
+  size_type promoted = index < middle ? middle - 1 : middle;
+
+  Relocate(parent->keys + promoted + 1, parent->keys + kInnerCapacity,
+           sibling->keys);
+  std::copy(parent->children + promoted + 1,
+            parent->children + kInnerCapacity + 1, sibling->children);
+  sibling->count = kInnerCapacity - promoted - 1;
+
+  for (size_type i = 0; i <= sibling->count; ++i) {
+    sibling->children[i]->parent = sibling;
+  }
+
+  T key(std::move(parent->keys[promoted]));
+  std::destroy_at(parent->keys + promoted);
+  parent->count = promoted;
+
+  if (index < middle) {
+    InsertChild(parent, index, std::move(separator), right);
+  } else {
+    InsertChild(sibling, index - promoted - 1, std::move(separator), right);
+  }
+
+  InsertIntoParent(parent, std::move(key), sibling);
+}
+
+template <typename T, typename Allocator, typename Compare>
+typename BTreeIndex<T, Allocator, Compare>::size_type
+BTreeIndex<T, Allocator, Compare>::ChildIndex(const Inner* parent,
+                                              const NodeBase* child) {
+  size_type index = 0;
+  while (parent->children[index] != child) {
+    ++index;
+  }
+
+  return index;
+}
+
+template <typename T, typename Allocator, typename Compare>
+template <typename K>
+typename BTreeIndex<T, Allocator, Compare>::size_type
+BTreeIndex<T, Allocator, Compare>::Erase(const K& key) {
+  Position position = Find(key);
+  if (position.leaf == nullptr) return 0;
+
+  Erase(position);
+
+  return 1;
+}
+
+template <typename T, typename Allocator, typename Compare>
+typename BTreeIndex<T, Allocator, Compare>::Position
+BTreeIndex<T, Allocator, Compare>::Erase(Position position) {
+  Leaf* leaf = position.leaf;
+  EraseAt(leaf->keys, leaf->count, position.index);
+  --leaf->count;
+  --size_;
+
+  position = RebalanceLeaf(position);
+
+  if (position.leaf != nullptr && position.index == position.leaf->count) {
+    return Position{position.leaf->next, 0};
+  }
+
+  return position;
+}
+
+template <typename T, typename Allocator, typename Compare>
+void BTreeIndex<T, Allocator, Compare>::RemoveFromInner(Inner* node,
+                                                        size_type index) {
+  EraseAt(node->keys, node->count, index);
+  std::copy(node->children + index + 2, node->children + node->count + 1,
+            node->children + index + 1);
+  --node->count;
+}
+
+template <typename T, typename Allocator, typename Compare>
+typename BTreeIndex<T, Allocator, Compare>::Position
+BTreeIndex<T, Allocator, Compare>::RebalanceLeaf(Position position) {
+  Leaf* leaf = position.leaf;
+
+  if (leaf == root_) {
+    if (leaf->count == 0) {
+      Free(leaf);
+      root_ = nullptr;
+      first_ = nullptr;
+      last_ = nullptr;
+
+      return Position{nullptr, 0};
+    }
+
+    return position;
+  }
+
+  if (leaf->count >= kLeafMinimum) return position;
+
+  Inner* parent = leaf->parent;
+  size_type index = ChildIndex(parent, leaf);
+  Leaf* left =
+      index > 0 ? static_cast<Leaf*>(parent->children[index - 1]) : nullptr;
+  Leaf* right = index < parent->count
+                    ? static_cast<Leaf*>(parent->children[index + 1])
+                    : nullptr;
+
+  if (left != nullptr && left->count > kLeafMinimum) {
+    InsertAt(leaf, 0, std::move(left->keys[left->count - 1]));
+    std::destroy_at(left->keys + --left->count);
+    parent->keys[index - 1] = leaf->keys[0];
+    ++position.index;
+  } else if (right != nullptr && right->count > kLeafMinimum) {
+    InsertAt(leaf, leaf->count, std::move(right->keys[0]));
+    EraseAt(right->keys, right->count, 0);
+    --right->count;
+    parent->keys[index] = right->keys[0];
+  } else if (left != nullptr) {
+    position = Position{left, left->count + position.index};
+    MergeLeaves(left, leaf, parent, index - 1);
+  } else {
+    MergeLeaves(leaf, right, parent, index);
+  }
+
+  return position;
+}
+
+template <typename T, typename Allocator, typename Compare>
+void BTreeIndex<T, Allocator, Compare>::MergeLeaves(Leaf* left, Leaf* right,
+                                                    Inner* parent,
+                                                    size_type index) {
+  Relocate(right->keys, right->keys + right->count, left->keys + left->count);
+  left->count += right->count;
+  right->count = 0;
+
+  left->next = right->next;
+  if (right->next != nullptr) {
+    right->next->prev = left;
+  } else {
+    last_ = left;
+  }
+
+  RemoveFromInner(parent, index);
+  Free(right);
+  RebalanceInner(parent);
+}
+
+template <typename T, typename Allocator, typename Compare>
+void BTreeIndex<T, Allocator, Compare>::RebalanceInner(Inner* node) {
+  if (node == root_) {
+    if (node->count == 0) {
+      root_ = node->children[0];
+      root_->parent = nullptr;
+      Free(node);
+    }
+
+    return;
+  }
+
+  if (node->count >= kInnerMinimum) return;
+
+  Inner* parent = node->parent;
+  size_type index = ChildIndex(parent, node);
+  Inner* left =
+      index > 0 ? static_cast<Inner*>(parent->children[index - 1]) : nullptr;
+  Inner* right = index < parent->count
+                     ? static_cast<Inner*>(parent->children[index + 1])
+                     : nullptr;
+
+  if (left != nullptr && left->count > kInnerMinimum) {
+    Emplace(node->keys, node->count, 0, std::move(parent->keys[index - 1]));
+    std::copy_backward(node->children, node->children + node->count + 1,
+                       node->children + node->count + 2);
+    node->children[0] = left->children[left->count];
+    node->children[0]->parent = node;
+    ++node->count;
+
+    parent->keys[index - 1] = std::move(left->keys[left->count - 1]);
+    std::destroy_at(left->keys + --left->count);
+  } else if (right != nullptr && right->count > kInnerMinimum) {
+    std::construct_at(node->keys + node->count,
+                      std::move(parent->keys[index]));
+    node->children[node->count + 1] = right->children[0];
+    node->children[node->count + 1]->parent = node;
+    ++node->count;
+
+    parent->keys[index] = std::move(right->keys[0]);
+    EraseAt(right->keys, right->count, 0);
+    std::copy(right->children + 1, right->children + right->count + 1,
+              right->children);
+    --right->count;
+  } else if (left != nullptr) {
+    MergeInners(left, node, parent, index - 1);
+  } else {
+    MergeInners(node, right, parent, index);
+  }
+}
+
+template <typename T, typename Allocator, typename Compare>
+void BTreeIndex<T, Allocator, Compare>::MergeInners(Inner* left, Inner* right,
+                                                    Inner* parent,
+                                                    size_type index) {
+  std::construct_at(left->keys + left->count, std::move(parent->keys[index]));
+  Relocate(right->keys, right->keys + right->count,
+           left->keys + left->count + 1);
+  std::copy(right->children, right->children + right->count + 1,
+            left->children + left->count + 1);
+
+  for (size_type i = 0; i <= right->count; ++i) {
+    right->children[i]->parent = left;
+  }
+  left->count += right->count + 1;
+  right->count = 0;
+
+  RemoveFromInner(parent, index);
+  Free(right);
+  RebalanceInner(parent);
+}
+
+template <typename T, typename Allocator, typename Compare>
+typename BTreeIndex<T, Allocator, Compare>::Leaf*
+BTreeIndex<T, Allocator, Compare>::NewLeaf() {
+  Leaf* leaf = leaf_allocator_.allocate(1);
+  std::allocator_traits<leaf_allocator_type>::construct(leaf_allocator_, leaf);
+
+  return leaf;
+}
+
+template <typename T, typename Allocator, typename Compare>
+typename BTreeIndex<T, Allocator, Compare>::Inner*
+BTreeIndex<T, Allocator, Compare>::NewInner() {
+  Inner* inner = inner_allocator_.allocate(1);
+  std::allocator_traits<inner_allocator_type>::construct(inner_allocator_,
+                                                         inner);
+
+  return inner;
+}
+
+template <typename T, typename Allocator, typename Compare>
+void BTreeIndex<T, Allocator, Compare>::Free(NodeBase* node) {
+  if (node->leaf) {
+    Leaf* leaf = static_cast<Leaf*>(node);
+    std::allocator_traits<leaf_allocator_type>::destroy(leaf_allocator_, leaf);
+    leaf_allocator_.deallocate(leaf, 1);
+  } else {
+    Inner* inner = static_cast<Inner*>(node);
+    std::allocator_traits<inner_allocator_type>::destroy(inner_allocator_,
+                                                         inner);
+    inner_allocator_.deallocate(inner, 1);
+  }
+}
+
+template <typename T, typename Allocator, typename Compare>
+void BTreeIndex<T, Allocator, Compare>::Clear() {
+  NodeBase* node = root_;
+
+  // Frees the rightmost child of each node first and drops the key in front
+  // of it, so every node keeps exactly count live keys until it is freed.
+  while (node != nullptr) {
+    while (!node->leaf) {
+      Inner* inner = static_cast<Inner*>(node);
+      node = inner->children[inner->count];
+    }
+
+    Inner* parent = node->parent;
+    Free(node);
+
+    while (parent != nullptr && parent->count == 0) {
+      node = parent;
+      parent = node->parent;
+      Free(node);
+    }
+
+    if (parent == nullptr) break;
+
+    std::destroy_at(parent->keys + --parent->count);
+    node = parent->children[parent->count];
+  }
+
+  root_ = nullptr;
+  first_ = nullptr;
+  last_ = nullptr;
+  size_ = 0;
+}
+
+template <typename T, typename Allocator, typename Compare>
+BTreeIndex<T, Allocator, Compare>::BTreeIndex(BTreeIndex&& other) noexcept
+    : leaf_allocator_(other.leaf_allocator_),
+      inner_allocator_(other.inner_allocator_),
+      compare_(other.compare_) {
+  Steal(other);
+}
+
+template <typename T, typename Allocator, typename Compare>
+BTreeIndex<T, Allocator, Compare>&
+BTreeIndex<T, Allocator, Compare>::operator=(BTreeIndex&& other) noexcept(
+    kStealsOnMove) {
+  if (this == &other) return *this;
+
+  Clear();
+  compare_ = other.compare_;
+
+  if constexpr (leaf_allocator_traits::propagate_on_container_move_assignment::
+                    value) {
+    leaf_allocator_ = other.leaf_allocator_;
+    inner_allocator_ = other.inner_allocator_;
+  }
+
+  if (kStealsOnMove || leaf_allocator_ == other.leaf_allocator_) {
+    Steal(other);
+  } else {
+    Copy(other);
+  }
+
+  return *this;
+}
+
+template <typename T, typename Allocator, typename Compare>
+void BTreeIndex<T, Allocator, Compare>::Steal(BTreeIndex& other) noexcept {
+  root_ = std::exchange(other.root_, nullptr);
+  first_ = std::exchange(other.first_, nullptr);
+  last_ = std::exchange(other.last_, nullptr);
+  size_ = std::exchange(other.size_, 0);
+}
+
+template <typename T, typename Allocator, typename Compare>
+void BTreeIndex<T, Allocator, Compare>::Copy(const BTreeIndex& other) {
+  Clear();
+  compare_ = other.compare_;
+
+  if constexpr (leaf_allocator_traits::propagate_on_container_copy_assignment::
+                    value) {
+    leaf_allocator_ = other.leaf_allocator_;
+    inner_allocator_ = other.inner_allocator_;
+  }
+
+  if (other.root_ == nullptr) return;
+
+  Leaf* previous = nullptr;
+  root_ = Clone(other.root_, nullptr, previous);
+  last_ = previous;
+  size_ = other.size_;
+}
+
+template <typename T, typename Allocator, typename Compare>
+typename BTreeIndex<T, Allocator, Compare>::NodeBase*
+BTreeIndex<T, Allocator, Compare>::Clone(const NodeBase* node, Inner* parent,
+                                         Leaf*& previous) {
+  if (node->leaf) {
+    const Leaf* source = static_cast<const Leaf*>(node);
+    Leaf* leaf = NewLeaf();
+    std::uninitialized_copy(source->keys, source->keys + source->count,
+                            leaf->keys);
+    leaf->count = source->count;
+    leaf->parent = parent;
+    leaf->prev = previous;
+
+    if (previous == nullptr) {
+      first_ = leaf;
+    } else {
+      previous->next = leaf;
+    }
+    previous = leaf;
+
+    return leaf;
+  }
+
+  const Inner* source = static_cast<const Inner*>(node);
+  Inner* inner = NewInner();
+  std::uninitialized_copy(source->keys, source->keys + source->count,
+                          inner->keys);
+  inner->count = source->count;
+  inner->parent = parent;
+
+  for (size_type i = 0; i <= source->count; ++i) {
+    inner->children[i] = Clone(source->children[i], inner, previous);
+  }
+
+  return inner;
+}
+
+template <typename T, typename Allocator, typename Compare>
+void BTreeIndex<T, Allocator, Compare>::Swap(BTreeIndex& other) noexcept {
+  if constexpr (leaf_allocator_traits::propagate_on_container_swap::value) {
+    std::swap(leaf_allocator_, other.leaf_allocator_);
+    std::swap(inner_allocator_, other.inner_allocator_);
+  }
+  std::swap(compare_, other.compare_);
+  std::swap(root_, other.root_);
+  std::swap(first_, other.first_);
+  std::swap(last_, other.last_);
+  std::swap(size_, other.size_);
+}
+
+template <typename T, typename Allocator, typename Compare>
+class BST<T, Allocator, BTree, Compare> {
+  typedef T value_type;
+  typedef const T& const_reference;
+  typedef size_t size_type;
+  typedef Allocator allocator_type;
+  typedef Compare key_compare;
+  typedef Compare value_compare;
+  typedef BTreeIndex<T, Allocator, Compare> index_type;
+  typedef typename index_type::Leaf leaf_type;
+  typedef typename index_type::Position position_type;
+
+ public:
+  template <IteratorType type>
+  class const_iterator {
+    static_assert(type == IteratorType::INORDER,
+                  "BTree layout only supports in-order traversal.");
+
+   public:
+    typedef std::bidirectional_iterator_tag iterator_category;
+    typedef T value_type;
+    typedef std::ptrdiff_t difference_type;
+    typedef const T* pointer;
+    typedef const T& reference;
+
+    const_iterator() = default;
+    const_iterator(const index_type* index, position_type position)
+        : index_(index), leaf_(position.leaf), offset_(position.index) {}
+
+    const value_type& operator*() const { return leaf_->keys[offset_]; }
+    const value_type* operator->() const { return &leaf_->keys[offset_]; }
+
+    const_iterator& operator++();
+    const_iterator operator++(int);
+
+    const_iterator& operator--();
+    const_iterator operator--(int);
+
+    bool operator==(const const_iterator& other) const {
+      return leaf_ == other.leaf_ && offset_ == other.offset_;
+    }
+    bool operator!=(const const_iterator& other) const {
+      return !(*this == other);
+    }
+
+   private:
+    friend BST;
+
+    position_type Position() const {
+      return position_type{const_cast<leaf_type*>(leaf_), offset_};
+    }
+
+    const index_type* index_ = nullptr;
+    const leaf_type* leaf_ = nullptr;
+    size_type offset_ = 0;
+  };
+
+  template <typename It>
+  using const_reverse_iterator = std::reverse_iterator<It>;
+
+  class node_type {
+   public:
+    typedef T value_type;
+    typedef Allocator allocator_type;
+
+    node_type() = default;
+    node_type(node_type&& other) = default;
+    node_type& operator=(node_type&& other) = default;
+
+    bool empty() const { return !value_.has_value(); }
+
+    explicit operator bool() const { return value_.has_value(); }
+
+    value_type& value() const { return *value_; }
+
+   private:
+    friend BST;
+
+    explicit node_type(value_type&& value) : value_(std::move(value)) {}
+
+    mutable std::optional<value_type> value_;
+  };
+
+  BST() = default;
+  explicit BST(const Compare& compare) : index_(compare) {}
+  explicit BST(const allocator_type& allocator)
+      : index_(Compare(), allocator) {}
+  BST(const Compare& compare, const allocator_type& allocator)
+      : index_(compare, allocator) {}
+  BST(const BST& other)
+      : index_(other.index_.GetCompare(),
+               std::allocator_traits<allocator_type>::
+                   select_on_container_copy_construction(
+                       other.get_allocator())) {
+    index_.Copy(other.index_);
+  }
+  BST(const BST& other, const allocator_type& allocator)
+      : index_(other.index_.GetCompare(), allocator) {
+    index_.Copy(other.index_);
+  }
+  BST(BST&& other) noexcept : index_(std::move(other.index_)) {}
+  BST(const std::initializer_list<value_type>& ilist,
+      const allocator_type& allocator = allocator_type())
+      : index_(Compare(), allocator) {
+    insert(ilist);
+  }
+
+  template <class InputIt>
+  BST(InputIt first, InputIt last,
+      const allocator_type& allocator = allocator_type())
+      : index_(Compare(), allocator) {
+    insert(first, last);
+  }
+
+  BST& operator=(const BST& other) {
+    if (this != &other) index_.Copy(other.index_);
+
+    return *this;
+  }
+
+  BST& operator=(BST&& other) noexcept(
+      std::is_nothrow_move_assignable_v<index_type>) {
+    index_ = std::move(other.index_);
+
+    return *this;
+  }
+
+  BST& operator=(const std::initializer_list<value_type>& ilist) {
+    clear();
+    insert(ilist);
+
+    return *this;
+  }
+
+  template <IteratorType type>
+  const_iterator<type> begin() const {
+    return cbegin<type>();
+  }
+
+  template <IteratorType type>
+  const_iterator<type> end() const {
+    return cend<type>();
+  }
+
+  template <IteratorType type>
+  const_iterator<type> cbegin() const {
+    return const_iterator<type>(&index_, position_type{index_.GetFirst(), 0});
+  }
+
+  template <IteratorType type>
+  const_iterator<type> cend() const {
+    return const_iterator<type>(&index_, position_type{nullptr, 0});
+  }
+
+  template <IteratorType type>
+  const_reverse_iterator<const_iterator<type>> rbegin() const {
+    return const_reverse_iterator<const_iterator<type>>(cend<type>());
+  }
+
+  template <IteratorType type>
+  const_reverse_iterator<const_iterator<type>> rend() const {
+    return const_reverse_iterator<const_iterator<type>>(cbegin<type>());
+  }
+
+  template <IteratorType type>
+  const_reverse_iterator<const_iterator<type>> crbegin() const {
+    return rbegin<type>();
+  }
+
+  template <IteratorType type>
+  const_reverse_iterator<const_iterator<type>> crend() const {
+    return rend<type>();
+  }
+
+  size_type size() const { return index_.GetSize(); }
+
+  size_type max_size() const {
+    return std::numeric_limits<size_type>::max() / sizeof(value_type);
+  }
+
+  bool empty() const { return index_.GetSize() == 0; }
+
+  void clear() { index_.Clear(); }
+
+  void swap(BST& other) noexcept { index_.Swap(other.index_); }
+
+  friend void swap(BST& first, BST& second) noexcept { first.swap(second); }
+
+  allocator_type get_allocator() const {
+    return allocator_type(index_.GetAllocator());
+  }
+
+  key_compare key_comp() const { return index_.GetCompare(); }
+
+  value_compare value_comp() const { return index_.GetCompare(); }
+
+  template <IteratorType type>
+  std::pair<const_iterator<type>, bool> insert(const value_type& value) {
+    auto result = index_.Insert(value);
+
+    return std::make_pair(const_iterator<type>(&index_, result.first),
+                          result.second);
+  }
+
+  template <IteratorType type>
+  std::pair<const_iterator<type>, bool> insert(value_type&& value) {
+    auto result = index_.Insert(std::move(value));
+
+    return std::make_pair(const_iterator<type>(&index_, result.first),
+                          result.second);
+  }
+
+  template <class InputIt>
+  void insert(InputIt first, InputIt last) {
+    for (; first != last; ++first) {
+      index_.Insert(value_type(*first));
+    }
+  }
+
+  void insert(std::initializer_list<value_type> ilist) {
+    insert(ilist.begin(), ilist.end());
+  }
+
+  template <IteratorType type, typename... Args>
+  std::pair<const_iterator<type>, bool> emplace(Args&&... args) {
+    return insert<type>(value_type(std::forward<Args>(args)...));
+  }
+
+  template <IteratorType type, typename... Values>
+    requires(std::is_convertible_v<Values&&, value_type> && ...)
+  std::pair<const_iterator<type>, bool> insert_each(Values&&... values) {
+    std::pair<const_iterator<type>, bool> result(cend<type>(), false);
+    ((result = insert<type>(value_type(std::forward<Values>(values)))), ...);
+
+    return result;
+  }
+
+  template <IteratorType type>
+  const_iterator<type> erase(const_iterator<type> pos) {
+    if (pos == cend<type>()) return pos;
+
+    return const_iterator<type>(&index_, index_.Erase(pos.Position()));
+  }
+
+  template <IteratorType type>
+  const_iterator<type> erase(const_iterator<type> first,
+                             const_iterator<type> last) {
+    // Erasing shifts keys between neighbouring leaves, so last may not
+    // survive; count the range up front and erase that many from first.
+    size_type count = std::distance(first, last);
+    position_type position = first.Position();
+
+    for (; count > 0; --count) {
+      position = index_.Erase(position);
+    }
+
+    return const_iterator<type>(&index_, position);
+  }
+
+  size_type erase(const value_type& key) { return index_.Erase(key); }
+
+  size_type count(const value_type& key) const {
+    return index_.Find(key).leaf == nullptr ? 0 : 1;
+  }
+
+  template <typename K>
+    requires Transparent<Compare>
+  size_type count(const K& key) const {
+    return index_.Find(key).leaf == nullptr ? 0 : 1;
+  }
+
+  bool contains(const value_type& key) const {
+    return index_.Find(key).leaf != nullptr;
+  }
+
+  template <typename K>
+    requires Transparent<Compare>
+  bool contains(const K& key) const {
+    return index_.Find(key).leaf != nullptr;
+  }
+
+  template <IteratorType type>
+  const_iterator<type> find(const value_type& key) const {
+    return const_iterator<type>(&index_, index_.Find(key));
+  }
+
+  template <IteratorType type, typename K>
+    requires Transparent<Compare>
+  const_iterator<type> find(const K& key) const {
+    return const_iterator<type>(&index_, index_.Find(key));
+  }
+
+  template <IteratorType type>
+  const_iterator<type> lower_bound(const value_type& key) const {
+    return const_iterator<type>(&index_, index_.LowerBound(key));
+  }
+
+  template <IteratorType type, typename K>
+    requires Transparent<Compare>
+  const_iterator<type> lower_bound(const K& key) const {
+    return const_iterator<type>(&index_, index_.LowerBound(key));
+  }
+
+  template <IteratorType type>
+  std::pair<const_iterator<type>, const_iterator<type>> equal_range(
+      const value_type& key) const {
+    return EqualRange<type>(key);
+  }
+
+  template <IteratorType type, typename K>
+    requires Transparent<Compare>
+  std::pair<const_iterator<type>, const_iterator<type>> equal_range(
+      const K& key) const {
+    return EqualRange<type>(key);
+  }
+
+  node_type extract(const value_type& key) {
+    return extract(find<IteratorType::INORDER>(key));
+  }
+
+  template <IteratorType type>
+  node_type extract(const_iterator<type> pos) {
+    if (pos == cend<type>()) return node_type();
+
+    node_type node(std::move(const_cast<value_type&>(*pos)));
+    index_.Erase(pos.Position());
+
+    return node;
+  }
+
+  template <IteratorType type>
+  std::pair<const_iterator<type>, bool> insert(node_type&& node) {
+    if (node.empty()) return std::make_pair(cend<type>(), false);
+
+    auto result = index_.Insert(std::move(*node.value_));
+    if (result.second) node.value_.reset();
+
+    return std::make_pair(const_iterator<type>(&index_, result.first),
+                          result.second);
+  }
+
+  void merge(BST& source) {
+    if (this == &source) return;
+
+    auto it = source.cbegin<IteratorType::INORDER>();
+    while (it != source.cend<IteratorType::INORDER>()) {
+      if (index_.Insert(std::move(const_cast<value_type&>(*it))).second) {
+        it = source.erase(it);
+      } else {
+        ++it;
+      }
+    }
+  }
+
+  template <IteratorType type>
+  const_iterator<type> upper_bound(const value_type& key) const {
+    return const_iterator<type>(&index_, index_.UpperBound(key));
+  }
+
+  template <IteratorType type, typename K>
+    requires Transparent<Compare>
+  const_iterator<type> upper_bound(const K& key) const {
+    return const_iterator<type>(&index_, index_.UpperBound(key));
+  }
+
+ private:
+  template <IteratorType type, typename K>
+  std::pair<const_iterator<type>, const_iterator<type>> EqualRange(
+      const K& key) const {
+    const_iterator<type> first(&index_, index_.LowerBound(key));
+    const_iterator<type> last = first;
+
+    if (last != cend<type>() && !index_.GetCompare()(key, *last)) ++last;
+
+    return std::make_pair(first, last);
+  }
+
+  index_type index_;
+};
+
+template <typename T, typename Allocator, typename Compare>
+template <IteratorType type>
+typename BST<T, Allocator, BTree, Compare>::template const_iterator<type>&
+BST<T, Allocator, BTree, Compare>::const_iterator<type>::operator++() {
+  if (++offset_ == leaf_->count) {
+    leaf_ = leaf_->next;
+    offset_ = 0;
+  }
+
+  return *this;
+}
+
+template <typename T, typename Allocator, typename Compare>
+template <IteratorType type>
+typename BST<T, Allocator, BTree, Compare>::template const_iterator<type>
+BST<T, Allocator, BTree, Compare>::const_iterator<type>::operator++(int) {
+  const_iterator temp = *this;
+  ++*this;
+
+  return temp;
+}
+
+template <typename T, typename Allocator, typename Compare>
+template <IteratorType type>
+typename BST<T, Allocator, BTree, Compare>::template const_iterator<type>&
+BST<T, Allocator, BTree, Compare>::const_iterator<type>::operator--() {
+  if (leaf_ == nullptr) {
+    leaf_ = index_->GetLast();
+    offset_ = leaf_->count - 1;
+  } else if (offset_ == 0) {
+    leaf_ = leaf_->prev;
+    offset_ = leaf_->count - 1;
+  } else {
+    --offset_;
+  }
+
+  return *this;
+}
+
+template <typename T, typename Allocator, typename Compare>
+template <IteratorType type>
+typename BST<T, Allocator, BTree, Compare>::template const_iterator<type>
+BST<T, Allocator, BTree, Compare>::const_iterator<type>::operator--(int) {
+  const_iterator temp = *this;
+  --*this;
+
+  return temp;
+}
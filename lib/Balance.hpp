@@ -0,0 +1,589 @@
+#pragma once
+#include <cstddef>
+#include <type_traits>
+
+template <typename NodeType>
+struct Unlinked {
+  NodeType* child;
+  NodeType* parent;
+  signed char balance;
+};
+
+class BalanceBase {
+ public:
+  static constexpr bool kCounted = false;
+  static constexpr bool kCompact = false;
+  static constexpr bool kThreaded = false;
+
+  template <typename Link>
+  static size_t Count(const Link& node) {
+    return node == nullptr ? 0 : node->count;
+  }
+
+  template <typename NodeType>
+  static void UpdateCount(NodeType* node) {
+    if constexpr (NodeType::kCounted) {
+      node->count = 1 + Count(node->left) + Count(node->right);
+    }
+  }
+
+  // A rank is whatever Join needs to know about a subtree's height that the
+  // node does not store. Every child of a node has the same rank, so callers
+  // walking a path can carry ranks instead of recomputing them.
+  template <typename NodeType>
+  static int Rank(const NodeType*) {
+    return 0;
+  }
+
+  template <typename NodeType>
+  static int RankAbove(const NodeType*, int) {
+    return 0;
+  }
+
+ protected:
+  template <typename NodeType>
+  static void Replace(NodeType*& root, NodeType* old_node,
+                      NodeType* new_node) {
+    if (old_node->parent == nullptr) {
+      root = new_node;
+    } else if (old_node == old_node->parent->left) {
+      old_node->parent->left = new_node;
+    } else {
+      old_node->parent->right = new_node;
+    }
+  }
+
+  template <typename NodeType>
+  static void RotateLeft(NodeType*& root, NodeType* node) {
+    NodeType* pivot = node->right;
+
+    node->right = pivot->left;
+    if (pivot->left != nullptr) {
+      pivot->left->parent = node;
+    }
+
+    pivot->parent = node->parent;
+    Replace(root, node, pivot);
+
+    pivot->left = node;
+    node->parent = pivot;
+
+    UpdateCount(node);
+    UpdateCount(pivot);
+  }
+
+  template <typename NodeType>
+  static void RotateRight(NodeType*& root, NodeType* node) {
+    NodeType* pivot = node->left;
+
+    node->left = pivot->right;
+    if (pivot->right != nullptr) {
+      pivot->right->parent = node;
+    }
+
+    pivot->parent = node->parent;
+    Replace(root, node, pivot);
+
+    pivot->right = node;
+    node->parent = pivot;
+
+    UpdateCount(node);
+    UpdateCount(pivot);
+  }
+
+  template <typename NodeType>
+  static Unlinked<NodeType> Unlink(NodeType*& root, NodeType* node) {
+    Unlinked<NodeType> result = Detach(root, node);
+
+    if constexpr (NodeType::kCounted) {
+      for (NodeType* cur = result.parent; cur != nullptr; cur = cur->parent) {
+        UpdateCount(cur);
+      }
+    }
+
+    return result;
+  }
+
+  template <typename NodeType>
+  static NodeType* Attach(NodeType* left, NodeType* key, NodeType* right) {
+    key->parent = nullptr;
+    key->left = left;
+    key->right = right;
+
+    if (left != nullptr) {
+      left->parent = key;
+    }
+    if (right != nullptr) {
+      right->parent = key;
+    }
+
+    UpdateCount(key);
+
+    return key;
+  }
+
+  template <typename NodeType>
+  static void Graft(NodeType* parent, NodeType* node, bool left) {
+    node->parent = parent;
+    if (left) {
+      parent->left = node;
+    } else {
+      parent->right = node;
+    }
+
+    if constexpr (NodeType::kCounted) {
+      for (NodeType* cur = parent; cur != nullptr; cur = cur->parent) {
+        UpdateCount(cur);
+      }
+    }
+  }
+
+ private:
+  template <typename NodeType>
+  static Unlinked<NodeType> Detach(NodeType*& root, NodeType* node) {
+    Unlinked<NodeType> result{nullptr, node->parent, node->balance};
+
+    if (node->left == nullptr || node->right == nullptr) {
+      result.child = (node->left == nullptr) ? node->right : node->left;
+      Replace(root, node, result.child);
+
+      if (result.child != nullptr) {
+        result.child->parent = node->parent;
+      }
+
+      return result;
+    }
+
+    NodeType* successor = node->right;
+    while (successor->left != nullptr) {
+      successor = successor->left;
+    }
+
+    result.child = successor->right;
+    result.balance = successor->balance;
+
+    if (successor->parent == node) {
+      result.parent = successor;
+    } else {
+      result.parent = successor->parent;
+      result.parent->left = result.child;
+
+      if (result.child != nullptr) {
+        result.child->parent = result.parent;
+      }
+
+      successor->right = node->right;
+      successor->right->parent = successor;
+    }
+
+    Replace(root, node, successor);
+    successor->parent = node->parent;
+    successor->left = node->left;
+    successor->left->parent = successor;
+    successor->balance = node->balance;
+
+    return result;
+  }
+};
+
+class Unbalanced : public BalanceBase {
+ public:
+  template <typename NodeType>
+  static void InsertFixup(NodeType*&, NodeType*) {}
+
+  template <typename NodeType>
+  static void Erase(NodeType*& root, NodeType* node) {
+    Unlink(root, node);
+  }
+
+  template <typename NodeType>
+  static void OnBuild(NodeType* node, int, int) {
+    node->balance = 0;
+  }
+
+  template <typename NodeType>
+  static NodeType* Join(NodeType* left, NodeType* key, NodeType* right) {
+    key->balance = 0;
+
+    return Attach(left, key, right);
+  }
+
+  template <typename NodeType>
+  static NodeType* Join(NodeType* left, NodeType* key, NodeType* right, int,
+                        int, int&) {
+    return Join(left, key, right);
+  }
+};
+
+class RedBlack : public BalanceBase {
+ public:
+  static constexpr signed char kRed = 0;
+  static constexpr signed char kBlack = 1;
+
+  template <typename NodeType>
+  static void InsertFixup(NodeType*& root, NodeType* node) {
+    Repaint(root, node);
+    root->balance = kBlack;
+  }
+
+  template <typename NodeType>
+  static void Erase(NodeType*& root, NodeType* node) {
+    Unlinked<NodeType> unlinked = Unlink(root, node);
+    if (unlinked.balance == kRed) return;
+
+    NodeType* child = unlinked.child;
+    NodeType* parent = unlinked.parent;
+
+    while (child != root && !IsRed(child)) {
+      if (child == parent->left) {
+        NodeType* sibling = parent->right;
+
+        if (IsRed(sibling)) {
+          sibling->balance = kBlack;
+          parent->balance = kRed;
+          RotateLeft(root, parent);
+          sibling = parent->right;
+        }
+
+        if (!IsRed(sibling->left) && !IsRed(sibling->right)) {
+          sibling->balance = kRed;
+          child = parent;
+          parent = parent->parent;
+          continue;
+        }
+
+        if (!IsRed(sibling->right)) {
+          sibling->left->balance = kBlack;
+          sibling->balance = kRed;
+          RotateRight(root, sibling);
+          sibling = parent->right;
+        }
+
+        sibling->balance = parent->balance;
+        parent->balance = kBlack;
+        sibling->right->balance = kBlack;
+        RotateLeft(root, parent);
+        child = root;
+      } else {
+        NodeType* sibling = parent->left;
+
+        if (IsRed(sibling)) {
+          sibling->balance = kBlack;
+          parent->balance = kRed;
+          RotateRight(root, parent);
+          sibling = parent->left;
+        }
+
+        if (!IsRed(sibling->left) && !IsRed(sibling->right)) {
+          sibling->balance = kRed;
+          child = parent;
+          parent = parent->parent;
+          continue;
+        }
+
+        if (!IsRed(sibling->left)) {
+          sibling->right->balance = kBlack;
+          sibling->balance = kRed;
+          RotateLeft(root, sibling);
+          sibling = parent->left;
+        }
+
+        sibling->balance = parent->balance;
+        parent->balance = kBlack;
+        sibling->left->balance = kBlack;
+        RotateRight(root, parent);
+        child = root;
+      }
+    }
+
+    if (child != nullptr) {
+      child->balance = kBlack;
+    }
+  }
+
+  template <typename NodeType>
+  static void OnBuild(NodeType* node, int depth, int max_depth) {
+    node->balance = (depth == max_depth && depth > 0) ? kRed : kBlack;
+  }
+
+  template <typename NodeType>
+  static NodeType* Join(NodeType* left, NodeType* key, NodeType* right) {
+    int rank;
+
+    return Join(left, key, right, Rank(left), Rank(right), rank);
+  }
+
+  // Joins trees of the given black heights and reports the result's, so
+  // Split pays only for the height difference at each step.
+  template <typename NodeType>
+  static NodeType* Join(NodeType* left, NodeType* key, NodeType* right,
+                        int left_height, int right_height, int& height) {
+    if (IsRed(left)) {
+      left->balance = kBlack;
+      ++left_height;
+    }
+    if (IsRed(right)) {
+      right->balance = kBlack;
+      ++right_height;
+    }
+
+    if (left_height == right_height) {
+      key->balance = kBlack;
+      height = left_height + 1;
+      return Attach(left, key, right);
+    }
+
+    bool taller_left = left_height > right_height;
+    NodeType* root = taller_left ? left : right;
+    NodeType* shorter = taller_left ? right : left;
+    int target = taller_left ? right_height : left_height;
+    height = taller_left ? left_height : right_height;
+
+    int depth = height;
+    NodeType* parent = nullptr;
+    NodeType* cur = root;
+    while (cur != nullptr && (IsRed(cur) || depth != target)) {
+      if (!IsRed(cur)) --depth;
+      parent = cur;
+      cur = taller_left ? cur->right : cur->left;
+    }
+
+    if (taller_left) {
+      Attach(cur, key, shorter);
+    } else {
+      Attach(shorter, key, cur);
+    }
+    Graft(parent, key, !taller_left);
+    Repaint(root, key);
+
+    if (IsRed(root)) {
+      root->balance = kBlack;
+      ++height;
+    }
+
+    return root;
+  }
+
+  template <typename NodeType>
+  static int Rank(const NodeType* node) {
+    int height = 0;
+
+    for (; node != nullptr; node = node->left) {
+      if (!IsRed(node)) ++height;
+    }
+
+    return height;
+  }
+
+  template <typename NodeType>
+  static int RankAbove(const NodeType* node, int height) {
+    return IsRed(node) ? height : height + 1;
+  }
+
+ private:
+  // Restores the red rule above a new red node. The root may be left red.
+  template <typename NodeType>
+  static void Repaint(NodeType*& root, NodeType* node) {
+    node->balance = kRed;
+
+    while (node != root && IsRed(node->parent)) {
+      NodeType* parent = node->parent;
+      NodeType* grandparent = parent->parent;
+
+      if (parent == grandparent->left) {
+        NodeType* uncle = grandparent->right;
+
+        if (IsRed(uncle)) {
+          parent->balance = kBlack;
+          uncle->balance = kBlack;
+          grandparent->balance = kRed;
+          node = grandparent;
+          continue;
+        }
+
+        if (node == parent->right) {
+          RotateLeft(root, parent);
+          node = parent;
+          parent = node->parent;
+        }
+
+        parent->balance = kBlack;
+        grandparent->balance = kRed;
+        RotateRight(root, grandparent);
+      } else {
+        NodeType* uncle = grandparent->left;
+
+        if (IsRed(uncle)) {
+          parent->balance = kBlack;
+          uncle->balance = kBlack;
+          grandparent->balance = kRed;
+          node = grandparent;
+          continue;
+        }
+
+        if (node == parent->left) {
+          RotateRight(root, parent);
+          node = parent;
+          parent = node->parent;
+        }
+
+        parent->balance = kBlack;
+        grandparent->balance = kRed;
+        RotateLeft(root, grandparent);
+      }
+    }
+  }
+
+  template <typename Link>
+  static bool IsRed(const Link& node) {
+    return node != nullptr && node->balance == kRed;
+  }
+};
+
+class AVL : public BalanceBase {
+ public:
+  template <typename NodeType>
+  static void InsertFixup(NodeType*& root, NodeType* node) {
+    node->balance = 1;
+
+    for (NodeType* cur = node->parent; cur != nullptr; cur = cur->parent) {
+      signed char old_height = cur->balance;
+      cur = Rebalance(root, cur);
+
+      if (cur->balance == old_height) break;
+    }
+  }
+
+  template <typename NodeType>
+  static void Erase(NodeType*& root, NodeType* node) {
+    Unlinked<NodeType> unlinked = Unlink(root, node);
+
+    for (NodeType* cur = unlinked.parent; cur != nullptr; cur = cur->parent) {
+      cur = Rebalance(root, cur);
+    }
+  }
+
+  template <typename NodeType>
+  static void OnBuild(NodeType* node, int, int) {
+    UpdateHeight(node);
+  }
+
+  template <typename NodeType>
+  static NodeType* Join(NodeType* left, NodeType* key, NodeType* right) {
+    int difference = Height(left) - Height(right);
+
+    if (difference >= -1 && difference <= 1) {
+      Attach(left, key, right);
+      UpdateHeight(key);
+      return key;
+    }
+
+    bool taller_left = difference > 0;
+    NodeType* root = taller_left ? left : right;
+    NodeType* shorter = taller_left ? right : left;
+
+    NodeType* parent = nullptr;
+    NodeType* cur = root;
+    while (Height(cur) > Height(shorter) + 1) {
+      parent = cur;
+      cur = taller_left ? cur->right : cur->left;
+    }
+
+    if (taller_left) {
+      Attach(cur, key, shorter);
+    } else {
+      Attach(shorter, key, cur);
+    }
+    UpdateHeight(key);
+    Graft(parent, key, !taller_left);
+
+    for (cur = parent; cur != nullptr; cur = cur->parent) {
+      cur = Rebalance(root, cur);
+    }
+
+    return root;
+  }
+
+  template <typename NodeType>
+  static NodeType* Join(NodeType* left, NodeType* key, NodeType* right, int,
+                        int, int&) {
+    return Join(left, key, right);
+  }
+
+ private:
+  template <typename Link>
+  static signed char Height(const Link& node) {
+    return node == nullptr ? 0 : node->balance;
+  }
+
+  template <typename NodeType>
+  static void UpdateHeight(NodeType* node) {
+    signed char left = Height(node->left);
+    signed char right = Height(node->right);
+    node->balance = (left > right ? left : right) + 1;
+  }
+
+  template <typename NodeType>
+  static void Rotate(NodeType*& root, std::type_identity_t<NodeType*> node,
+                     bool left) {
+    NodeType* pivot = left ? node->right : node->left;
+
+    if (left) {
+      RotateLeft(root, node);
+    } else {
+      RotateRight(root, node);
+    }
+
+    UpdateHeight(node);
+    UpdateHeight(pivot);
+  }
+
+  template <typename NodeType>
+  static NodeType* Rebalance(NodeType*& root, NodeType* node) {
+    UpdateHeight(node);
+    int factor = Height(node->left) - Height(node->right);
+
+    if (factor > 1) {
+      if (Height(node->left->left) < Height(node->left->right)) {
+        Rotate(root, node->left, true);
+      }
+      Rotate(root, node, false);
+
+      return node->parent;
+    }
+
+    if (factor < -1) {
+      if (Height(node->right->right) < Height(node->right->left)) {
+        Rotate(root, node->right, false);
+      }
+      Rotate(root, node, true);
+
+      return node->parent;
+    }
+
+    return node;
+  }
+};
+
+template <typename Balance>
+class OrderStatistics : public Balance {
+ public:
+  static constexpr bool kCounted = true;
+};
+
+template <typename Balance>
+class Compact : public Balance {
+ public:
+  static constexpr bool kCompact = true;
+};
+
+template <typename Balance>
+class Threaded : public Balance {
+ public:
+  static constexpr bool kThreaded = true;
+};
+
+class BTree {
+ public:
+  static constexpr bool kCounted = false;
+};
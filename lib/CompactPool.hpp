@@ -0,0 +1,257 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <mutex>
+#include <new>
+#include <thread>
+#include <type_traits>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+template <typename T>
+class CompactPool {
+  typedef size_t size_type;
+
+ public:
+  typedef uint32_t index_type;
+
+  static T* Allocate() {
+    std::call_once(reserved_, Reserve);
+    Enter();
+
+    index_type index = Pop();
+    if (index != 0) return reinterpret_cast<T*>(base_ + index);
+
+    size_type cursor = cursor_.load(std::memory_order_relaxed);
+    do {
+      if (cursor == capacity_) {
+        live_.fetch_sub(1, std::memory_order_release);
+        throw std::bad_alloc();
+      }
+    } while (!cursor_.compare_exchange_weak(cursor, cursor + 1,
+                                            std::memory_order_relaxed));
+
+    return reinterpret_cast<T*>(base_ + cursor);
+  }
+
+  static void Deallocate(T* ptr) {
+    Push(Index(ptr));
+
+    if (live_.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+      Trim();
+    }
+  }
+
+  static T* Get(index_type index) {
+    return index == 0 ? nullptr : reinterpret_cast<T*>(base_ + index);
+  }
+
+  static index_type Index(const T* ptr) {
+    if (ptr == nullptr) return 0;
+
+    return static_cast<index_type>(reinterpret_cast<const Slot*>(ptr) - base_);
+  }
+
+ private:
+  struct Slot {
+    alignas(T) unsigned char storage[sizeof(T)];
+  };
+
+  static constexpr size_type kMaxCapacity =
+      size_type(std::numeric_limits<index_type>::max()) + 1;
+  static constexpr size_type kMinCapacity = 1 << 16;
+  static constexpr size_type kTrimSlots = 1 << 12;
+  static constexpr size_type kTrimming =
+      size_type(1) << (std::numeric_limits<size_type>::digits - 1);
+
+  // The free list head packs a slot index with a tag bumped on every update,
+  // so a pop that raced with a pop and push of the same slot fails its CAS.
+  // Links live in a side array rather than in the freed slot, so a stale pop
+  // never reads memory that a new owner is already writing.
+  static uint64_t Pack(index_type index, uint64_t head) {
+    return ((head >> 32) + 1) << 32 | index;
+  }
+
+  static std::atomic<index_type>& Next(index_type index) {
+    return links_[index];
+  }
+
+  static index_type Pop() {
+    uint64_t head = free_head_.load(std::memory_order_acquire);
+
+    while (index_type(head) != 0) {
+      index_type next = Next(index_type(head)).load(std::memory_order_relaxed);
+      if (free_head_.compare_exchange_weak(head, Pack(next, head),
+                                           std::memory_order_acquire)) {
+        return index_type(head);
+      }
+    }
+
+    return 0;
+  }
+
+  static void Push(index_type index) {
+    uint64_t head = free_head_.load(std::memory_order_relaxed);
+
+    do {
+      Next(index).store(index_type(head), std::memory_order_relaxed);
+    } while (!free_head_.compare_exchange_weak(head, Pack(index, head),
+                                               std::memory_order_release,
+                                               std::memory_order_relaxed));
+  }
+
+  // Counts the allocation before it touches the pool. A trim in progress
+  // owns the pool exclusively, so wait it out.
+  static void Enter() {
+    while (live_.fetch_add(1, std::memory_order_acq_rel) & kTrimming) {
+      live_.fetch_sub(1, std::memory_order_relaxed);
+
+      while (live_.load(std::memory_order_acquire) & kTrimming) {
+        std::this_thread::yield();
+      }
+    }
+  }
+
+  // Once the last node is freed, hands the touched pages back to the OS and
+  // restarts the pool from an empty free list.
+  static void Trim() {
+    if (cursor_.load(std::memory_order_relaxed) < kTrimSlots) return;
+
+    size_type expected = 0;
+    if (!live_.compare_exchange_strong(expected, kTrimming,
+                                       std::memory_order_acquire)) {
+      return;
+    }
+
+#if defined(__unix__) || defined(__APPLE__)
+    size_type used = cursor_.load(std::memory_order_relaxed);
+    Release(base_, used * sizeof(Slot), capacity_ * sizeof(Slot));
+    Release(links_, used * sizeof(std::atomic<index_type>),
+            capacity_ * sizeof(std::atomic<index_type>));
+#endif
+
+    free_head_.store(0, std::memory_order_relaxed);
+    cursor_.store(1, std::memory_order_relaxed);
+    live_.fetch_sub(kTrimming, std::memory_order_release);
+  }
+
+#if defined(__unix__) || defined(__APPLE__)
+  static void Release(void* memory, size_type used, size_type mapped) {
+    size_type page = size_type(sysconf(_SC_PAGESIZE));
+    madvise(memory, std::min((used + page - 1) / page * page, mapped),
+            MADV_DONTNEED);
+  }
+#endif
+
+  static void* Map(size_type bytes) {
+#if defined(__unix__) || defined(__APPLE__)
+    void* memory = mmap(nullptr, bytes, PROT_READ | PROT_WRITE,
+                        MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    return memory == MAP_FAILED ? nullptr : memory;
+#else
+    return ::operator new(bytes, std::align_val_t(alignof(Slot)),
+                          std::nothrow);
+#endif
+  }
+
+  static void Unmap(void* memory, size_type bytes) {
+#if defined(__unix__) || defined(__APPLE__)
+    munmap(memory, bytes);
+#else
+    ::operator delete(memory, bytes, std::align_val_t(alignof(Slot)));
+#endif
+  }
+
+  static void Reserve() {
+    for (size_type capacity = kMaxCapacity; capacity >= kMinCapacity;
+         capacity /= 2) {
+      void* slots = Map(capacity * sizeof(Slot));
+      if (slots == nullptr) continue;
+
+      void* links = Map(capacity * sizeof(std::atomic<index_type>));
+      if (links == nullptr) {
+        Unmap(slots, capacity * sizeof(Slot));
+        continue;
+      }
+
+      base_ = static_cast<Slot*>(slots);
+      links_ = static_cast<std::atomic<index_type>*>(links);
+      capacity_ = capacity;
+
+      return;
+    }
+
+    throw std::bad_alloc();
+  }
+
+  static inline Slot* base_ = nullptr;
+  static inline std::atomic<index_type>* links_ = nullptr;
+  static inline size_type capacity_ = 0;
+  static inline std::once_flag reserved_;
+  static inline std::atomic<size_type> cursor_ = 1;
+  static inline std::atomic<uint64_t> free_head_ = 0;
+  static inline std::atomic<size_type> live_ = 0;
+};
+
+template <typename NodeType>
+class CompactLink {
+  typedef CompactPool<NodeType> pool_type;
+
+ public:
+  CompactLink() = default;
+  CompactLink(std::nullptr_t) {}
+  CompactLink(NodeType* node) : index_(pool_type::Index(node)) {}
+
+  CompactLink& operator=(NodeType* node) {
+    index_ = pool_type::Index(node);
+
+    return *this;
+  }
+
+  operator NodeType*() const { return pool_type::Get(index_); }
+
+  NodeType* operator->() const { return pool_type::Get(index_); }
+
+  NodeType& operator*() const { return *pool_type::Get(index_); }
+
+ private:
+  typename pool_type::index_type index_ = 0;
+};
+
+template <typename T>
+class CompactAllocator {
+ public:
+  typedef T value_type;
+  typedef size_t size_type;
+  typedef std::true_type is_always_equal;
+
+  CompactAllocator() = default;
+
+  template <typename U>
+  CompactAllocator(const CompactAllocator<U>& other) {}
+
+  T* allocate(size_type count) {
+    if (count == 1) return CompactPool<T>::Allocate();
+
+    return static_cast<T*>(
+        ::operator new(count * sizeof(T), std::align_val_t(alignof(T))));
+  }
+
+  void deallocate(T* ptr, size_type count) {
+    if (count == 1) {
+      CompactPool<T>::Deallocate(ptr);
+    } else {
+      ::operator delete(ptr, count * sizeof(T), std::align_val_t(alignof(T)));
+    }
+  }
+
+  bool operator==(const CompactAllocator& other) const { return true; }
+
+  bool operator!=(const CompactAllocator& other) const { return false; }
+};
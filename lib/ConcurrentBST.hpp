@@ -0,0 +1,440 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <utility>
+#include <vector>
+
+#include "Epoch.hpp"
+#include "KeySearch.hpp"
+
+template <typename T, typename Compare = std::less<T>,
+          typename Allocator = std::allocator<T>>
+class ConcurrentBST {
+  typedef T value_type;
+  typedef size_t size_type;
+
+  struct Node {
+    template <typename V>
+    Node(V&& value_, const Node* left_, const Node* right_)
+        : value(std::forward<V>(value_)), left(left_), right(right_),
+          height(std::max(Height(left_), Height(right_)) + 1) {}
+
+    const value_type value;
+    const Node* const left;
+    const Node* const right;
+    const int height;
+  };
+
+  typedef typename std::allocator_traits<Allocator>::template rebind_alloc<
+      Node>
+      node_allocator_type;
+  typedef std::allocator_traits<node_allocator_type> node_allocator_traits;
+
+ public:
+  ConcurrentBST() = default;
+  explicit ConcurrentBST(const Compare& compare) : compare_(compare) {}
+
+  ConcurrentBST(const ConcurrentBST& other) = delete;
+  ConcurrentBST& operator=(const ConcurrentBST& other) = delete;
+
+  ~ConcurrentBST();
+
+  template <typename V>
+  bool insert(V&& value);
+
+  template <typename K>
+  size_type erase(const K& key);
+
+  template <typename K>
+  bool contains(const K& key) const;
+
+  template <typename K>
+  std::optional<value_type> find(const K& key) const;
+
+  template <typename K>
+  std::optional<value_type> lower_bound(const K& key) const;
+
+  template <typename Function>
+  void for_each(Function&& function) const;
+
+  size_type size() const { return size_.load(std::memory_order_relaxed); }
+
+  bool empty() const { return size() == 0; }
+
+ private:
+  struct Probe {
+    const Node* match;
+    const Node* above;
+  };
+
+  static constexpr size_type kCollectThreshold = 256;
+
+  static int Height(const Node* node) {
+    return (node == nullptr) ? 0 : node->height;
+  }
+
+  template <typename V>
+  const Node* Make(V&& value, const Node* left, const Node* right);
+  void Free(const Node* node);
+
+  const Node* Balance(const value_type& value, const Node* left,
+                      const Node* right);
+
+  template <typename V>
+  const Node* Insert(const Node* node, V&& value);
+
+  template <typename K>
+  const Node* Erase(const Node* node, const K& key, bool& erased);
+
+  const Node* EraseMin(const Node* node);
+
+  template <typename Update>
+  bool Publish(Update&& update, bool grows);
+
+  template <typename K>
+  Probe Search(const K& key) const;
+
+  void Collect();
+
+  [[no_unique_address]] Compare compare_;
+  node_allocator_type allocator_;
+  std::mutex writer_;
+  std::vector<const Node*> created_;
+  std::vector<const Node*> replaced_;
+  std::deque<std::pair<uint64_t, const Node*>> retired_;
+  size_type collect_at_ = kCollectThreshold;
+  mutable EpochDomain domain_;
+
+  alignas(64) std::atomic<const Node*> root_{nullptr};
+  std::atomic<size_type> size_{0};
+};
+
+template <typename T, typename Compare, typename Allocator>
+ConcurrentBST<T, Compare, Allocator>::~ConcurrentBST() {
+  for (const std::pair<uint64_t, const Node*>& retired : retired_) {
+    Free(retired.second);
+  }
+
+  std::vector<const Node*> stack = {root_.load(std::memory_order_relaxed)};
+
+  while (!stack.empty()) {
+    const Node* node = stack.back();
+    stack.pop_back();
+    if (node == nullptr) continue;
+
+    stack.push_back(node->left);
+    stack.push_back(node->right);
+    Free(node);
+  }
+}
+
+template <typename T, typename Compare, typename Allocator>
+template <typename V>
+bool ConcurrentBST<T, Compare, Allocator>::insert(V&& value) {
+  std::lock_guard<std::mutex> lock(writer_);
+
+  return Publish(
+      [&](const Node* root) { return Insert(root, std::forward<V>(value)); },
+      true);
+}
+
+template <typename T, typename Compare, typename Allocator>
+template <typename K>
+typename ConcurrentBST<T, Compare, Allocator>::size_type
+ConcurrentBST<T, Compare, Allocator>::erase(const K& key) {
+  std::lock_guard<std::mutex> lock(writer_);
+
+  return Publish([&](const Node* root) {
+    bool erased = false;
+    const Node* updated = Erase(root, key, erased);
+
+    return erased ? updated : root;
+  }, false);
+}
+
+template <typename T, typename Compare, typename Allocator>
+template <typename K>
+bool ConcurrentBST<T, Compare, Allocator>::contains(const K& key) const {
+  EpochDomain::Guard guard = domain_.Pin();
+
+  return Search(key).match != nullptr;
+}
+
+template <typename T, typename Compare, typename Allocator>
+template <typename K>
+std::optional<T> ConcurrentBST<T, Compare, Allocator>::find(
+    const K& key) const {
+  EpochDomain::Guard guard = domain_.Pin();
+  const Node* node = Search(key).match;
+
+  if (node == nullptr) return std::nullopt;
+
+  return node->value;
+}
+
+template <typename T, typename Compare, typename Allocator>
+template <typename K>
+std::optional<T> ConcurrentBST<T, Compare, Allocator>::lower_bound(
+    const K& key) const {
+  EpochDomain::Guard guard = domain_.Pin();
+  Probe probe = Search(key);
+  const Node* node = (probe.match != nullptr) ? probe.match : probe.above;
+
+  if (node == nullptr) return std::nullopt;
+
+  return node->value;
+}
+
+template <typename T, typename Compare, typename Allocator>
+template <typename Function>
+void ConcurrentBST<T, Compare, Allocator>::for_each(
+    Function&& function) const {
+  EpochDomain::Guard guard = domain_.Pin();
+  std::vector<const Node*> stack;
+  const Node* node = root_.load(std::memory_order_acquire);
+
+  while (node != nullptr || !stack.empty()) {
+    if (node != nullptr) {
+      stack.push_back(node);
+      node = node->left;
+      continue;
+    }
+
+    node = stack.back();
+    stack.pop_back();
+    function(node->value);
+    node = node->right;
+  }
+}
+
+template <typename T, typename Compare, typename Allocator>
+template <typename V>
+const typename ConcurrentBST<T, Compare, Allocator>::Node*
+ConcurrentBST<T, Compare, Allocator>::Make(V&& value, const Node* left,
+                                           const Node* right) {
+  Node* node = node_allocator_traits::allocate(allocator_, 1);
+
+  try {
+    node_allocator_traits::construct(allocator_, node, std::forward<V>(value),
+                                     left, right);
+  } catch (...) {
+    node_allocator_traits::deallocate(allocator_, node, 1);
+    throw;
+  }
+
+  try {
+    created_.push_back(node);
+  } catch (...) {
+    Free(node);
+    throw;
+  }
+
+  return node;
+}
+
+template <typename T, typename Compare, typename Allocator>
+void ConcurrentBST<T, Compare, Allocator>::Free(const Node* node) {
+  Node* mutable_node = const_cast<Node*>(node);
+
+  node_allocator_traits::destroy(allocator_, mutable_node);
+  node_allocator_traits::deallocate(allocator_, mutable_node, 1);
+}
+
+template <typename T, typename Compare, typename Allocator>
+const typename ConcurrentBST<T, Compare, Allocator>::Node*
+ConcurrentBST<T, Compare, Allocator>::Balance(const value_type& value,
+                                              const Node* left,
+                                              const Node* right) {
+  if (Height(left) > Height(right) + 1) {
+    replaced_.push_back(left);
+
+    if (Height(left->left) >= Height(left->right)) {
+      return Make(left->value, left->left, Make(value, left->right, right));
+    }
+
+    const Node* pivot = left->right;
+    replaced_.push_back(pivot);
+
+    return Make(pivot->value, Make(left->value, left->left, pivot->left),
+                Make(value, pivot->right, right));
+  }
+
+  if (Height(right) > Height(left) + 1) {
+    replaced_.push_back(right);
+
+    if (Height(right->right) >= Height(right->left)) {
+      return Make(right->value, Make(value, left, right->left), right->right);
+    }
+
+    const Node* pivot = right->left;
+    replaced_.push_back(pivot);
+
+    return Make(pivot->value, Make(value, left, pivot->left),
+                Make(right->value, pivot->right, right->right));
+  }
+
+  return Make(value, left, right);
+}
+
+template <typename T, typename Compare, typename Allocator>
+template <typename V>
+const typename ConcurrentBST<T, Compare, Allocator>::Node*
+ConcurrentBST<T, Compare, Allocator>::Insert(const Node* node, V&& value) {
+  if (node == nullptr) return Make(std::forward<V>(value), nullptr, nullptr);
+
+  auto order = KeyOrder<Compare>::Order(compare_, value, node->value);
+  if (order == 0) return node;
+
+  const Node* left = node->left;
+  const Node* right = node->right;
+
+  if (order < 0) {
+    left = Insert(left, std::forward<V>(value));
+    if (left == node->left) return node;
+  } else {
+    right = Insert(right, std::forward<V>(value));
+    if (right == node->right) return node;
+  }
+
+  replaced_.push_back(node);
+
+  return Balance(node->value, left, right);
+}
+
+template <typename T, typename Compare, typename Allocator>
+template <typename K>
+const typename ConcurrentBST<T, Compare, Allocator>::Node*
+ConcurrentBST<T, Compare, Allocator>::Erase(const Node* node, const K& key,
+                                            bool& erased) {
+  if (node == nullptr) return nullptr;
+
+  auto order = KeyOrder<Compare>::Order(compare_, key, node->value);
+
+  if (order < 0) {
+    const Node* left = Erase(node->left, key, erased);
+    if (!erased) return node;
+
+    replaced_.push_back(node);
+
+    return Balance(node->value, left, node->right);
+  }
+
+  if (order > 0) {
+    const Node* right = Erase(node->right, key, erased);
+    if (!erased) return node;
+
+    replaced_.push_back(node);
+
+    return Balance(node->value, node->left, right);
+  }
+
+  erased = true;
+  replaced_.push_back(node);
+
+  if (node->left == nullptr) return node->right;
+  if (node->right == nullptr) return node->left;
+
+  const Node* successor = node->right;
+  while (successor->left != nullptr) {
+    successor = successor->left;
+  }
+
+  return Balance(successor->value, node->left, EraseMin(node->right));
+}
+
+template <typename T, typename Compare, typename Allocator>
+const typename ConcurrentBST<T, Compare, Allocator>::Node*
+ConcurrentBST<T, Compare, Allocator>::EraseMin(const Node* node) {
+  replaced_.push_back(node);
+
+  if (node->left == nullptr) return node->right;
+
+  return Balance(node->value, EraseMin(node->left), node->right);
+}
+
+// Builds the next version of the tree beside the current one and swaps it in
+// with a single release store of the root. Readers see either version whole,
+// so they never wait on the writer or retry. Nodes the new version no longer
+// reaches are retired until every reader pinned before the swap has left.
+template <typename T, typename Compare, typename Allocator>
+template <typename Update>
+bool ConcurrentBST<T, Compare, Allocator>::Publish(Update&& update,
+                                                   bool grows) {
+  const Node* root = root_.load(std::memory_order_relaxed);
+  const Node* updated = nullptr;
+
+  try {
+    updated = update(root);
+  } catch (...) {
+    for (const Node* node : created_) {
+      Free(node);
+    }
+    created_.clear();
+    replaced_.clear();
+    throw;
+  }
+
+  created_.clear();
+  if (updated == root) return false;
+
+  root_.store(updated, std::memory_order_release);
+  size_.store(grows ? size() + 1 : size() - 1, std::memory_order_relaxed);
+
+  uint64_t epoch = domain_.Current();
+  for (const Node* node : replaced_) {
+    retired_.emplace_back(epoch, node);
+  }
+  replaced_.clear();
+
+  if (retired_.size() >= collect_at_) {
+    Collect();
+  }
+
+  return true;
+}
+
+template <typename T, typename Compare, typename Allocator>
+template <typename K>
+typename ConcurrentBST<T, Compare, Allocator>::Probe
+ConcurrentBST<T, Compare, Allocator>::Search(const K& key) const {
+  Probe probe{nullptr, nullptr};
+  const Node* node = root_.load(std::memory_order_acquire);
+
+  while (node != nullptr) {
+    auto order = KeyOrder<Compare>::Order(compare_, key, node->value);
+
+    if (order < 0) {
+      probe.above = node;
+      node = node->left;
+    } else if (order > 0) {
+      node = node->right;
+    } else {
+      probe.match = node;
+      break;
+    }
+  }
+
+  return probe;
+}
+
+template <typename T, typename Compare, typename Allocator>
+void ConcurrentBST<T, Compare, Allocator>::Collect() {
+  uint64_t safe = domain_.Advance();
+
+  while (!retired_.empty() && retired_.front().first < safe) {
+    Free(retired_.front().second);
+    retired_.pop_front();
+  }
+
+  // A long reader can hold back the whole backlog; wait for another batch
+  // before scanning the epoch slots again.
+  collect_at_ = retired_.size() + kCollectThreshold;
+}
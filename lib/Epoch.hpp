@@ -0,0 +1,166 @@
+#pragma once
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <thread>
+#include <utility>
+#include <vector>
+
+class EpochDomain {
+  typedef size_t size_type;
+
+  struct Slot;
+
+ public:
+  class Guard {
+   public:
+    Guard(Guard&& other) noexcept : slot_(other.slot_) {
+      other.slot_ = nullptr;
+    }
+
+    Guard(const Guard& other) = delete;
+    Guard& operator=(const Guard& other) = delete;
+    Guard& operator=(Guard&& other) = delete;
+
+    ~Guard() {
+      if (slot_ != nullptr) slot_->epoch.store(0, std::memory_order_release);
+    }
+
+   private:
+    friend EpochDomain;
+
+    explicit Guard(Slot* slot) : slot_(slot) {}
+
+    Slot* slot_;
+  };
+
+  EpochDomain() = default;
+  EpochDomain(const EpochDomain& other) = delete;
+  EpochDomain& operator=(const EpochDomain& other) = delete;
+
+  ~EpochDomain() {
+    for (Slot& slot : slots_) {
+      for (const Retired& retired : slot.retired) {
+        retired.deleter(retired.context, retired.object);
+      }
+    }
+  }
+
+  Guard Pin() const {
+    static thread_local size_type hint =
+        std::hash<std::thread::id>()(std::this_thread::get_id()) % kSlots;
+
+    while (true) {
+      for (size_type probe = 0; probe < kSlots; ++probe) {
+        Slot& slot = slots_[(hint + probe) % kSlots];
+        uint64_t expected = 0;
+
+        if (slot.epoch.load(std::memory_order_relaxed) == 0 &&
+            slot.epoch.compare_exchange_strong(expected, epoch_.load())) {
+          std::atomic_thread_fence(std::memory_order_seq_cst);
+
+          return Guard(&slot);
+        }
+      }
+
+      std::this_thread::yield();
+    }
+  }
+
+  uint64_t Current() const { return epoch_.load(); }
+
+  uint64_t Advance() {
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    uint64_t safe = epoch_.fetch_add(1) + 1;
+
+    for (const Slot& slot : slots_) {
+      uint64_t pinned = slot.epoch.load();
+      if (pinned != 0 && pinned < safe) safe = pinned;
+    }
+
+    return safe;
+  }
+
+  // Deletes object once no reader can still reach it. The retire list lives
+  // in the caller's pinned slot, which no other thread touches until the
+  // guard is released, so retiring takes no lock.
+  template <typename Object>
+  void Retire(const Guard& guard, Object* object) {
+    Retire(guard, object, nullptr, [](void*, void* pointer) {
+      delete static_cast<Object*>(pointer);
+    });
+  }
+
+  // Same, but frees object with deleter(context, object), for objects that
+  // came from an allocator rather than new.
+  void Retire(const Guard& guard, void* object, void* context,
+              void (*deleter)(void*, void*)) {
+    Slot& slot = *guard.slot_;
+    slot.retired.push_back(Retired{Current(), object, context, deleter});
+    slot.pending.store(true, std::memory_order_relaxed);
+
+    if (slot.retired.size() >= kCollectThreshold) {
+      Collect(slot);
+    }
+  }
+
+ private:
+  static constexpr size_type kSlots = 256;
+  static constexpr size_type kCollectThreshold = 64;
+
+  struct Retired {
+    uint64_t epoch;
+    void* object;
+    void* context;
+    void (*deleter)(void*, void*);
+  };
+
+  struct alignas(64) Slot {
+    std::atomic<uint64_t> epoch{0};
+    std::atomic<bool> pending{false};
+    std::vector<Retired> retired;
+  };
+
+  static void Drain(Slot& slot, uint64_t safe) {
+    size_type kept = 0;
+
+    for (const Retired& entry : slot.retired) {
+      if (entry.epoch < safe) {
+        entry.deleter(entry.context, entry.object);
+      } else {
+        slot.retired[kept++] = entry;
+      }
+    }
+    slot.retired.resize(kept);
+    slot.pending.store(kept != 0, std::memory_order_relaxed);
+  }
+
+  // Drains the caller's own list, then every idle slot still holding
+  // entries. A thread that retires a few nodes and goes quiet leaves them
+  // in its released slot; claiming that slot the way Pin does hands its
+  // list to whichever thread collects next.
+  void Collect(Slot& own) {
+    uint64_t safe = Advance();
+    Drain(own, safe);
+
+    for (Slot& slot : slots_) {
+      if (&slot == &own || !slot.pending.load(std::memory_order_relaxed)) {
+        continue;
+      }
+
+      uint64_t expected = 0;
+      if (slot.epoch.load(std::memory_order_relaxed) != 0 ||
+          !slot.epoch.compare_exchange_strong(expected, Current())) {
+        continue;
+      }
+
+      Drain(slot, safe);
+      slot.epoch.store(0, std::memory_order_release);
+    }
+  }
+
+  mutable std::array<Slot, kSlots> slots_;
+  std::atomic<uint64_t> epoch_{1};
+};
@@ -0,0 +1,811 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <initializer_list>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "Epoch.hpp"
+#include "KeySearch.hpp"
+
+// Leaf-oriented tree: keys live in the leaves and internal nodes only route.
+// Readers never lock. Writers lock the one or two nodes they relink, then
+// walk back up their search path restoring the AVL height invariant. Every
+// rotation swaps in fresh copies of the rotated nodes instead of editing
+// them, so a reader standing on an old node still reaches every key below
+// it. The Allocator is called from many threads at once.
+template <typename T, typename Compare = std::less<T>,
+          typename Allocator = std::allocator<T>>
+class FineGrainedBST {
+  typedef T value_type;
+  typedef size_t size_type;
+  typedef Allocator allocator_type;
+  typedef Compare key_compare;
+
+  struct Node;
+
+ public:
+  // Holds a copy of the key it stands on and re-seeks the successor on each
+  // step, so an iterator pins nothing while idle. Keys come out strictly
+  // increasing, and each one was present at some point during the walk.
+  class const_iterator {
+   public:
+    typedef std::input_iterator_tag iterator_category;
+    typedef T value_type;
+    typedef std::ptrdiff_t difference_type;
+    typedef const T* pointer;
+    typedef const T& reference;
+
+    const_iterator() = default;
+
+    const value_type& operator*() const { return *value_; }
+    const value_type* operator->() const { return &*value_; }
+
+    const_iterator& operator++();
+    const_iterator operator++(int);
+
+    bool operator==(const const_iterator& other) const;
+    bool operator!=(const const_iterator& other) const {
+      return !(*this == other);
+    }
+
+   private:
+    friend FineGrainedBST;
+
+    const_iterator(const FineGrainedBST* tree, const Node* leaf);
+
+    const FineGrainedBST* tree_ = nullptr;
+    std::optional<value_type> value_;
+  };
+
+  FineGrainedBST() : FineGrainedBST(Compare(), Allocator()) {}
+  explicit FineGrainedBST(const Compare& compare)
+      : FineGrainedBST(compare, Allocator()) {}
+  explicit FineGrainedBST(const Allocator& allocator)
+      : FineGrainedBST(Compare(), allocator) {}
+  FineGrainedBST(const Compare& compare, const Allocator& allocator);
+
+  FineGrainedBST(const FineGrainedBST& other) = delete;
+  FineGrainedBST& operator=(const FineGrainedBST& other) = delete;
+
+  ~FineGrainedBST();
+
+  const_iterator begin() const;
+  const_iterator end() const { return const_iterator(); }
+  const_iterator cbegin() const { return begin(); }
+  const_iterator cend() const { return end(); }
+
+  std::pair<const_iterator, bool> insert(const value_type& value) {
+    return emplace(value);
+  }
+
+  std::pair<const_iterator, bool> insert(value_type&& value) {
+    return emplace(std::move(value));
+  }
+
+  template <typename InputIt>
+  void insert(InputIt first, InputIt last);
+
+  void insert(std::initializer_list<value_type> ilist) {
+    insert(ilist.begin(), ilist.end());
+  }
+
+  template <typename... Args>
+  std::pair<const_iterator, bool> emplace(Args&&... args);
+
+  const_iterator erase(const_iterator pos);
+
+  size_type erase(const value_type& key);
+
+  size_type count(const value_type& key) const { return Contains(key); }
+
+  template <typename K>
+    requires Transparent<Compare>
+  size_type count(const K& key) const {
+    return Contains(key);
+  }
+
+  bool contains(const value_type& key) const { return Contains(key); }
+
+  template <typename K>
+    requires Transparent<Compare>
+  bool contains(const K& key) const {
+    return Contains(key);
+  }
+
+  const_iterator find(const value_type& key) const { return Find(key); }
+
+  template <typename K>
+    requires Transparent<Compare>
+  const_iterator find(const K& key) const {
+    return Find(key);
+  }
+
+  const_iterator lower_bound(const value_type& key) const {
+    return Bound(key, false);
+  }
+
+  template <typename K>
+    requires Transparent<Compare>
+  const_iterator lower_bound(const K& key) const {
+    return Bound(key, false);
+  }
+
+  const_iterator upper_bound(const value_type& key) const {
+    return Bound(key, true);
+  }
+
+  template <typename K>
+    requires Transparent<Compare>
+  const_iterator upper_bound(const K& key) const {
+    return Bound(key, true);
+  }
+
+  std::pair<const_iterator, const_iterator> equal_range(
+      const value_type& key) const {
+    return EqualRange(key);
+  }
+
+  template <typename K>
+    requires Transparent<Compare>
+  std::pair<const_iterator, const_iterator> equal_range(const K& key) const {
+    return EqualRange(key);
+  }
+
+  template <typename Function>
+  void for_each(Function&& function) const;
+
+  size_type size() const { return size_.load(std::memory_order_relaxed); }
+
+  bool empty() const { return size() == 0; }
+
+  // Longest root-to-leaf path, counting the leaf.
+  size_type height() const;
+
+  allocator_type get_allocator() const { return allocator_type(allocator_); }
+
+  key_compare key_comp() const { return compare_; }
+
+ private:
+  class SpinLock {
+   public:
+    void lock() {
+      while (locked_.exchange(true, std::memory_order_acquire)) {
+        while (locked_.load(std::memory_order_relaxed)) {
+          std::this_thread::yield();
+        }
+      }
+    }
+
+    void unlock() { locked_.store(false, std::memory_order_release); }
+
+   private:
+    std::atomic<bool> locked_ = false;
+  };
+
+  // Sentinel nodes compare above every key and hold no value, so T need not
+  // be default-constructible. Heights are only written under the node's
+  // lock; leaves always have height 1.
+  struct Node {
+    Node(std::nullopt_t, signed char infinity_) : infinity(infinity_) {}
+
+    template <typename... Args>
+    explicit Node(std::in_place_t, Args&&... args)
+        : value(std::in_place, std::forward<Args>(args)...), infinity(0) {}
+
+    Node(const std::optional<value_type>& value_, signed char infinity_,
+         Node* left_, Node* right_)
+        : value(value_), infinity(infinity_), leaf(false),
+          height(1 + std::max(Height(left_), Height(right_))), left(left_),
+          right(right_) {}
+
+    // Only for an internal node that has not been linked in yet.
+    void Reset(const std::optional<value_type>& value_, signed char infinity_,
+               Node* left_, Node* right_) {
+      value = value_;
+      infinity = infinity_;
+      height.store(1 + std::max(Height(left_), Height(right_)),
+                   std::memory_order_relaxed);
+      left.store(left_, std::memory_order_relaxed);
+      right.store(right_, std::memory_order_relaxed);
+    }
+
+    std::optional<value_type> value;
+    signed char infinity;
+    bool leaf = true;
+    std::atomic<bool> removed = false;
+    std::atomic<int> height = 1;
+    std::atomic<Node*> left = nullptr;
+    std::atomic<Node*> right = nullptr;
+    SpinLock lock;
+  };
+
+  typedef typename std::allocator_traits<Allocator>::template rebind_alloc<
+      Node>
+      node_allocator_type;
+  typedef std::allocator_traits<node_allocator_type> node_allocator_traits;
+
+  struct NodeDeleter {
+    void operator()(Node* node) const { tree->Destroy(node); }
+
+    FineGrainedBST* tree = nullptr;
+  };
+
+  typedef std::unique_ptr<Node, NodeDeleter> NodeGuard;
+
+  struct Path {
+    Node* grandparent;
+    Node* parent;
+    Node* leaf;
+  };
+
+  static int Height(const Node* node) {
+    return node->height.load(std::memory_order_relaxed);
+  }
+
+  template <typename K>
+  bool Less(const K& key, const Node* node) const;
+
+  template <typename K>
+  bool Matches(const K& key, const Node* node) const;
+
+  template <typename K>
+  std::atomic<Node*>& Child(Node* node, const K& key) const;
+
+  template <typename K>
+  Path Search(const K& key, std::vector<Node*>* ancestors = nullptr) const;
+
+  template <typename K>
+  const Node* Seek(const K& key, bool strict) const;
+
+  template <typename K>
+  bool Contains(const K& key) const;
+
+  template <typename K>
+  const_iterator Find(const K& key) const;
+
+  template <typename K>
+  const_iterator Bound(const K& key, bool strict) const;
+
+  template <typename K>
+  std::pair<const_iterator, const_iterator> EqualRange(const K& key) const;
+
+  void Rebalance(const EpochDomain::Guard& guard,
+                 std::vector<Node*>& ancestors, size_type index);
+  void Rotate(const EpochDomain::Guard& guard, Node* above, Node* node,
+              bool left_heavy);
+  void Retire(const EpochDomain::Guard& guard, Node* node);
+
+  static std::vector<Node*>& Ancestors();
+  static const Node* Leftmost(const Node* node);
+
+  template <typename... Args>
+  NodeGuard Make(Args&&... args);
+  void Destroy(Node* node);
+  void Free(Node* node);
+
+  [[no_unique_address]] Compare compare_;
+  node_allocator_type allocator_;
+  Node* root_ = nullptr;
+  std::atomic<size_type> size_ = 0;
+  mutable EpochDomain domain_;
+};
+
+template <typename T, typename Compare, typename Allocator>
+FineGrainedBST<T, Compare, Allocator>::const_iterator::const_iterator(
+    const FineGrainedBST* tree, const Node* leaf)
+    : tree_(tree) {
+  if (leaf != nullptr) value_.emplace(*leaf->value);
+}
+
+template <typename T, typename Compare, typename Allocator>
+typename FineGrainedBST<T, Compare, Allocator>::const_iterator&
+FineGrainedBST<T, Compare, Allocator>::const_iterator::operator++() {
+  *this = tree_->upper_bound(*value_);
+
+  return *this;
+}
+
+template <typename T, typename Compare, typename Allocator>
+typename FineGrainedBST<T, Compare, Allocator>::const_iterator
+FineGrainedBST<T, Compare, Allocator>::const_iterator::operator++(int) {
+  const_iterator temp = *this;
+  ++(*this);
+
+  return temp;
+}
+
+template <typename T, typename Compare, typename Allocator>
+bool FineGrainedBST<T, Compare, Allocator>::const_iterator::operator==(
+    const const_iterator& other) const {
+  if (!value_.has_value() || !other.value_.has_value()) {
+    return value_.has_value() == other.value_.has_value();
+  }
+
+  return !tree_->compare_(*value_, *other.value_) &&
+         !tree_->compare_(*other.value_, *value_);
+}
+
+template <typename T, typename Compare, typename Allocator>
+FineGrainedBST<T, Compare, Allocator>::FineGrainedBST(
+    const Compare& compare, const Allocator& allocator)
+    : compare_(compare), allocator_(allocator) {
+  NodeGuard low = Make(std::nullopt, 1);
+  NodeGuard high = Make(std::nullopt, 2);
+
+  root_ = Make(std::nullopt, 2, low.get(), high.get()).release();
+  low.release();
+  high.release();
+}
+
+template <typename T, typename Compare, typename Allocator>
+FineGrainedBST<T, Compare, Allocator>::~FineGrainedBST() {
+  Free(root_);
+}
+
+template <typename T, typename Compare, typename Allocator>
+typename FineGrainedBST<T, Compare, Allocator>::const_iterator
+FineGrainedBST<T, Compare, Allocator>::begin() const {
+  EpochDomain::Guard guard = domain_.Pin();
+  const Node* leaf = Leftmost(root_);
+
+  return const_iterator(this, (leaf->infinity == 0) ? leaf : nullptr);
+}
+
+template <typename T, typename Compare, typename Allocator>
+template <typename InputIt>
+void FineGrainedBST<T, Compare, Allocator>::insert(InputIt first,
+                                                   InputIt last) {
+  for (; first != last; ++first) {
+    emplace(*first);
+  }
+}
+
+template <typename T, typename Compare, typename Allocator>
+template <typename... Args>
+std::pair<typename FineGrainedBST<T, Compare, Allocator>::const_iterator, bool>
+FineGrainedBST<T, Compare, Allocator>::emplace(Args&&... args) {
+  NodeGuard fresh = Make(std::in_place, std::forward<Args>(args)...);
+  const value_type& value = *fresh->value;
+  EpochDomain::Guard guard = domain_.Pin();
+  std::vector<Node*>& ancestors = Ancestors();
+  NodeGuard internal;
+
+  while (true) {
+    Path path = Search(value, &ancestors);
+
+    if (Matches(value, path.leaf)) {
+      return std::make_pair(const_iterator(this, path.leaf), false);
+    }
+
+    bool less = Less(value, path.leaf);
+    const std::optional<value_type>& split =
+        less ? path.leaf->value : fresh->value;
+    signed char infinity = less ? path.leaf->infinity : 0;
+    Node* left = less ? fresh.get() : path.leaf;
+    Node* right = less ? path.leaf : fresh.get();
+
+    if (internal == nullptr) {
+      internal = Make(split, infinity, left, right);
+    } else {
+      internal->Reset(split, infinity, left, right);
+    }
+
+    {
+      std::lock_guard<SpinLock> lock(path.parent->lock);
+      std::atomic<Node*>& link = Child(path.parent, value);
+
+      if (path.parent->removed.load(std::memory_order_relaxed) ||
+          link.load(std::memory_order_relaxed) != path.leaf) {
+        continue;
+      }
+
+      link.store(internal.release(), std::memory_order_release);
+    }
+
+    size_.fetch_add(1, std::memory_order_relaxed);
+    Rebalance(guard, ancestors, ancestors.size() - 1);
+
+    return std::make_pair(const_iterator(this, fresh.release()), true);
+  }
+}
+
+template <typename T, typename Compare, typename Allocator>
+typename FineGrainedBST<T, Compare, Allocator>::const_iterator
+FineGrainedBST<T, Compare, Allocator>::erase(const_iterator pos) {
+  if (pos == end()) return end();
+
+  erase(*pos);
+
+  return upper_bound(*pos);
+}
+
+template <typename T, typename Compare, typename Allocator>
+typename FineGrainedBST<T, Compare, Allocator>::size_type
+FineGrainedBST<T, Compare, Allocator>::erase(const value_type& key) {
+  EpochDomain::Guard guard = domain_.Pin();
+  std::vector<Node*>& ancestors = Ancestors();
+
+  while (true) {
+    Path path = Search(key, &ancestors);
+
+    if (!Matches(key, path.leaf)) return 0;
+
+    {
+      std::lock_guard<SpinLock> upper(path.grandparent->lock);
+      std::lock_guard<SpinLock> lower(path.parent->lock);
+      std::atomic<Node*>& link = Child(path.grandparent, key);
+
+      if (path.grandparent->removed.load(std::memory_order_relaxed) ||
+          path.parent->removed.load(std::memory_order_relaxed) ||
+          link.load(std::memory_order_relaxed) != path.parent ||
+          Child(path.parent, key).load(std::memory_order_relaxed) !=
+              path.leaf) {
+        continue;
+      }
+
+      Node* sibling = Less(key, path.parent)
+                          ? path.parent->right.load(std::memory_order_relaxed)
+                          : path.parent->left.load(std::memory_order_relaxed);
+
+      path.parent->removed.store(true, std::memory_order_relaxed);
+      path.leaf->removed.store(true, std::memory_order_relaxed);
+      link.store(sibling, std::memory_order_release);
+    }
+
+    size_.fetch_sub(1, std::memory_order_relaxed);
+    Retire(guard, path.parent);
+    Retire(guard, path.leaf);
+    Rebalance(guard, ancestors, ancestors.size() - 2);
+
+    return 1;
+  }
+}
+
+template <typename T, typename Compare, typename Allocator>
+template <typename Function>
+void FineGrainedBST<T, Compare, Allocator>::for_each(
+    Function&& function) const {
+  EpochDomain::Guard guard = domain_.Pin();
+  std::vector<const Node*> stack;
+  const Node* last = nullptr;
+  const Node* node = root_;
+
+  while (node != nullptr || !stack.empty()) {
+    if (node != nullptr && !node->leaf) {
+      stack.push_back(node);
+      node = node->left.load(std::memory_order_acquire);
+      continue;
+    }
+
+    if (node != nullptr && node->infinity == 0 &&
+        (last == nullptr || compare_(*last->value, *node->value))) {
+      function(*node->value);
+      last = node;
+    }
+
+    if (stack.empty()) break;
+
+    node = stack.back()->right.load(std::memory_order_acquire);
+    stack.pop_back();
+  }
+}
+
+template <typename T, typename Compare, typename Allocator>
+typename FineGrainedBST<T, Compare, Allocator>::size_type
+FineGrainedBST<T, Compare, Allocator>::height() const {
+  EpochDomain::Guard guard = domain_.Pin();
+  std::vector<std::pair<const Node*, size_type>> stack = {
+      {root_->left.load(std::memory_order_acquire), 1}};
+  size_type height = 0;
+
+  while (!stack.empty()) {
+    auto [node, depth] = stack.back();
+    stack.pop_back();
+    height = std::max(height, depth);
+
+    if (!node->leaf) {
+      stack.emplace_back(node->left.load(std::memory_order_acquire),
+                         depth + 1);
+      stack.emplace_back(node->right.load(std::memory_order_acquire),
+                         depth + 1);
+    }
+  }
+
+  return height;
+}
+
+template <typename T, typename Compare, typename Allocator>
+template <typename K>
+bool FineGrainedBST<T, Compare, Allocator>::Less(const K& key,
+                                                 const Node* node) const {
+  return node->infinity != 0 || compare_(key, *node->value);
+}
+
+template <typename T, typename Compare, typename Allocator>
+template <typename K>
+bool FineGrainedBST<T, Compare, Allocator>::Matches(const K& key,
+                                                    const Node* node) const {
+  return node->infinity == 0 && !compare_(key, *node->value) &&
+         !compare_(*node->value, key);
+}
+
+template <typename T, typename Compare, typename Allocator>
+template <typename K>
+std::atomic<typename FineGrainedBST<T, Compare, Allocator>::Node*>&
+FineGrainedBST<T, Compare, Allocator>::Child(Node* node, const K& key) const {
+  return Less(key, node) ? node->left : node->right;
+}
+
+template <typename T, typename Compare, typename Allocator>
+template <typename K>
+typename FineGrainedBST<T, Compare, Allocator>::Path
+FineGrainedBST<T, Compare, Allocator>::Search(
+    const K& key, std::vector<Node*>* ancestors) const {
+  Path path{nullptr, nullptr, root_};
+
+  if (ancestors != nullptr) ancestors->clear();
+
+  while (!path.leaf->leaf) {
+    if (ancestors != nullptr) ancestors->push_back(path.leaf);
+
+    path.grandparent = path.parent;
+    path.parent = path.leaf;
+    path.leaf = Child(path.parent, key).load(std::memory_order_acquire);
+  }
+
+  return path;
+}
+
+// Returns the first leaf not below key, or above it when strict. Keys that
+// route left at a node are below everything in its right subtree, so if the
+// leaf the search lands on misses, the answer is the leftmost leaf of the
+// last right subtree the search passed up.
+template <typename T, typename Compare, typename Allocator>
+template <typename K>
+const typename FineGrainedBST<T, Compare, Allocator>::Node*
+FineGrainedBST<T, Compare, Allocator>::Seek(const K& key, bool strict) const {
+  const Node* node = root_;
+  const Node* above = nullptr;
+
+  while (!node->leaf) {
+    if (Less(key, node)) {
+      above = node->right.load(std::memory_order_acquire);
+      node = node->left.load(std::memory_order_acquire);
+    } else {
+      node = node->right.load(std::memory_order_acquire);
+    }
+  }
+
+  if (node->infinity == 0 && (strict ? compare_(key, *node->value)
+                                     : !compare_(*node->value, key))) {
+    return node;
+  }
+  if (above == nullptr) return nullptr;
+
+  node = Leftmost(above);
+
+  return (node->infinity == 0) ? node : nullptr;
+}
+
+template <typename T, typename Compare, typename Allocator>
+template <typename K>
+bool FineGrainedBST<T, Compare, Allocator>::Contains(const K& key) const {
+  EpochDomain::Guard guard = domain_.Pin();
+
+  return Matches(key, Search(key).leaf);
+}
+
+template <typename T, typename Compare, typename Allocator>
+template <typename K>
+typename FineGrainedBST<T, Compare, Allocator>::const_iterator
+FineGrainedBST<T, Compare, Allocator>::Find(const K& key) const {
+  EpochDomain::Guard guard = domain_.Pin();
+  const Node* leaf = Search(key).leaf;
+
+  return const_iterator(this, Matches(key, leaf) ? leaf : nullptr);
+}
+
+template <typename T, typename Compare, typename Allocator>
+template <typename K>
+typename FineGrainedBST<T, Compare, Allocator>::const_iterator
+FineGrainedBST<T, Compare, Allocator>::Bound(const K& key,
+                                             bool strict) const {
+  EpochDomain::Guard guard = domain_.Pin();
+
+  return const_iterator(this, Seek(key, strict));
+}
+
+template <typename T, typename Compare, typename Allocator>
+template <typename K>
+std::pair<typename FineGrainedBST<T, Compare, Allocator>::const_iterator,
+          typename FineGrainedBST<T, Compare, Allocator>::const_iterator>
+FineGrainedBST<T, Compare, Allocator>::EqualRange(const K& key) const {
+  EpochDomain::Guard guard = domain_.Pin();
+  const Node* first = Seek(key, false);
+
+  if (first == nullptr || compare_(key, *first->value)) {
+    return std::make_pair(const_iterator(this, first),
+                          const_iterator(this, first));
+  }
+
+  return std::make_pair(const_iterator(this, first),
+                        const_iterator(this, Seek(key, true)));
+}
+
+// Walks the search path bottom-up from ancestors[index], refreshing heights
+// and rotating wherever the two sides differ by more than one. Each step
+// locks the node and the one above it and first checks that the link between
+// them still stands. If it does not, another writer has replaced that part of
+// the path and rebalances it on its own way up, so this one stops. Balance
+// only bounds the height; if a rotation cannot allocate, the tree is left
+// valid and a little taller.
+template <typename T, typename Compare, typename Allocator>
+void FineGrainedBST<T, Compare, Allocator>::Rebalance(
+    const EpochDomain::Guard& guard, std::vector<Node*>& ancestors,
+    size_type index) {
+  for (; index > 0; --index) {
+    Node* above = ancestors[index - 1];
+    Node* node = ancestors[index];
+    std::lock_guard<SpinLock> upper(above->lock);
+    std::lock_guard<SpinLock> lower(node->lock);
+
+    if (above->removed.load(std::memory_order_relaxed) ||
+        node->removed.load(std::memory_order_relaxed) ||
+        (above->left.load(std::memory_order_relaxed) != node &&
+         above->right.load(std::memory_order_relaxed) != node)) {
+      return;
+    }
+
+    int left = Height(node->left.load(std::memory_order_relaxed));
+    int right = Height(node->right.load(std::memory_order_relaxed));
+
+    if (left > right + 1 || right > left + 1) {
+      try {
+        Rotate(guard, above, node, left > right);
+      } catch (...) {
+        return;
+      }
+
+      continue;
+    }
+
+    int height = 1 + std::max(left, right);
+    if (height == Height(node)) return;
+
+    node->height.store(height, std::memory_order_relaxed);
+  }
+}
+
+// Replaces node and its taller child (and, for a double rotation, that
+// child's inner child) with rotated copies. The subtrees below them are
+// shared, not copied. The caller holds the locks on above and node.
+template <typename T, typename Compare, typename Allocator>
+void FineGrainedBST<T, Compare, Allocator>::Rotate(
+    const EpochDomain::Guard& guard, Node* above, Node* node,
+    bool left_heavy) {
+  Node* child = (left_heavy ? node->left : node->right)
+                    .load(std::memory_order_relaxed);
+  std::lock_guard<SpinLock> middle(child->lock);
+
+  Node* other = (left_heavy ? node->right : node->left)
+                    .load(std::memory_order_relaxed);
+  Node* outer = (left_heavy ? child->left : child->right)
+                    .load(std::memory_order_relaxed);
+  Node* inner = (left_heavy ? child->right : child->left)
+                    .load(std::memory_order_relaxed);
+  std::atomic<Node*>& link =
+      (above->left.load(std::memory_order_relaxed) == node) ? above->left
+                                                            : above->right;
+
+  if (Height(inner) <= Height(outer)) {
+    NodeGuard lower =
+        left_heavy ? Make(node->value, node->infinity, inner, other)
+                   : Make(node->value, node->infinity, other, inner);
+    NodeGuard top =
+        left_heavy ? Make(child->value, child->infinity, outer, lower.get())
+                   : Make(child->value, child->infinity, lower.get(), outer);
+
+    lower.release();
+    link.store(top.release(), std::memory_order_release);
+  } else {
+    std::lock_guard<SpinLock> bottom(inner->lock);
+    Node* inner_left = inner->left.load(std::memory_order_relaxed);
+    Node* inner_right = inner->right.load(std::memory_order_relaxed);
+
+    NodeGuard lower =
+        left_heavy ? Make(child->value, child->infinity, outer, inner_left)
+                   : Make(node->value, node->infinity, other, inner_left);
+    NodeGuard upper =
+        left_heavy ? Make(node->value, node->infinity, inner_right, other)
+                   : Make(child->value, child->infinity, inner_right, outer);
+    NodeGuard top =
+        Make(inner->value, inner->infinity, lower.get(), upper.get());
+
+    lower.release();
+    upper.release();
+    inner->removed.store(true, std::memory_order_relaxed);
+    link.store(top.release(), std::memory_order_release);
+    Retire(guard, inner);
+  }
+
+  node->removed.store(true, std::memory_order_relaxed);
+  child->removed.store(true, std::memory_order_relaxed);
+  Retire(guard, node);
+  Retire(guard, child);
+}
+
+template <typename T, typename Compare, typename Allocator>
+void FineGrainedBST<T, Compare, Allocator>::Retire(
+    const EpochDomain::Guard& guard, Node* node) {
+  domain_.Retire(guard, node, this, [](void* tree, void* pointer) {
+    static_cast<FineGrainedBST*>(tree)->Destroy(static_cast<Node*>(pointer));
+  });
+}
+
+template <typename T, typename Compare, typename Allocator>
+std::vector<typename FineGrainedBST<T, Compare, Allocator>::Node*>&
+FineGrainedBST<T, Compare, Allocator>::Ancestors() {
+  static thread_local std::vector<Node*> ancestors;
+
+  return ancestors;
+}
+
+template <typename T, typename Compare, typename Allocator>
+const typename FineGrainedBST<T, Compare, Allocator>::Node*
+FineGrainedBST<T, Compare, Allocator>::Leftmost(const Node* node) {
+  while (!node->leaf) {
+    node = node->left.load(std::memory_order_acquire);
+  }
+
+  return node;
+}
+
+template <typename T, typename Compare, typename Allocator>
+template <typename... Args>
+typename FineGrainedBST<T, Compare, Allocator>::NodeGuard
+FineGrainedBST<T, Compare, Allocator>::Make(Args&&... args) {
+  Node* node = node_allocator_traits::allocate(allocator_, 1);
+
+  try {
+    node_allocator_traits::construct(allocator_, node,
+                                     std::forward<Args>(args)...);
+  } catch (...) {
+    node_allocator_traits::deallocate(allocator_, node, 1);
+    throw;
+  }
+
+  return NodeGuard(node, NodeDeleter{this});
+}
+
+template <typename T, typename Compare, typename Allocator>
+void FineGrainedBST<T, Compare, Allocator>::Destroy(Node* node) {
+  node_allocator_traits::destroy(allocator_, node);
+  node_allocator_traits::deallocate(allocator_, node, 1);
+}
+
+template <typename T, typename Compare, typename Allocator>
+void FineGrainedBST<T, Compare, Allocator>::Free(Node* node) {
+  std::vector<Node*> stack = {node};
+
+  while (!stack.empty()) {
+    node = stack.back();
+    stack.pop_back();
+
+    if (!node->leaf) {
+      stack.push_back(node->left.load(std::memory_order_relaxed));
+      stack.push_back(node->right.load(std::memory_order_relaxed));
+    }
+
+    Destroy(node);
+  }
+}
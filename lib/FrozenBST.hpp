@@ -0,0 +1,281 @@
+#pragma once
+
+#include <bit>
+#include <cstddef>
+#include <functional>
+#include <iterator>
+#include <vector>
+
+#include "Tree.hpp"
+
+template <typename T, typename Compare = std::less<T>>
+class FrozenBST {
+  typedef T value_type;
+  typedef size_t size_type;
+
+ public:
+  class const_iterator {
+   public:
+    typedef std::bidirectional_iterator_tag iterator_category;
+    typedef T value_type;
+    typedef std::ptrdiff_t difference_type;
+    typedef const T* pointer;
+    typedef const T& reference;
+
+    const_iterator() = default;
+    const_iterator(const FrozenBST* tree, size_type index)
+        : tree_(tree), index_(index) {}
+
+    const value_type& operator*() const { return tree_->values_[index_ - 1]; }
+    const value_type* operator->() const { return &**this; }
+
+    const_iterator& operator++();
+    const_iterator operator++(int);
+
+    const_iterator& operator--();
+    const_iterator operator--(int);
+
+    bool operator==(const const_iterator& other) const {
+      return index_ == other.index_;
+    }
+    bool operator!=(const const_iterator& other) const {
+      return index_ != other.index_;
+    }
+
+   private:
+    const FrozenBST* tree_ = nullptr;
+    size_type index_ = 0;
+  };
+
+  FrozenBST() = default;
+
+  template <typename ForwardIt>
+  FrozenBST(ForwardIt first, ForwardIt last,
+            const Compare& compare = Compare());
+
+  template <IteratorType type>
+    requires(type == IteratorType::INORDER)
+  const_iterator begin() const {
+    return const_iterator(this, Leftmost(1));
+  }
+
+  template <IteratorType type>
+    requires(type == IteratorType::INORDER)
+  const_iterator end() const {
+    return const_iterator(this, 0);
+  }
+
+  size_type size() const { return values_.size(); }
+
+  bool empty() const { return values_.empty(); }
+
+  const_iterator find(const value_type& key) const { return Find(key); }
+
+  template <typename K>
+    requires Transparent<Compare>
+  const_iterator find(const K& key) const {
+    return Find(key);
+  }
+
+  bool contains(const value_type& key) const { return Find(key) != End(); }
+
+  template <typename K>
+    requires Transparent<Compare>
+  bool contains(const K& key) const {
+    return Find(key) != End();
+  }
+
+  const_iterator lower_bound(const value_type& key) const {
+    return const_iterator(this, LowerBound(key));
+  }
+
+  template <typename K>
+    requires Transparent<Compare>
+  const_iterator lower_bound(const K& key) const {
+    return const_iterator(this, LowerBound(key));
+  }
+
+  const_iterator upper_bound(const value_type& key) const {
+    return const_iterator(this, UpperBound(key));
+  }
+
+  template <typename K>
+    requires Transparent<Compare>
+  const_iterator upper_bound(const K& key) const {
+    return const_iterator(this, UpperBound(key));
+  }
+
+ private:
+  static constexpr size_type kLookahead =
+      sizeof(T) >= 64 ? 1 : std::bit_floor(64 / sizeof(T));
+
+  const_iterator End() const { return const_iterator(this, 0); }
+
+  template <typename K>
+  const_iterator Find(const K& key) const;
+
+  template <typename K>
+  size_type LowerBound(const K& key) const;
+
+  template <typename K>
+  size_type UpperBound(const K& key) const;
+
+  void Prefetch(size_type index) const;
+
+  size_type Leftmost(size_type index) const;
+  size_type Rightmost(size_type index) const;
+
+  void Layout(const std::vector<const T*>& sorted,
+              std::vector<const T*>& slots, size_type& next,
+              size_type index) const;
+
+  std::vector<T> values_;
+  [[no_unique_address]] Compare compare_;
+};
+
+template <typename T, typename Compare>
+template <typename ForwardIt>
+FrozenBST<T, Compare>::FrozenBST(ForwardIt first, ForwardIt last,
+                                 const Compare& compare)
+    : compare_(compare) {
+  std::vector<const T*> sorted;
+  for (; first != last; ++first) {
+    sorted.push_back(&*first);
+  }
+
+  std::vector<const T*> slots(sorted.size());
+  size_type next = 0;
+  Layout(sorted, slots, next, 1);
+
+  values_.reserve(slots.size());
+  for (const T* slot : slots) {
+    values_.push_back(*slot);
+  }
+}
+
+template <typename T, typename Compare>
+void FrozenBST<T, Compare>::Layout(const std::vector<const T*>& sorted,
+                                   std::vector<const T*>& slots,
+                                   size_type& next, size_type index) const {
+  if (index > sorted.size()) return;
+
+  Layout(sorted, slots, next, 2 * index);
+  slots[index - 1] = sorted[next++];
+  Layout(sorted, slots, next, 2 * index + 1);
+}
+
+template <typename T, typename Compare>
+template <typename K>
+typename FrozenBST<T, Compare>::const_iterator FrozenBST<T, Compare>::Find(
+    const K& key) const {
+  size_type index = LowerBound(key);
+
+  if (index == 0 || compare_(key, values_[index - 1])) return End();
+
+  return const_iterator(this, index);
+}
+
+template <typename T, typename Compare>
+template <typename K>
+typename FrozenBST<T, Compare>::size_type FrozenBST<T, Compare>::LowerBound(
+    const K& key) const {
+  size_type index = 1;
+
+  while (index <= values_.size()) {
+    Prefetch(index * kLookahead);
+    index = 2 * index + compare_(values_[index - 1], key);
+  }
+
+  return index >> (std::countr_one(index) + 1);
+}
+
+template <typename T, typename Compare>
+template <typename K>
+typename FrozenBST<T, Compare>::size_type FrozenBST<T, Compare>::UpperBound(
+    const K& key) const {
+  size_type index = 1;
+
+  while (index <= values_.size()) {
+    Prefetch(index * kLookahead);
+    index = 2 * index + !compare_(key, values_[index - 1]);
+  }
+
+  return index >> (std::countr_one(index) + 1);
+}
+
+template <typename T, typename Compare>
+void FrozenBST<T, Compare>::Prefetch(size_type index) const {
+#if defined(__GNUC__) || defined(__clang__)
+  if (index <= values_.size()) {
+    __builtin_prefetch(values_.data() + index - 1);
+  }
+#endif
+}
+
+template <typename T, typename Compare>
+typename FrozenBST<T, Compare>::size_type FrozenBST<T, Compare>::Leftmost(
+    size_type index) const {
+  if (index > values_.size()) return 0;
+
+  while (2 * index <= values_.size()) {
+    index *= 2;
+  }
+
+  return index;
+}
+
+template <typename T, typename Compare>
+typename FrozenBST<T, Compare>::size_type FrozenBST<T, Compare>::Rightmost(
+    size_type index) const {
+  if (index > values_.size()) return 0;
+
+  while (2 * index + 1 <= values_.size()) {
+    index = 2 * index + 1;
+  }
+
+  return index;
+}
+
+template <typename T, typename Compare>
+typename FrozenBST<T, Compare>::const_iterator&
+FrozenBST<T, Compare>::const_iterator::operator++() {
+  if (2 * index_ + 1 <= tree_->values_.size()) {
+    index_ = tree_->Leftmost(2 * index_ + 1);
+  } else {
+    index_ >>= std::countr_one(index_) + 1;
+  }
+
+  return *this;
+}
+
+template <typename T, typename Compare>
+typename FrozenBST<T, Compare>::const_iterator
+FrozenBST<T, Compare>::const_iterator::operator++(int) {
+  const_iterator temp = *this;
+  ++*this;
+
+  return temp;
+}
+
+template <typename T, typename Compare>
+typename FrozenBST<T, Compare>::const_iterator&
+FrozenBST<T, Compare>::const_iterator::operator--() {
+  if (index_ == 0) {
+    index_ = tree_->Rightmost(1);
+  } else if (2 * index_ <= tree_->values_.size()) {
+    index_ = tree_->Rightmost(2 * index_);
+  } else {
+    index_ >>= std::countr_zero(index_) + 1;
+  }
+
+  return *this;
+}
+
+template <typename T, typename Compare>
+typename FrozenBST<T, Compare>::const_iterator
+FrozenBST<T, Compare>::const_iterator::operator--(int) {
+  const_iterator temp = *this;
+  --*this;
+
+  return temp;
+}
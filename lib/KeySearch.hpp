@@ -0,0 +1,223 @@
+#pragma once
+
+#include <bit>
+#include <compare>
+#include <concepts>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <type_traits>
+
+#if (defined(__x86_64__) || defined(__i386__)) && \
+    (defined(__GNUC__) || defined(__clang__))
+#define BST_KEY_SEARCH_X86 1
+#include <immintrin.h>
+#endif
+
+template <typename Compare>
+concept Transparent = requires { typename Compare::is_transparent; };
+
+template <typename Compare>
+class KeyOrder {
+ public:
+  template <typename A, typename B>
+  static constexpr bool kNative =
+      std::three_way_comparable_with<A, B> &&
+      (std::is_same_v<Compare, std::less<A>> ||
+       std::is_same_v<Compare, std::less<>> ||
+       std::is_same_v<Compare, std::greater<A>> ||
+       std::is_same_v<Compare, std::greater<>>);
+
+  template <typename A, typename B>
+  static auto Order(const Compare& compare, const A& a, const B& b) {
+    if constexpr (kNative<A, B>) {
+      if constexpr (std::is_same_v<Compare, std::greater<A>> ||
+                    std::is_same_v<Compare, std::greater<>>) {
+        return b <=> a;
+      } else {
+        return a <=> b;
+      }
+    } else {
+      if (compare(a, b)) return std::weak_ordering::less;
+      if (compare(b, a)) return std::weak_ordering::greater;
+
+      return std::weak_ordering::equivalent;
+    }
+  }
+};
+
+template <typename T, typename Compare>
+class KeySearch {
+  typedef size_t size_type;
+
+ public:
+  static constexpr bool kVectorized =
+      (std::is_same_v<T, int32_t> || std::is_same_v<T, uint32_t> ||
+       std::is_same_v<T, int64_t> || std::is_same_v<T, uint64_t> ||
+       std::is_same_v<T, float> || std::is_same_v<T, double>) &&
+      (std::is_same_v<Compare, std::less<T>> ||
+       std::is_same_v<Compare, std::less<>>);
+
+  template <typename K>
+  static size_type LowerBound(const T* keys, size_type count, const K& key,
+                              const Compare& compare) {
+    if constexpr (kVectorized && std::is_same_v<K, T>) {
+      return Count<false>(keys, count, key);
+    } else {
+      size_type index = 0;
+      while (index < count && compare(keys[index], key)) {
+        ++index;
+      }
+
+      return index;
+    }
+  }
+
+  template <typename K>
+  static size_type UpperBound(const T* keys, size_type count, const K& key,
+                              const Compare& compare) {
+    if constexpr (kVectorized && std::is_same_v<K, T>) {
+      return Count<true>(keys, count, key);
+    } else {
+      size_type index = 0;
+      while (index < count && !compare(key, keys[index])) {
+        ++index;
+      }
+
+      return index;
+    }
+  }
+
+ private:
+  template <bool Upper>
+  static bool Before(const T& value, const T& key) {
+    return Upper ? !(key < value) : value < key;
+  }
+
+  template <bool Upper>
+  static size_type Scalar(const T* keys, size_type index, size_type count,
+                          const T& key) {
+    while (index < count && Before<Upper>(keys[index], key)) {
+      ++index;
+    }
+
+    return index;
+  }
+
+  template <bool Upper>
+  static size_type Count(const T* keys, size_type count, const T& key) {
+#ifdef BST_KEY_SEARCH_X86
+    static const bool has_avx2 = __builtin_cpu_supports("avx2");
+
+    if (has_avx2) return CountAvx2<Upper>(keys, count, key);
+
+    return CountSse2<Upper>(keys, count, key);
+#else
+    return Scalar<Upper>(keys, 0, count, key);
+#endif
+  }
+
+#ifdef BST_KEY_SEARCH_X86
+  template <bool Upper>
+  __attribute__((target("avx2"))) static size_type CountAvx2(
+      const T* keys, size_type count, const T& key) {
+    constexpr size_type kLanes = 32 / sizeof(T);
+    constexpr unsigned kFull = (1u << kLanes) - 1;
+    size_type index = 0;
+
+    for (; index + kLanes <= count; index += kLanes) {
+      unsigned mask = 0;
+
+      if constexpr (std::is_same_v<T, float>) {
+        __m256 block = _mm256_loadu_ps(keys + index);
+        __m256 probe = _mm256_set1_ps(key);
+        mask = _mm256_movemask_ps(
+            Upper ? _mm256_cmp_ps(block, probe, _CMP_LE_OQ)
+                  : _mm256_cmp_ps(block, probe, _CMP_LT_OQ));
+      } else if constexpr (std::is_same_v<T, double>) {
+        __m256d block = _mm256_loadu_pd(keys + index);
+        __m256d probe = _mm256_set1_pd(key);
+        mask = _mm256_movemask_pd(
+            Upper ? _mm256_cmp_pd(block, probe, _CMP_LE_OQ)
+                  : _mm256_cmp_pd(block, probe, _CMP_LT_OQ));
+      } else {
+        __m256i block = _mm256_loadu_si256(
+            reinterpret_cast<const __m256i*>(keys + index));
+        __m256i probe;
+        __m256i greater;
+
+        if constexpr (sizeof(T) == 4) {
+          probe = _mm256_set1_epi32(static_cast<int32_t>(key));
+          if constexpr (std::is_unsigned_v<T>) {
+            __m256i sign = _mm256_set1_epi32(INT32_MIN);
+            block = _mm256_xor_si256(block, sign);
+            probe = _mm256_xor_si256(probe, sign);
+          }
+          greater = Upper ? _mm256_cmpgt_epi32(block, probe)
+                          : _mm256_cmpgt_epi32(probe, block);
+          mask = _mm256_movemask_ps(_mm256_castsi256_ps(greater));
+        } else {
+          probe = _mm256_set1_epi64x(static_cast<int64_t>(key));
+          if constexpr (std::is_unsigned_v<T>) {
+            __m256i sign = _mm256_set1_epi64x(INT64_MIN);
+            block = _mm256_xor_si256(block, sign);
+            probe = _mm256_xor_si256(probe, sign);
+          }
+          greater = Upper ? _mm256_cmpgt_epi64(block, probe)
+                          : _mm256_cmpgt_epi64(probe, block);
+          mask = _mm256_movemask_pd(_mm256_castsi256_pd(greater));
+        }
+
+        if constexpr (Upper) mask = ~mask & kFull;
+      }
+
+      if (mask != kFull) return index + std::popcount(mask);
+    }
+
+    return Scalar<Upper>(keys, index, count, key);
+  }
+
+  template <bool Upper>
+  static size_type CountSse2(const T* keys, size_type count, const T& key) {
+    constexpr size_type kLanes = 16 / sizeof(T);
+    constexpr unsigned kFull = (1u << kLanes) - 1;
+    size_type index = 0;
+
+    for (; index + kLanes <= count; index += kLanes) {
+      unsigned mask = 0;
+
+      if constexpr (sizeof(T) == 8 && !std::is_same_v<T, double>) {
+        break;
+      } else if constexpr (std::is_same_v<T, float>) {
+        __m128 block = _mm_loadu_ps(keys + index);
+        __m128 probe = _mm_set1_ps(key);
+        mask = _mm_movemask_ps(Upper ? _mm_cmple_ps(block, probe)
+                                     : _mm_cmplt_ps(block, probe));
+      } else if constexpr (std::is_same_v<T, double>) {
+        __m128d block = _mm_loadu_pd(keys + index);
+        __m128d probe = _mm_set1_pd(key);
+        mask = _mm_movemask_pd(Upper ? _mm_cmple_pd(block, probe)
+                                     : _mm_cmplt_pd(block, probe));
+      } else if constexpr (sizeof(T) == 4) {
+        __m128i block =
+            _mm_loadu_si128(reinterpret_cast<const __m128i*>(keys + index));
+        __m128i probe = _mm_set1_epi32(static_cast<int32_t>(key));
+        if constexpr (std::is_unsigned_v<T>) {
+          __m128i sign = _mm_set1_epi32(INT32_MIN);
+          block = _mm_xor_si128(block, sign);
+          probe = _mm_xor_si128(probe, sign);
+        }
+        __m128i greater = Upper ? _mm_cmpgt_epi32(block, probe)
+                                : _mm_cmpgt_epi32(probe, block);
+        mask = _mm_movemask_ps(_mm_castsi128_ps(greater));
+
+        if constexpr (Upper) mask = ~mask & kFull;
+      }
+
+      if (mask != kFull) return index + std::popcount(mask);
+    }
+
+    return Scalar<Upper>(keys, index, count, key);
+  }
+#endif
+};
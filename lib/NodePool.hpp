@@ -0,0 +1,228 @@
+#pragma once
+#include <cstddef>
+#include <deque>
+#include <memory>
+#include <new>
+#include <type_traits>
+
+class NodePool {
+  typedef size_t size_type;
+
+  struct Slab {
+    Slab* next;
+    size_type bytes;
+    size_type alignment;
+  };
+
+ public:
+  // Hands out chunks of one size and alignment. Every bin draws its slabs
+  // from the pool that owns it, so allocators rebound to other node types
+  // share the pool and its lifetime while keeping separate free lists.
+  class Bin {
+   public:
+    Bin(NodePool* pool, size_type size, size_type alignment)
+        : pool_(pool), size_(size), alignment_(alignment) {}
+
+    Bin(const Bin& other) = delete;
+    Bin& operator=(const Bin& other) = delete;
+
+    void* Allocate() {
+      if (free_list_ != nullptr) {
+        Chunk* chunk = free_list_;
+        free_list_ = chunk->next;
+        --free_count_;
+
+        return chunk;
+      }
+
+      if (cursor_ == end_) {
+        Grow(next_capacity_);
+      }
+
+      void* chunk = cursor_;
+      cursor_ += size_;
+
+      return chunk;
+    }
+
+    void Deallocate(void* ptr) {
+      Chunk* chunk = static_cast<Chunk*>(ptr);
+      chunk->next = free_list_;
+      free_list_ = chunk;
+      ++free_count_;
+    }
+
+    void Reserve(size_type count) {
+      size_type available =
+          free_count_ + static_cast<size_type>(end_ - cursor_) / size_;
+
+      if (count > available) {
+        Grow(count - available);
+      }
+    }
+
+   private:
+    friend NodePool;
+
+    struct Chunk {
+      Chunk* next;
+    };
+
+    void Grow(size_type capacity) {
+      while (cursor_ != end_) {
+        Deallocate(cursor_);
+        cursor_ += size_;
+      }
+
+      if (capacity < kMinSlabCapacity) {
+        capacity = kMinSlabCapacity;
+      }
+
+      cursor_ = pool_->NewSlab(capacity * size_, alignment_);
+      end_ = cursor_ + capacity * size_;
+
+      if (next_capacity_ < kMaxSlabCapacity) {
+        next_capacity_ *= 2;
+      }
+    }
+
+    void Reset() {
+      free_list_ = nullptr;
+      free_count_ = 0;
+      cursor_ = nullptr;
+      end_ = nullptr;
+      next_capacity_ = kMinSlabCapacity;
+    }
+
+    NodePool* pool_;
+    size_type size_;
+    size_type alignment_;
+    Chunk* free_list_ = nullptr;
+    size_type free_count_ = 0;
+    unsigned char* cursor_ = nullptr;
+    unsigned char* end_ = nullptr;
+    size_type next_capacity_ = kMinSlabCapacity;
+  };
+
+  NodePool() = default;
+  NodePool(const NodePool& other) = delete;
+  NodePool& operator=(const NodePool& other) = delete;
+
+  ~NodePool() { Release(); }
+
+  template <typename T>
+  Bin& GetBin() {
+    constexpr size_type alignment = alignof(T) > alignof(typename Bin::Chunk)
+                                        ? alignof(T)
+                                        : alignof(typename Bin::Chunk);
+    constexpr size_type size =
+        ((sizeof(T) > sizeof(typename Bin::Chunk) ? sizeof(T)
+                                                  : sizeof(typename Bin::Chunk)) +
+         alignment - 1) /
+        alignment * alignment;
+
+    for (Bin& bin : bins_) {
+      if (bin.size_ == size && bin.alignment_ == alignment) return bin;
+    }
+
+    return bins_.emplace_back(this, size, alignment);
+  }
+
+  void Release() {
+    while (slabs_ != nullptr) {
+      Slab* next = slabs_->next;
+      ::operator delete(slabs_, slabs_->bytes,
+                        std::align_val_t(slabs_->alignment));
+      slabs_ = next;
+    }
+
+    for (Bin& bin : bins_) {
+      bin.Reset();
+    }
+  }
+
+ private:
+  static constexpr size_type kMinSlabCapacity = 64;
+  static constexpr size_type kMaxSlabCapacity = 1 << 16;
+
+  unsigned char* NewSlab(size_type bytes, size_type alignment) {
+    if (alignment < alignof(Slab)) {
+      alignment = alignof(Slab);
+    }
+
+    size_type header = (sizeof(Slab) + alignment - 1) / alignment * alignment;
+    Slab* slab = static_cast<Slab*>(
+        ::operator new(header + bytes, std::align_val_t(alignment)));
+    slab->next = slabs_;
+    slab->bytes = header + bytes;
+    slab->alignment = alignment;
+    slabs_ = slab;
+
+    return reinterpret_cast<unsigned char*>(slab) + header;
+  }
+
+  std::deque<Bin> bins_;
+  Slab* slabs_ = nullptr;
+};
+
+template <typename T>
+class PoolAllocator {
+ public:
+  typedef T value_type;
+  typedef size_t size_type;
+  typedef std::true_type propagate_on_container_move_assignment;
+  typedef std::true_type propagate_on_container_swap;
+
+  PoolAllocator()
+      : pool_(std::make_shared<NodePool>()), bin_(&pool_->GetBin<T>()) {}
+
+  template <typename U>
+  PoolAllocator(const PoolAllocator<U>& other)
+      : pool_(other.pool_), bin_(&pool_->GetBin<T>()) {}
+
+  PoolAllocator select_on_container_copy_construction() const {
+    return PoolAllocator();
+  }
+
+  T* allocate(size_type count) {
+    if (count == 1) return static_cast<T*>(bin_->Allocate());
+
+    return static_cast<T*>(
+        ::operator new(count * sizeof(T), std::align_val_t(alignof(T))));
+  }
+
+  void deallocate(T* ptr, size_type count) {
+    if (count == 1) {
+      bin_->Deallocate(ptr);
+    } else {
+      ::operator delete(ptr, count * sizeof(T), std::align_val_t(alignof(T)));
+    }
+  }
+
+  void reserve(size_type count) { bin_->Reserve(count); }
+
+  bool release() {
+    if (pool_.use_count() != 1) return false;
+
+    pool_->Release();
+
+    return true;
+  }
+
+  template <typename U>
+  bool operator==(const PoolAllocator<U>& other) const {
+    return pool_ == other.pool_;
+  }
+
+  template <typename U>
+  bool operator!=(const PoolAllocator<U>& other) const {
+    return pool_ != other.pool_;
+  }
+
+ private:
+  template <typename U>
+  friend class PoolAllocator;
+
+  std::shared_ptr<NodePool> pool_;
+  NodePool::Bin* bin_;
+};
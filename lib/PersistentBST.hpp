@@ -0,0 +1,533 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <functional>
+#include <iterator>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "KeySearch.hpp"
+#include "Tree.hpp"
+
+template <typename T, typename Compare = std::less<T>>
+class PersistentBST {
+  typedef T value_type;
+  typedef size_t size_type;
+
+  struct Node {
+    Node(const value_type& value_, const Node* left_, const Node* right_)
+        : value(value_), left(left_), right(right_),
+          height(std::max(Height(left_), Height(right_)) + 1) {}
+
+    const value_type value;
+    const Node* const left;
+    const Node* const right;
+    const int height;
+    mutable std::atomic<size_type> references = 1;
+  };
+
+ public:
+  class const_iterator {
+   public:
+    typedef std::forward_iterator_tag iterator_category;
+    typedef T value_type;
+    typedef std::ptrdiff_t difference_type;
+    typedef const T* pointer;
+    typedef const T& reference;
+
+    const_iterator() = default;
+
+    const value_type& operator*() const { return path_.back()->value; }
+    const value_type* operator->() const { return &**this; }
+
+    const_iterator& operator++();
+    const_iterator operator++(int);
+
+    bool operator==(const const_iterator& other) const {
+      return Current() == other.Current();
+    }
+    bool operator!=(const const_iterator& other) const {
+      return Current() != other.Current();
+    }
+
+   private:
+    friend PersistentBST;
+
+    const Node* Current() const {
+      return path_.empty() ? nullptr : path_.back();
+    }
+
+    void Descend(const Node* node);
+
+    std::vector<const Node*> path_;
+  };
+
+  PersistentBST() = default;
+  explicit PersistentBST(const Compare& compare) : compare_(compare) {}
+
+  template <typename InputIt>
+  PersistentBST(InputIt first, InputIt last,
+                const Compare& compare = Compare());
+
+  template <typename ForwardIt>
+  PersistentBST(sorted_unique_t, ForwardIt first, ForwardIt last,
+                const Compare& compare = Compare());
+
+  PersistentBST(const PersistentBST& other);
+  PersistentBST& operator=(const PersistentBST& other);
+
+  ~PersistentBST() { Release(root_); }
+
+  PersistentBST snapshot() const { return *this; }
+
+  template <IteratorType type>
+    requires(type == IteratorType::INORDER)
+  const_iterator begin() const {
+    const_iterator it;
+    it.Descend(root_);
+
+    return it;
+  }
+
+  template <IteratorType type>
+    requires(type == IteratorType::INORDER)
+  const_iterator end() const {
+    return const_iterator();
+  }
+
+  size_type size() const { return size_; }
+
+  bool empty() const { return size_ == 0; }
+
+  bool insert(const value_type& value);
+
+  size_type erase(const value_type& key);
+
+  template <typename K>
+    requires Transparent<Compare>
+  size_type erase(const K& key) {
+    return Erase(key);
+  }
+
+  void clear();
+
+  const_iterator find(const value_type& key) const { return Find(key); }
+
+  template <typename K>
+    requires Transparent<Compare>
+  const_iterator find(const K& key) const {
+    return Find(key);
+  }
+
+  bool contains(const value_type& key) const {
+    return Find(key) != const_iterator();
+  }
+
+  template <typename K>
+    requires Transparent<Compare>
+  bool contains(const K& key) const {
+    return Find(key) != const_iterator();
+  }
+
+  const_iterator lower_bound(const value_type& key) const {
+    return LowerBound(key);
+  }
+
+  template <typename K>
+    requires Transparent<Compare>
+  const_iterator lower_bound(const K& key) const {
+    return LowerBound(key);
+  }
+
+  template <typename Function>
+  void for_each(Function&& function) const;
+
+ private:
+  static int Height(const Node* node) {
+    return (node == nullptr) ? 0 : node->height;
+  }
+
+  static const Node* Acquire(const Node* node);
+  static void Release(const Node* node);
+
+  struct Releaser {
+    void operator()(const Node* node) const { Release(node); }
+  };
+
+  // Holds one reference, so a node under construction never leaks the
+  // children it has already claimed.
+  typedef std::unique_ptr<const Node, Releaser> NodeGuard;
+
+  static NodeGuard Make(const value_type& value, NodeGuard left,
+                        NodeGuard right);
+
+  static NodeGuard Balance(const value_type& value, NodeGuard left,
+                           NodeGuard right);
+
+  template <typename ForwardIt>
+  static NodeGuard Build(ForwardIt& it, size_type count);
+
+  NodeGuard Insert(const Node* node, const value_type& value);
+
+  template <typename K>
+  NodeGuard Erase(const Node* node, const K& key, bool& erased);
+
+  template <typename K>
+  size_type Erase(const K& key);
+
+  static NodeGuard EraseMin(const Node* node);
+
+  template <typename K>
+  const_iterator Find(const K& key) const;
+
+  template <typename K>
+  const_iterator LowerBound(const K& key) const;
+
+  const Node* root_ = nullptr;
+  size_type size_ = 0;
+  [[no_unique_address]] Compare compare_;
+};
+
+template <typename T, typename Compare>
+template <typename InputIt>
+PersistentBST<T, Compare>::PersistentBST(InputIt first, InputIt last,
+                                         const Compare& compare)
+    : compare_(compare) {
+  for (; first != last; ++first) {
+    insert(*first);
+  }
+}
+
+template <typename T, typename Compare>
+template <typename ForwardIt>
+PersistentBST<T, Compare>::PersistentBST(sorted_unique_t, ForwardIt first,
+                                         ForwardIt last,
+                                         const Compare& compare)
+    : size_(std::distance(first, last)), compare_(compare) {
+  root_ = Build(first, size_).release();
+}
+
+template <typename T, typename Compare>
+PersistentBST<T, Compare>::PersistentBST(const PersistentBST& other)
+    : root_(Acquire(other.root_)), size_(other.size_),
+      compare_(other.compare_) {}
+
+template <typename T, typename Compare>
+PersistentBST<T, Compare>& PersistentBST<T, Compare>::operator=(
+    const PersistentBST& other) {
+  const Node* root = Acquire(other.root_);
+  Release(root_);
+
+  root_ = root;
+  size_ = other.size_;
+  compare_ = other.compare_;
+
+  return *this;
+}
+
+template <typename T, typename Compare>
+bool PersistentBST<T, Compare>::insert(const value_type& value) {
+  const Node* root = Insert(root_, value).release();
+  if (root == nullptr) return false;
+
+  Release(root_);
+  root_ = root;
+  ++size_;
+
+  return true;
+}
+
+template <typename T, typename Compare>
+typename PersistentBST<T, Compare>::size_type PersistentBST<T, Compare>::erase(
+    const value_type& key) {
+  return Erase(key);
+}
+
+template <typename T, typename Compare>
+void PersistentBST<T, Compare>::clear() {
+  Release(root_);
+  root_ = nullptr;
+  size_ = 0;
+}
+
+template <typename T, typename Compare>
+template <typename Function>
+void PersistentBST<T, Compare>::for_each(Function&& function) const {
+  const_iterator last = end<IteratorType::INORDER>();
+
+  for (const_iterator it = begin<IteratorType::INORDER>(); it != last; ++it) {
+    function(*it);
+  }
+}
+
+template <typename T, typename Compare>
+const typename PersistentBST<T, Compare>::Node*
+PersistentBST<T, Compare>::Acquire(const Node* node) {
+  if (node != nullptr) {
+    node->references.fetch_add(1, std::memory_order_relaxed);
+  }
+
+  return node;
+}
+
+template <typename T, typename Compare>
+void PersistentBST<T, Compare>::Release(const Node* node) {
+  std::vector<const Node*> stack;
+
+  while (true) {
+    if (node != nullptr &&
+        node->references.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+      stack.push_back(node->left);
+      stack.push_back(node->right);
+      delete node;
+    }
+
+    if (stack.empty()) break;
+
+    node = stack.back();
+    stack.pop_back();
+  }
+}
+
+template <typename T, typename Compare>
+typename PersistentBST<T, Compare>::NodeGuard PersistentBST<T, Compare>::Make(
+    const value_type& value, NodeGuard left, NodeGuard right) {
+  NodeGuard node(new Node(value, left.get(), right.get()));
+  left.release();
+  right.release();
+
+  return node;
+}
+
+template <typename T, typename Compare>
+typename PersistentBST<T, Compare>::NodeGuard
+PersistentBST<T, Compare>::Balance(const value_type& value, NodeGuard left,
+                                   NodeGuard right) {
+  if (Height(left.get()) > Height(right.get()) + 1) {
+    const Node* top = left.get();
+
+    if (Height(top->left) >= Height(top->right)) {
+      NodeGuard lower = Make(value, NodeGuard(Acquire(top->right)),
+                             std::move(right));
+
+      return Make(top->value, NodeGuard(Acquire(top->left)),
+                  std::move(lower));
+    }
+
+    const Node* pivot = top->right;
+    NodeGuard lower_left = Make(top->value, NodeGuard(Acquire(top->left)),
+                                NodeGuard(Acquire(pivot->left)));
+    NodeGuard lower_right = Make(value, NodeGuard(Acquire(pivot->right)),
+                                 std::move(right));
+
+    return Make(pivot->value, std::move(lower_left), std::move(lower_right));
+  }
+
+  if (Height(right.get()) > Height(left.get()) + 1) {
+    const Node* top = right.get();
+
+    if (Height(top->right) >= Height(top->left)) {
+      NodeGuard lower = Make(value, std::move(left),
+                             NodeGuard(Acquire(top->left)));
+
+      return Make(top->value, std::move(lower),
+                  NodeGuard(Acquire(top->right)));
+    }
+
+    const Node* pivot = top->left;
+    NodeGuard lower_left = Make(value, std::move(left),
+                                NodeGuard(Acquire(pivot->left)));
+    NodeGuard lower_right = Make(top->value, NodeGuard(Acquire(pivot->right)),
+                                 NodeGuard(Acquire(top->right)));
+
+    return Make(pivot->value, std::move(lower_left), std::move(lower_right));
+  }
+
+  return Make(value, std::move(left), std::move(right));
+}
+
+template <typename T, typename Compare>
+template <typename ForwardIt>
+typename PersistentBST<T, Compare>::NodeGuard PersistentBST<T, Compare>::Build(
+    ForwardIt& it, size_type count) {
+  if (count == 0) return nullptr;
+
+  size_type left_count = (count - 1) / 2;
+  NodeGuard left = Build(it, left_count);
+
+  ForwardIt middle = it;
+  ++it;
+
+  NodeGuard right = Build(it, count - left_count - 1);
+
+  return Make(*middle, std::move(left), std::move(right));
+}
+
+template <typename T, typename Compare>
+typename PersistentBST<T, Compare>::NodeGuard PersistentBST<T, Compare>::Insert(
+    const Node* node, const value_type& value) {
+  if (node == nullptr) return Make(value, nullptr, nullptr);
+
+  auto order = KeyOrder<Compare>::Order(compare_, value, node->value);
+
+  if (order < 0) {
+    NodeGuard left = Insert(node->left, value);
+    if (left == nullptr) return nullptr;
+
+    return Balance(node->value, std::move(left),
+                   NodeGuard(Acquire(node->right)));
+  }
+
+  if (order > 0) {
+    NodeGuard right = Insert(node->right, value);
+    if (right == nullptr) return nullptr;
+
+    return Balance(node->value, NodeGuard(Acquire(node->left)),
+                   std::move(right));
+  }
+
+  return nullptr;
+}
+
+template <typename T, typename Compare>
+template <typename K>
+typename PersistentBST<T, Compare>::NodeGuard PersistentBST<T, Compare>::Erase(
+    const Node* node, const K& key, bool& erased) {
+  if (node == nullptr) return nullptr;
+
+  auto order = KeyOrder<Compare>::Order(compare_, key, node->value);
+
+  if (order < 0) {
+    NodeGuard left = Erase(node->left, key, erased);
+    if (!erased) return nullptr;
+
+    return Balance(node->value, std::move(left),
+                   NodeGuard(Acquire(node->right)));
+  }
+
+  if (order > 0) {
+    NodeGuard right = Erase(node->right, key, erased);
+    if (!erased) return nullptr;
+
+    return Balance(node->value, NodeGuard(Acquire(node->left)),
+                   std::move(right));
+  }
+
+  erased = true;
+
+  if (node->left == nullptr) return NodeGuard(Acquire(node->right));
+  if (node->right == nullptr) return NodeGuard(Acquire(node->left));
+
+  const Node* successor = node->right;
+  while (successor->left != nullptr) {
+    successor = successor->left;
+  }
+
+  NodeGuard right = EraseMin(node->right);
+
+  return Balance(successor->value, NodeGuard(Acquire(node->left)),
+                 std::move(right));
+}
+
+template <typename T, typename Compare>
+template <typename K>
+typename PersistentBST<T, Compare>::size_type PersistentBST<T, Compare>::Erase(
+    const K& key) {
+  bool erased = false;
+  const Node* root = Erase(root_, key, erased).release();
+  if (!erased) return 0;
+
+  Release(root_);
+  root_ = root;
+  --size_;
+
+  return 1;
+}
+
+template <typename T, typename Compare>
+typename PersistentBST<T, Compare>::NodeGuard
+PersistentBST<T, Compare>::EraseMin(const Node* node) {
+  if (node->left == nullptr) return NodeGuard(Acquire(node->right));
+
+  NodeGuard left = EraseMin(node->left);
+
+  return Balance(node->value, std::move(left),
+                 NodeGuard(Acquire(node->right)));
+}
+
+template <typename T, typename Compare>
+template <typename K>
+typename PersistentBST<T, Compare>::const_iterator
+PersistentBST<T, Compare>::Find(const K& key) const {
+  const_iterator it;
+  const Node* node = root_;
+
+  while (node != nullptr) {
+    auto order = KeyOrder<Compare>::Order(compare_, key, node->value);
+
+    if (order < 0) {
+      it.path_.push_back(node);
+      node = node->left;
+    } else if (order > 0) {
+      node = node->right;
+    } else {
+      it.path_.push_back(node);
+      return it;
+    }
+  }
+
+  return const_iterator();
+}
+
+template <typename T, typename Compare>
+template <typename K>
+typename PersistentBST<T, Compare>::const_iterator
+PersistentBST<T, Compare>::LowerBound(const K& key) const {
+  const_iterator it;
+  const Node* node = root_;
+
+  while (node != nullptr) {
+    auto order = KeyOrder<Compare>::Order(compare_, key, node->value);
+
+    if (order < 0) {
+      it.path_.push_back(node);
+      node = node->left;
+    } else if (order > 0) {
+      node = node->right;
+    } else {
+      it.path_.push_back(node);
+      break;
+    }
+  }
+
+  return it;
+}
+
+template <typename T, typename Compare>
+void PersistentBST<T, Compare>::const_iterator::Descend(const Node* node) {
+  for (; node != nullptr; node = node->left) {
+    path_.push_back(node);
+  }
+}
+
+template <typename T, typename Compare>
+typename PersistentBST<T, Compare>::const_iterator&
+PersistentBST<T, Compare>::const_iterator::operator++() {
+  const Node* node = path_.back();
+  path_.pop_back();
+  Descend(node->right);
+
+  return *this;
+}
+
+template <typename T, typename Compare>
+typename PersistentBST<T, Compare>::const_iterator
+PersistentBST<T, Compare>::const_iterator::operator++(int) {
+  const_iterator temp = *this;
+  ++*this;
+
+  return temp;
+}
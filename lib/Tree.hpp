@@ -1,116 +1,609 @@
 #pragma once
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <future>
 #include <iostream>
 #include <locale>
+#include <memory>
+#include <optional>
+#include <span>
+#include <system_error>
+#include <thread>
+#include <type_traits>
+#include <utility>
+
+#include "Balance.hpp"
+#include "CompactPool.hpp"
+#include "KeySearch.hpp"
+
+enum class ExecutionPolicy { SEQUENTIAL, PARALLEL };
+
+enum class IteratorType { INORDER, POSTORDER, PREORDER };
+
+struct sorted_unique_t {
+  explicit sorted_unique_t() = default;
+};
+
+inline constexpr sorted_unique_t sorted_unique{};
+
+template <bool Counted, typename Size = size_t>
+class NodeCount {};
+
+template <typename Size>
+class NodeCount<true, Size> {
+ public:
+  Size count = 1;
+};
+
+template <bool Threaded, typename Link>
+class NodeThread {};
+
+template <typename Link>
+class NodeThread<true, Link> {
+ public:
+  Link prev = nullptr;
+  Link next = nullptr;
+};
+
+template <typename T, bool Counted = false, bool Compact = false,
+          bool Threaded = false>
+class Node
+    : public NodeCount<Counted, std::conditional_t<Compact, uint32_t, size_t>>,
+      public NodeThread<
+          Threaded,
+          std::conditional_t<Compact,
+                             CompactLink<Node<T, Counted, Compact, Threaded>>,
+                             Node<T, Counted, Compact, Threaded>*>> {
+  typedef NodeCount<Counted, std::conditional_t<Compact, uint32_t, size_t>>
+      count_type;
+  typedef std::conditional_t<Compact, CompactLink<Node>, Node*> link_type;
+  typedef NodeThread<Threaded, link_type> thread_type;
 
-template <typename T>
-class Node {
  public:
+  static constexpr bool kCounted = Counted;
+  static constexpr bool kCompact = Compact;
+  static constexpr bool kThreaded = Threaded;
+
   T value;
+  signed char balance = 0;
 
   Node() = default;
   Node(T value_)
-      : value(value_), parent(nullptr), left(nullptr), right(nullptr) {}
+      : value(std::move(value_)), parent(nullptr), left(nullptr),
+        right(nullptr) {}
+
+  template <typename... Args>
+  explicit Node(std::in_place_t, Args&&... args)
+      : value(std::forward<Args>(args)...) {}
 
   Node(const Node& other)
-      : value(other.value),
+      : count_type(other),
+        thread_type(other),
+        value(other.value),
+        balance(other.balance),
         parent(other.parent),
         left(other.left),
         right(other.right) {}
 
-  Node* parent = nullptr;
-  Node* left = nullptr;
-  Node* right = nullptr;
+  link_type parent = nullptr;
+  link_type left = nullptr;
+  link_type right = nullptr;
+};
+
+template <typename NodeType, typename NodeAllocator>
+class NodeHandle {
+  typedef std::allocator_traits<NodeAllocator> node_allocator_traits;
+
+ public:
+  typedef decltype(NodeType::value) value_type;
+  typedef NodeAllocator allocator_type;
+
+  NodeHandle() = default;
+  NodeHandle(NodeType* node, const NodeAllocator& allocator)
+      : node_(node), allocator_(allocator) {}
+
+  NodeHandle(NodeHandle&& other) noexcept
+      : node_(other.node_), allocator_(std::move(other.allocator_)) {
+    other.node_ = nullptr;
+    other.allocator_.reset();
+  }
+
+  NodeHandle& operator=(NodeHandle&& other) noexcept {
+    if (this == &other) return *this;
+
+    Reset();
+    node_ = other.node_;
+    if (other.allocator_.has_value()) {
+      allocator_.emplace(std::move(*other.allocator_));
+    }
+    other.node_ = nullptr;
+    other.allocator_.reset();
+
+    return *this;
+  }
+
+  NodeHandle(const NodeHandle& other) = delete;
+  NodeHandle& operator=(const NodeHandle& other) = delete;
+
+  ~NodeHandle() { Reset(); }
+
+  bool empty() const { return node_ == nullptr; }
+
+  explicit operator bool() const { return node_ != nullptr; }
+
+  value_type& value() const { return node_->value; }
+
+  allocator_type get_allocator() const { return *allocator_; }
+
+  NodeType* Release() {
+    NodeType* node = node_;
+    node_ = nullptr;
+    allocator_.reset();
+
+    return node;
+  }
+
+ private:
+  void Reset() {
+    if (node_ == nullptr) return;
+
+    node_allocator_traits::destroy(*allocator_, node_);
+    allocator_->deallocate(node_, 1);
+    node_ = nullptr;
+    allocator_.reset();
+  }
+
+  NodeType* node_ = nullptr;
+  std::optional<NodeAllocator> allocator_;
 };
 
-template <typename T, typename Allocator = std::allocator<Node<T>>>
+template <typename T, typename Allocator = std::allocator<Node<T>>,
+          typename Balance = Unbalanced, typename Compare = std::less<T>>
 class Tree {
   typedef T value_type;
   typedef size_t size_type;
+  typedef std::ptrdiff_t difference_type;
 
  public:
-  void Insert(int value);
+  typedef Node<T, Balance::kCounted, Balance::kCompact, Balance::kThreaded>
+      node_type;
+  typedef std::conditional_t<
+      Balance::kCompact, CompactAllocator<node_type>,
+      typename std::allocator_traits<Allocator>::template rebind_alloc<
+          node_type>>
+      node_allocator_type;
+  typedef std::allocator_traits<node_allocator_type> node_allocator_traits;
+  typedef NodeHandle<node_type, node_allocator_type> node_handle;
+
+  // Compact nodes always come from the shared CompactPool, so any other
+  // allocator would be silently ignored.
+  static_assert(
+      !Balance::kCompact ||
+          std::is_same_v<typename std::allocator_traits<Allocator>::
+                             template rebind_alloc<node_type>,
+                         std::allocator<node_type>>,
+      "Compact nodes only support std::allocator.");
+
+  Tree() = default;
+  explicit Tree(const Compare& compare) : compare_(compare) {}
+  Tree(const Compare& compare, const node_allocator_type& allocator)
+      : allocator_(allocator), compare_(compare) {}
+
+  Tree(Tree&& other) noexcept(std::is_nothrow_copy_constructible_v<Compare>);
+
+  Tree& operator=(Tree&& other) noexcept(
+      kStealsOnMove && std::is_nothrow_copy_assignable_v<Compare>);
 
-  void Remove(int value);
+  template <typename V>
+  std::pair<node_type*, bool> Insert(V&& value);
 
-  Node<value_type>* Find(const value_type& value);
+  template <typename V>
+  std::pair<node_type*, bool> Insert(node_type* hint, V&& value);
 
-  Node<value_type>* Copy(Node<value_type>* node);
+  template <typename... Args>
+  std::pair<node_type*, bool> Emplace(Args&&... args);
+
+  std::pair<node_type*, bool> Insert(node_handle&& handle);
+
+  template <typename K>
+  node_handle Extract(const K& key);
+
+  node_handle Extract(node_type* node);
+
+  void Remove(const value_type& value);
+
+  void Erase(node_type* node);
+
+  size_type EraseRange(node_type* first, node_type* last);
+
+  size_type CountRange(const value_type& low, const value_type& high) const;
+
+  template <typename K>
+  node_type* Find(const K& key) const;
+
+  node_type* Copy(node_type* node, size_type count = 0);
+
+  template <typename InputIt>
+  void Build(InputIt first, size_type count);
 
   void Deallocate();
 
-  Node<value_type>* Next(value_type value);
+  void Reserve(size_type count);
+
+  void Assign(const Tree& other);
+
+  void Swap(Tree& other) noexcept;
+
+  void Merge(Tree& source);
+
+  void Union(const Tree& other, ExecutionPolicy policy);
+
+  void Intersection(const Tree& other, ExecutionPolicy policy);
+
+  void Difference(const Tree& other, ExecutionPolicy policy);
 
-  size_type GetSize() { return size_; }
+  template <IteratorType type, typename Function>
+  void Traverse(Function&& function) const;
 
-  Node<value_type>* GetRoot() { return this->root_; }
+  template <typename K>
+  node_type* LowerBound(const K& key) const;
 
-  void SetRoot(Node<T>* node) { root_ = node; }
+  template <typename K>
+  node_type* Next(const K& key) const;
+
+  template <typename K>
+  std::pair<node_type*, node_type*> EqualRange(const K& key) const;
+
+  template <typename K, typename Sink>
+  void FindBatch(std::span<const K> keys, Sink&& sink) const;
+
+  size_type Rank(const value_type& value) const;
+
+  node_type* Select(size_type index);
+
+  static node_type* Select(node_type* root, size_type index);
+
+  static size_type Position(const node_type* node);
+
+  static node_type* Advance(node_type* node, difference_type offset);
+
+  static difference_type Distance(const node_type* from, const node_type* to);
+
+  size_type GetSize() const { return size_; }
+
+  node_type* GetRoot() const { return this->root_; }
+
+  void SetRoot(node_type* node) {
+    root_ = node;
+    UpdateBounds();
+  }
 
   void SetSize(int size) { size_ = size; }
 
-  std::allocator<Node<value_type>> get_allocator() { return this->allocator_;}
+  const Compare& GetCompare() const { return compare_; }
+
+  void SetCompare(const Compare& compare) { compare_ = compare; }
+
+  size_type GetParallelThreshold() const { return parallel_threshold_; }
+
+  void SetParallelThreshold(size_type threshold) {
+    parallel_threshold_ = threshold;
+  }
+
+  const node_allocator_type& GetAllocator() const { return allocator_; }
+
+  template <typename OtherAllocator>
+  static node_allocator_type Rebind(const OtherAllocator& allocator) {
+    if constexpr (Balance::kCompact) {
+      return node_allocator_type();
+    } else {
+      static_assert(std::is_constructible_v<node_allocator_type,
+                                            const OtherAllocator&>,
+                    "The allocator cannot be rebound to the node type.");
+
+      return node_allocator_type(allocator);
+    }
+  }
 
  private:
-  Node<value_type>* Insert(Node<value_type>* node, int value);
-  Node<T>* Remove(Node<T>* node, int value);
-  Node<value_type>* Min(Node<value_type>* node);
-  Node<value_type>* Find(Node<value_type>* node, value_type value);
-  void Deallocate(Node<value_type>* node);
+  static node_type* Min(node_type* node);
+  static node_type* Max(node_type* node);
+  static node_type* Predecessor(node_type* node);
+  static node_type* Successor(node_type* node);
+  static node_type* Root(node_type* node);
+  template <typename K>
+  node_type* Descend(const K& key, node_type*& parent, bool& left) const;
+  template <typename K>
+  auto Order(const K& key, const value_type& value) const;
+  template <typename... Args>
+  node_type* Create(Args&&... args);
+  node_type* Link(node_type* parent, bool left, node_type* node);
+  void Unlink(node_type* node);
+  void UpdateBounds();
+  void Thread();
+  node_type* Clone(const node_type* node);
+  template <typename InputIt>
+  node_type* Build(InputIt& it, size_type count, int depth, int max_depth);
+  node_type* Duplicate(const node_type* node, int forks);
+  void Deallocate(node_type* node);
+  size_type Free(node_type* node, int forks);
+  size_type Free(node_type* node);
+  void Destroy(node_type* node);
+  node_type* Flatten();
+  static void Append(node_type*& head, node_type*& tail, node_type* node);
+  void Relink(node_type* list, size_type count);
+  node_type* Relink(node_type*& list, size_type count, int depth,
+                    int max_depth);
+  static int MaxDepth(size_type count);
 
-  Node<value_type>* Next(Node<value_type>* node, value_type value) {
-    Node<value_type>* result = nullptr;
+  struct Probe {
+    node_type* match;
+    node_type* above;
+  };
 
-    while (node != nullptr) {
-      if (value < node->value) {
-        if (result == nullptr || node->value < result->value) {
-          result = node;
+  template <typename K>
+  Probe Search(const K& key) const;
+
+  struct Pieces {
+    node_type* left;
+    node_type* middle;
+    node_type* right;
+  };
+
+  class Garbage {
+   public:
+    void Add(node_type* node);
+    void Append(const Garbage& other);
+
+    node_type* head = nullptr;
+    node_type* tail = nullptr;
+  };
+
+  static constexpr size_type kParallelGrain = 1 << 14;
+  static constexpr size_type kParallelThreshold = 1 << 20;
+  static constexpr bool kParallelAllocator =
+      std::is_same_v<node_allocator_type, std::allocator<node_type>>;
+  static constexpr bool kStealsOnMove =
+      node_allocator_traits::propagate_on_container_move_assignment::value ||
+      node_allocator_traits::is_always_equal::value;
+
+  void Steal(Tree& other) noexcept;
+  static constexpr size_type kBatchGroup = 16;
+
+  static void Prefetch(const node_type* node);
+
+  Pieces Split(node_type* root, const value_type& value) const;
+  static node_type* Join(node_type* left, node_type* right);
+  node_type* Union(node_type* first, node_type* second, Garbage& garbage,
+                   int forks) const;
+  node_type* Intersection(node_type* first, const node_type* second,
+                          Garbage& garbage, int forks) const;
+  node_type* Difference(node_type* first, const node_type* second,
+                        Garbage& garbage, int forks) const;
+  template <typename Left, typename Right>
+  static void Fork(int forks, Left&& left, Right&& right);
+  static int Forks(ExecutionPolicy policy, size_type size);
+  int Forks(size_type size) const;
+  void Collect(const Garbage& garbage);
+
+  node_allocator_type allocator_;
+  [[no_unique_address]] Compare compare_;
+  size_type parallel_threshold_ = kParallelThreshold;
+
+  node_type* root_ = nullptr;
+  node_type* leftmost_ = nullptr;
+  node_type* rightmost_ = nullptr;
+  size_type size_ = 0;
+};
+
+template <typename T, typename Allocator, typename Balance, typename Compare>
+template <typename V>
+std::pair<typename Tree<T, Allocator, Balance, Compare>::node_type*, bool>
+Tree<T, Allocator, Balance, Compare>::Insert(V&& value) {
+  if constexpr (!std::is_same_v<std::remove_cvref_t<V>, T>) {
+    return Emplace(std::forward<V>(value));
+  } else {
+    node_type* parent = nullptr;
+    bool left = false;
+    node_type* node = Descend(value, parent, left);
+
+    if (node != nullptr) return std::make_pair(node, false);
+
+    return std::make_pair(
+        Link(parent, left, Create(std::forward<V>(value))), true);
+  }
+}
+
+template <typename T, typename Allocator, typename Balance, typename Compare>
+template <typename V>
+std::pair<typename Tree<T, Allocator, Balance, Compare>::node_type*, bool>
+Tree<T, Allocator, Balance, Compare>::Insert(node_type* hint, V&& value) {
+  if constexpr (!std::is_same_v<std::remove_cvref_t<V>, T>) {
+    return Insert(hint, T(std::forward<V>(value)));
+  } else {
+    node_type* parent = nullptr;
+    bool left = false;
+
+    if (hint == nullptr) {
+      if (rightmost_ != nullptr && compare_(rightmost_->value, value)) {
+        parent = rightmost_;
+      }
+    } else if (compare_(value, hint->value)) {
+      if (hint == leftmost_) {
+        parent = hint;
+        left = true;
+      } else {
+        node_type* before = Predecessor(hint);
+
+        if (compare_(before->value, value)) {
+          parent = (before->right == nullptr) ? before : hint;
+          left = (parent == hint);
         }
-        node = node->left;
+      }
+    } else if (compare_(hint->value, value)) {
+      if (hint == rightmost_) {
+        parent = hint;
       } else {
-        node = node->right;
+        node_type* after = Successor(hint);
+
+        if (compare_(value, after->value)) {
+          parent = (hint->right == nullptr) ? hint : after;
+          left = (parent == after);
+        }
       }
+    } else {
+      return std::make_pair(hint, false);
     }
 
-    return result;
+    if (parent == nullptr) return Insert(std::forward<V>(value));
+
+    return std::make_pair(
+        Link(parent, left, Create(std::forward<V>(value))), true);
   }
+}
 
-  Allocator allocator_;
+template <typename T, typename Allocator, typename Balance, typename Compare>
+template <typename... Args>
+std::pair<typename Tree<T, Allocator, Balance, Compare>::node_type*, bool>
+Tree<T, Allocator, Balance, Compare>::Emplace(Args&&... args) {
+  node_type* new_node = Create(std::forward<Args>(args)...);
+  node_type* parent = nullptr;
+  bool left = false;
+  node_type* node = Descend(new_node->value, parent, left);
 
-  Node<value_type>* root_;
-  size_type size_ = 0;
-};
+  if (node != nullptr) {
+    Destroy(new_node);
+    return std::make_pair(node, false);
+  }
+
+  return std::make_pair(Link(parent, left, new_node), true);
+}
+
+template <typename T, typename Allocator, typename Balance, typename Compare>
+template <typename K>
+typename Tree<T, Allocator, Balance, Compare>::node_type*
+Tree<T, Allocator, Balance, Compare>::Descend(const K& key,
+                                              node_type*& parent,
+                                              bool& left) const {
+  node_type* node = this->root_;
 
-template <typename T, typename Allocator>
-Node<T>* Tree<T, Allocator>::Insert(Node<T>* node, int value) {
-  if (node == nullptr) {
-    Node<T>* new_node = allocator_.allocate(1);
-    std::allocator_traits<Allocator>::construct(allocator_, new_node, value);
-    ++size_;
+  while (node != nullptr) {
+    parent = node;
+    auto order = Order(key, node->value);
 
-    return new_node;
+    if (order < 0) {
+      node = node->left;
+      left = true;
+    } else if (order > 0) {
+      node = node->right;
+      left = false;
+    } else {
+      return node;
+    }
   }
 
-  if (value < node->value) {
-    node->left = Insert(node->left, value);
+  return nullptr;
+}
+
+template <typename T, typename Allocator, typename Balance, typename Compare>
+template <typename K>
+auto Tree<T, Allocator, Balance, Compare>::Order(const K& key,
+                                                 const T& value) const {
+  return KeyOrder<Compare>::Order(compare_, key, value);
+}
 
-    node->left->parent = node;
+template <typename T, typename Allocator, typename Balance, typename Compare>
+template <typename K>
+typename Tree<T, Allocator, Balance, Compare>::Probe
+Tree<T, Allocator, Balance, Compare>::Search(const K& key) const {
+  Probe probe{nullptr, nullptr};
+  node_type* node = this->root_;
 
-  } else if (value > node->value) {
-    node->right = Insert(node->right, value);
+  while (node != nullptr) {
+    auto order = Order(key, node->value);
 
-    node->right->parent = node;
+    if (order < 0) {
+      probe.above = node;
+      node = node->left;
+    } else if (order > 0) {
+      node = node->right;
+    } else {
+      probe.match = node;
+      break;
+    }
+  }
+
+  return probe;
+}
+
+template <typename T, typename Allocator, typename Balance, typename Compare>
+template <typename... Args>
+typename Tree<T, Allocator, Balance, Compare>::node_type*
+Tree<T, Allocator, Balance, Compare>::Create(Args&&... args) {
+  node_type* node = allocator_.allocate(1);
+
+  try {
+    node_allocator_traits::construct(allocator_, node, std::in_place,
+                                     std::forward<Args>(args)...);
+  } catch (...) {
+    allocator_.deallocate(node, 1);
+    throw;
   }
 
   return node;
 }
 
-template <typename T, typename Allocator>
-void Tree<T, Allocator>::Insert(int value) {
-  this->root_ = Insert(this->root_, value);
+template <typename T, typename Allocator, typename Balance, typename Compare>
+typename Tree<T, Allocator, Balance, Compare>::node_type*
+Tree<T, Allocator, Balance, Compare>::Link(node_type* parent, bool left,
+                                           node_type* new_node) {
+  new_node->parent = parent;
+  ++size_;
+
+  if constexpr (node_type::kThreaded) {
+    node_type* prev = nullptr;
+    node_type* next = nullptr;
+
+    if (parent != nullptr) {
+      prev = left ? static_cast<node_type*>(parent->prev) : parent;
+      next = left ? parent : static_cast<node_type*>(parent->next);
+    }
+
+    new_node->prev = prev;
+    new_node->next = next;
+    if (prev != nullptr) prev->next = new_node;
+    if (next != nullptr) next->prev = new_node;
+  }
+
+  if (parent == nullptr) {
+    this->root_ = new_node;
+    leftmost_ = new_node;
+    rightmost_ = new_node;
+  } else if (left) {
+    parent->left = new_node;
+    if (parent == leftmost_) leftmost_ = new_node;
+  } else {
+    parent->right = new_node;
+    if (parent == rightmost_) rightmost_ = new_node;
+  }
+
+  if constexpr (node_type::kCounted) {
+    for (node_type* cur = parent; cur != nullptr; cur = cur->parent) {
+      ++cur->count;
+    }
+  }
+
+  Balance::InsertFixup(this->root_, new_node);
+
+  return new_node;
 }
 
-template <typename T, typename Allocator>
-Node<T>* Tree<T, Allocator>::Min(Node<T>* node) {
+template <typename T, typename Allocator, typename Balance, typename Compare>
+typename Tree<T, Allocator, Balance, Compare>::node_type*
+Tree<T, Allocator, Balance, Compare>::Min(node_type* node) {
   while (node->left != nullptr) {
     node = node->left;
   }
@@ -118,105 +611,1266 @@ Node<T>* Tree<T, Allocator>::Min(Node<T>* node) {
   return node;
 }
 
-template <typename T, typename Allocator>
-void Tree<T, Allocator>::Remove(int value) {
-  this->root_ = Remove(this->root_, value);
+template <typename T, typename Allocator, typename Balance, typename Compare>
+typename Tree<T, Allocator, Balance, Compare>::node_type*
+Tree<T, Allocator, Balance, Compare>::Max(node_type* node) {
+  while (node->right != nullptr) {
+    node = node->right;
+  }
+
+  return node;
 }
 
-template <typename T, typename Allocator>
-Node<T>* Tree<T, Allocator>::Remove(Node<T>* node, int value) {
-  if (node == nullptr) return node;
+template <typename T, typename Allocator, typename Balance, typename Compare>
+typename Tree<T, Allocator, Balance, Compare>::node_type*
+Tree<T, Allocator, Balance, Compare>::Predecessor(node_type* node) {
+  if constexpr (node_type::kThreaded) return node->prev;
 
-  if (value < node->value) {
-    node->left = Remove(node->left, value);
+  if (node->left != nullptr) return Max(node->left);
 
-    if (node->left) {
-      node->left->parent = node;
-    }
-  } else if (value > node->value) {
-    node->right = Remove(node->right, value);
+  while (node->parent != nullptr && node == node->parent->left) {
+    node = node->parent;
+  }
+
+  return node->parent;
+}
+
+template <typename T, typename Allocator, typename Balance, typename Compare>
+typename Tree<T, Allocator, Balance, Compare>::node_type*
+Tree<T, Allocator, Balance, Compare>::Successor(node_type* node) {
+  if constexpr (node_type::kThreaded) return node->next;
+
+  if (node->right != nullptr) return Min(node->right);
+
+  while (node->parent != nullptr && node == node->parent->right) {
+    node = node->parent;
+  }
+
+  return node->parent;
+}
 
-    if (node->right) {
-      node->right->parent = node;
+template <typename T, typename Allocator, typename Balance, typename Compare>
+typename Tree<T, Allocator, Balance, Compare>::node_type*
+Tree<T, Allocator, Balance, Compare>::Root(node_type* node) {
+  while (node->parent != nullptr) {
+    node = node->parent;
+  }
+
+  return node;
+}
+
+template <typename T, typename Allocator, typename Balance, typename Compare>
+typename Tree<T, Allocator, Balance, Compare>::size_type
+Tree<T, Allocator, Balance, Compare>::Rank(const T& value) const {
+  size_type rank = 0;
+
+  if constexpr (node_type::kCounted) {
+    node_type* node = this->root_;
+
+    while (node != nullptr) {
+      if (compare_(node->value, value)) {
+        rank += Balance::Count(node->left) + 1;
+        node = node->right;
+      } else {
+        node = node->left;
+      }
     }
   } else {
-    if (node->left == nullptr) {
-      Node<T>* temp = node->right;
-      delete node;
-      --size_;
+    for (node_type* node = leftmost_;
+         node != nullptr && compare_(node->value, value);
+         node = Successor(node)) {
+      ++rank;
+    }
+  }
+
+  return rank;
+}
 
-      return temp;
-    } else if (node->right == nullptr) {
-      Node<T>* temp = node->left;
-      delete node;
-      --size_;
+template <typename T, typename Allocator, typename Balance, typename Compare>
+typename Tree<T, Allocator, Balance, Compare>::node_type*
+Tree<T, Allocator, Balance, Compare>::Select(size_type index) {
+  return Select(this->root_, index);
+}
+
+template <typename T, typename Allocator, typename Balance, typename Compare>
+typename Tree<T, Allocator, Balance, Compare>::node_type*
+Tree<T, Allocator, Balance, Compare>::Select(node_type* root, size_type index) {
+  if (root == nullptr) return nullptr;
 
-      return temp;
+  if constexpr (node_type::kCounted) {
+    while (root != nullptr) {
+      size_type left = Balance::Count(root->left);
+
+      if (index < left) {
+        root = root->left;
+      } else if (index == left) {
+        return root;
+      } else {
+        index -= left + 1;
+        root = root->right;
+      }
     }
 
-    Node<T>* temp = Min(node->right);
-    node->value = temp->value;
+    return nullptr;
+  } else {
+    node_type* node = Min(root);
+    for (; node != nullptr && index > 0; --index) {
+      node = Successor(node);
+    }
 
-    node->right = Remove(node->right, temp->value);
+    return node;
   }
+}
 
-  return node;
+template <typename T, typename Allocator, typename Balance, typename Compare>
+typename Tree<T, Allocator, Balance, Compare>::size_type
+Tree<T, Allocator, Balance, Compare>::Position(const node_type* node) {
+  size_type position = 0;
+
+  if constexpr (node_type::kCounted) {
+    position = Balance::Count(node->left);
+
+    while (node->parent != nullptr) {
+      if (node == node->parent->right) {
+        position += Balance::Count(node->parent->left) + 1;
+      }
+      node = node->parent;
+    }
+  } else {
+    node_type* cur = const_cast<node_type*>(node);
+    while ((cur = Predecessor(cur)) != nullptr) {
+      ++position;
+    }
+  }
+
+  return position;
 }
 
-template <typename T, typename Allocator>
-Node<T>* Tree<T, Allocator>::Find(Node<T>* node, T value) {
-  if (node == nullptr || node->value == value) {
+template <typename T, typename Allocator, typename Balance, typename Compare>
+typename Tree<T, Allocator, Balance, Compare>::node_type*
+Tree<T, Allocator, Balance, Compare>::Advance(node_type* node,
+                                              difference_type offset) {
+  if constexpr (node_type::kCounted) {
+    node_type* root = Root(node);
+    difference_type position =
+        static_cast<difference_type>(Position(node)) + offset;
+
+    if (position < 0) return nullptr;
+
+    return Select(root, static_cast<size_type>(position));
+  } else {
+    for (; node != nullptr && offset > 0; --offset) {
+      node = Successor(node);
+    }
+    for (; node != nullptr && offset < 0; ++offset) {
+      node = Predecessor(node);
+    }
+
     return node;
   }
+}
+
+template <typename T, typename Allocator, typename Balance, typename Compare>
+typename Tree<T, Allocator, Balance, Compare>::difference_type
+Tree<T, Allocator, Balance, Compare>::Distance(const node_type* from,
+                                               const node_type* to) {
+  if (from == to) return 0;
 
-  if (node->value < value) {
-    return Find(node->right, value);
+  if constexpr (node_type::kCounted) {
+    const node_type* any = (from != nullptr) ? from : to;
+    difference_type total = static_cast<difference_type>(
+        Balance::Count(Root(const_cast<node_type*>(any))));
+    difference_type from_position =
+        (from == nullptr) ? total
+                          : static_cast<difference_type>(Position(from));
+    difference_type to_position =
+        (to == nullptr) ? total : static_cast<difference_type>(Position(to));
+
+    return to_position - from_position;
   } else {
-    return Find(node->left, value);
+    difference_type distance = 0;
+    node_type* cur = const_cast<node_type*>(from);
+
+    while (cur != nullptr && cur != to) {
+      cur = Successor(cur);
+      ++distance;
+    }
+
+    if (cur == to) return distance;
+
+    return -Distance(to, from);
   }
 }
 
-template <typename T, typename Allocator>
-Node<T>* Tree<T, Allocator>::Copy(Node<T>* node) {
-  if (node == nullptr) return node;
-
-  Node<T>* new_node = allocator_.allocate(1);
-  std::allocator_traits<Allocator>::construct(allocator_, new_node,
-                                              node->value);
-  new_node->right = Copy(node->right);
+template <typename T, typename Allocator, typename Balance, typename Compare>
+void Tree<T, Allocator, Balance, Compare>::UpdateBounds() {
+  leftmost_ = (this->root_ == nullptr) ? nullptr : Min(this->root_);
+  rightmost_ = (this->root_ == nullptr) ? nullptr : Max(this->root_);
 
-  if (new_node->right != nullptr) {
-    new_node->right->parent = new_node;
+  if constexpr (node_type::kThreaded) {
+    Thread();
   }
+}
+
+template <typename T, typename Allocator, typename Balance, typename Compare>
+void Tree<T, Allocator, Balance, Compare>::Thread() {
+  node_type* prev = nullptr;
+  node_type* node = leftmost_;
 
-  new_node->left = Copy(node->left);
-  if (new_node->left != nullptr) {
-    new_node->left->parent = new_node;
+  while (node != nullptr) {
+    node->prev = prev;
+    if (prev != nullptr) prev->next = node;
+    prev = node;
+
+    if (node->right != nullptr) {
+      node = Min(node->right);
+    } else {
+      while (node->parent != nullptr && node == node->parent->right) {
+        node = node->parent;
+      }
+      node = node->parent;
+    }
   }
 
-  return new_node;
+  if (prev != nullptr) prev->next = nullptr;
 }
 
-template <typename T, typename Allocator>
-void Tree<T, Allocator>::Deallocate(Node<T>* node) {
+template <typename T, typename Allocator, typename Balance, typename Compare>
+void Tree<T, Allocator, Balance, Compare>::Remove(const T& value) {
+  node_type* node = Find(value);
   if (node == nullptr) return;
 
-  Deallocate(node->left);
-  Deallocate(node->right);
+  Erase(node);
+}
+
+template <typename T, typename Allocator, typename Balance, typename Compare>
+void Tree<T, Allocator, Balance, Compare>::Erase(node_type* node) {
+  Unlink(node);
+  Destroy(node);
+}
+
+template <typename T, typename Allocator, typename Balance, typename Compare>
+typename Tree<T, Allocator, Balance, Compare>::size_type
+Tree<T, Allocator, Balance, Compare>::EraseRange(node_type* first,
+                                                 node_type* last) {
+  if (first == nullptr || first == last) return 0;
+
+  size_type size = size_;
+  node_type* before = Predecessor(first);
+  Pieces head = Split(this->root_, first->value);
+  node_type* erased = head.right;
+
+  if (last == nullptr) {
+    this->root_ = head.left;
+  } else {
+    Pieces tail = Split(head.right, last->value);
+    erased = tail.left;
+    this->root_ = Balance::Join(head.left, tail.middle, tail.right);
+  }
+
+  if (this->root_ != nullptr) {
+    this->root_->parent = nullptr;
+    Balance::OnBuild(this->root_, 0, 0);
+  }
+
+  if constexpr (node_type::kThreaded) {
+    if (before != nullptr) before->next = last;
+    if (last != nullptr) last->prev = before;
+  }
+
+  if (first == leftmost_) leftmost_ = last;
+  if (last == nullptr) rightmost_ = before;
+
+  Destroy(first);
   --size_;
-  std::allocator_traits<Allocator>::destroy(allocator_, node);
-  allocator_.deallocate(node, 1);
+  Deallocate(erased);
+
+  return size - size_;
+}
+
+template <typename T, typename Allocator, typename Balance, typename Compare>
+typename Tree<T, Allocator, Balance, Compare>::size_type
+Tree<T, Allocator, Balance, Compare>::CountRange(const T& low,
+                                                 const T& high) const {
+  if (!compare_(low, high)) return 0;
+
+  if constexpr (node_type::kCounted) {
+    return Rank(high) - Rank(low);
+  } else {
+    size_type count = 0;
+
+    for (node_type* node = LowerBound(low);
+         node != nullptr && compare_(node->value, high);
+         node = Successor(node)) {
+      ++count;
+    }
+
+    return count;
+  }
+}
+
+template <typename T, typename Allocator, typename Balance, typename Compare>
+void Tree<T, Allocator, Balance, Compare>::Unlink(node_type* node) {
+  if (node == leftmost_) leftmost_ = Successor(node);
+  if (node == rightmost_) rightmost_ = Predecessor(node);
+
+  if constexpr (node_type::kThreaded) {
+    if (node->prev != nullptr) node->prev->next = node->next;
+    if (node->next != nullptr) node->next->prev = node->prev;
+    node->prev = nullptr;
+    node->next = nullptr;
+  }
+
+  Balance::Erase(this->root_, node);
+  --size_;
+
+  node->parent = nullptr;
+  node->left = nullptr;
+  node->right = nullptr;
+  Balance::UpdateCount(node);
+}
+
+template <typename T, typename Allocator, typename Balance, typename Compare>
+template <typename K>
+typename Tree<T, Allocator, Balance, Compare>::node_handle
+Tree<T, Allocator, Balance, Compare>::Extract(const K& key) {
+  node_type* node = Find(key);
+  if (node == nullptr) return node_handle();
+
+  return Extract(node);
 }
 
-template <typename T, typename Allocator>
-Node<T>* Tree<T,Allocator>::Find(const T& value) {
-    return Find(this->root_, value);
+template <typename T, typename Allocator, typename Balance, typename Compare>
+typename Tree<T, Allocator, Balance, Compare>::node_handle
+Tree<T, Allocator, Balance, Compare>::Extract(node_type* node) {
+  Unlink(node);
+
+  return node_handle(node, allocator_);
 }
 
-template <typename T, typename Allocator>
-void Tree<T, Allocator>::Deallocate() {
-    Deallocate(this->root_);
-    this->root_ = nullptr;
+template <typename T, typename Allocator, typename Balance, typename Compare>
+std::pair<typename Tree<T, Allocator, Balance, Compare>::node_type*, bool>
+Tree<T, Allocator, Balance, Compare>::Insert(node_handle&& handle) {
+  if (handle.empty()) return std::make_pair(nullptr, false);
+
+  node_type* parent = nullptr;
+  bool left = false;
+  node_type* node = Descend(handle.value(), parent, left);
+
+  if (node != nullptr) return std::make_pair(node, false);
+
+  if (handle.get_allocator() == allocator_) {
+    return std::make_pair(Link(parent, left, handle.Release()), true);
+  }
+
+  node_type* moved = Create(std::move(handle.value()));
+  handle = node_handle();
+
+  return std::make_pair(Link(parent, left, moved), true);
+}
+
+template <typename T, typename Allocator, typename Balance, typename Compare>
+template <typename K>
+typename Tree<T, Allocator, Balance, Compare>::node_type*
+Tree<T, Allocator, Balance, Compare>::Find(const K& key) const {
+  return Search(key).match;
+}
+
+template <typename T, typename Allocator, typename Balance, typename Compare>
+template <IteratorType type, typename Function>
+void Tree<T, Allocator, Balance, Compare>::Traverse(Function&& function) const {
+  if constexpr (type == IteratorType::INORDER && node_type::kThreaded) {
+    for (const node_type* node = leftmost_; node != nullptr;
+         node = node->next) {
+      function(node->value);
+    }
+
+    return;
+  }
+
+  const node_type* node = this->root_;
+  const node_type* from = nullptr;
+
+  while (node != nullptr) {
+    bool down = (from == node->parent);
+
+    if (down) {
+      if constexpr (type == IteratorType::PREORDER) function(node->value);
+
+      if (node->left != nullptr) {
+        from = node;
+        node = node->left;
+        continue;
+      }
+    }
+
+    if (down || from == node->left) {
+      if constexpr (type == IteratorType::INORDER) function(node->value);
+
+      if (node->right != nullptr) {
+        from = node;
+        node = node->right;
+        continue;
+      }
+    }
+
+    if constexpr (type == IteratorType::POSTORDER) function(node->value);
+
+    from = node;
+    node = node->parent;
+  }
+}
+
+template <typename T, typename Allocator, typename Balance, typename Compare>
+template <typename K>
+typename Tree<T, Allocator, Balance, Compare>::node_type*
+Tree<T, Allocator, Balance, Compare>::LowerBound(const K& key) const {
+  Probe probe = Search(key);
+
+  return (probe.match != nullptr) ? probe.match : probe.above;
+}
+
+template <typename T, typename Allocator, typename Balance, typename Compare>
+template <typename K>
+typename Tree<T, Allocator, Balance, Compare>::node_type*
+Tree<T, Allocator, Balance, Compare>::Next(const K& key) const {
+  return EqualRange(key).second;
+}
+
+template <typename T, typename Allocator, typename Balance, typename Compare>
+template <typename K>
+std::pair<typename Tree<T, Allocator, Balance, Compare>::node_type*,
+          typename Tree<T, Allocator, Balance, Compare>::node_type*>
+Tree<T, Allocator, Balance, Compare>::EqualRange(const K& key) const {
+  Probe probe = Search(key);
+
+  if (probe.match == nullptr) return std::make_pair(probe.above, probe.above);
+
+  if constexpr (node_type::kThreaded) {
+    return std::make_pair(probe.match,
+                          static_cast<node_type*>(probe.match->next));
+  } else {
+    node_type* upper = (probe.match->right != nullptr)
+                           ? Min(probe.match->right)
+                           : probe.above;
+
+    return std::make_pair(probe.match, upper);
+  }
+}
+
+template <typename T, typename Allocator, typename Balance, typename Compare>
+template <typename K, typename Sink>
+void Tree<T, Allocator, Balance, Compare>::FindBatch(std::span<const K> keys,
+                                                     Sink&& sink) const {
+  if (this->root_ == nullptr) {
+    for (size_type i = 0; i < keys.size(); ++i) {
+      sink(i, this->root_);
+    }
+
+    return;
+  }
+
+  node_type* cursors[kBatchGroup];
+
+  for (size_type base = 0; base < keys.size(); base += kBatchGroup) {
+    size_type group = std::min(kBatchGroup, keys.size() - base);
+    size_type active = group;
+
+    for (size_type i = 0; i < group; ++i) {
+      cursors[i] = this->root_;
+    }
+
+    while (active > 0) {
+      active = 0;
+
+      for (size_type i = 0; i < group; ++i) {
+        node_type* node = cursors[i];
+        if (node == nullptr) continue;
+
+        auto order = Order(keys[base + i], node->value);
+
+        if (order == 0) {
+          sink(base + i, node);
+          cursors[i] = nullptr;
+          continue;
+        }
+
+        node = (order < 0) ? node->left : node->right;
+        cursors[i] = node;
+
+        if (node == nullptr) {
+          sink(base + i, node);
+        } else {
+          Prefetch(node);
+          ++active;
+        }
+      }
+    }
+  }
+}
+
+template <typename T, typename Allocator, typename Balance, typename Compare>
+void Tree<T, Allocator, Balance, Compare>::Prefetch(const node_type* node) {
+#if defined(__GNUC__) || defined(__clang__)
+  __builtin_prefetch(node);
+#endif
+}
+
+template <typename T, typename Allocator, typename Balance, typename Compare>
+typename Tree<T, Allocator, Balance, Compare>::node_type*
+Tree<T, Allocator, Balance, Compare>::Clone(const node_type* node) {
+  node_type* new_node = Create(node->value);
+  new_node->balance = node->balance;
+
+  if constexpr (node_type::kCounted) {
+    new_node->count = node->count;
+  }
+
+  return new_node;
+}
+
+template <typename T, typename Allocator, typename Balance, typename Compare>
+typename Tree<T, Allocator, Balance, Compare>::node_type*
+Tree<T, Allocator, Balance, Compare>::Copy(node_type* node,
+                                           size_type count) {
+  return Duplicate(node, Forks(count));
+}
+
+template <typename T, typename Allocator, typename Balance, typename Compare>
+typename Tree<T, Allocator, Balance, Compare>::node_type*
+Tree<T, Allocator, Balance, Compare>::Duplicate(const node_type* node,
+                                                int forks) {
+  if (node == nullptr) return nullptr;
+
+  if (forks > 0) {
+    node_type* new_root = Clone(node);
+    node_type* left = nullptr;
+    node_type* right = nullptr;
+
+    try {
+      Fork(
+          forks, [&] { left = Duplicate(node->left, forks - 1); },
+          [&] { right = Duplicate(node->right, forks - 1); });
+    } catch (...) {
+      Free(left);
+      Free(right);
+      Destroy(new_root);
+      throw;
+    }
+
+    new_root->left = left;
+    new_root->right = right;
+    if (left != nullptr) left->parent = new_root;
+    if (right != nullptr) right->parent = new_root;
+
+    return new_root;
+  }
+
+  node_type* new_root = Clone(node);
+  const node_type* source = node;
+  node_type* target = new_root;
+
+  try {
+    while (true) {
+      if (source->left != nullptr && target->left == nullptr) {
+        target->left = Clone(source->left);
+        target->left->parent = target;
+        source = source->left;
+        target = target->left;
+      } else if (source->right != nullptr && target->right == nullptr) {
+        target->right = Clone(source->right);
+        target->right->parent = target;
+        source = source->right;
+        target = target->right;
+      } else if (source != node) {
+        source = source->parent;
+        target = target->parent;
+      } else {
+        break;
+      }
+    }
+  } catch (...) {
+    Free(new_root);
+    throw;
+  }
+
+  return new_root;
+}
+
+template <typename T, typename Allocator, typename Balance, typename Compare>
+template <typename InputIt>
+void Tree<T, Allocator, Balance, Compare>::Build(InputIt first,
+                                                 size_type count) {
+  Deallocate();
+  Reserve(count);
+
+  this->root_ = Build(first, count, 0, MaxDepth(count));
+  this->size_ = count;
+  UpdateBounds();
+}
+
+template <typename T, typename Allocator, typename Balance, typename Compare>
+template <typename InputIt>
+typename Tree<T, Allocator, Balance, Compare>::node_type*
+Tree<T, Allocator, Balance, Compare>::Build(InputIt& it, size_type count,
+                                            int depth, int max_depth) {
+  if (count == 0) return nullptr;
+
+  size_type left_count = (count - 1) / 2;
+  node_type* left = Build(it, left_count, depth + 1, max_depth);
+
+  node_type* node = Create(*it);
+  ++it;
+
+  node->left = left;
+  if (left != nullptr) {
+    left->parent = node;
+  }
+
+  node->right = Build(it, count - left_count - 1, depth + 1, max_depth);
+  if (node->right != nullptr) {
+    node->right->parent = node;
+  }
+
+  Balance::UpdateCount(node);
+  Balance::OnBuild(node, depth, max_depth);
+
+  return node;
+}
+
+template <typename T, typename Allocator, typename Balance, typename Compare>
+int Tree<T, Allocator, Balance, Compare>::MaxDepth(size_type count) {
+  int max_depth = 0;
+  for (size_type rest = count; rest > 1; rest /= 2) {
+    ++max_depth;
+  }
+
+  return max_depth;
+}
+
+template <typename T, typename Allocator, typename Balance, typename Compare>
+void Tree<T, Allocator, Balance, Compare>::Merge(Tree& source) {
+  if (this == &source || source.root_ == nullptr) return;
+
+  node_type* mine = Flatten();
+  node_type* theirs = source.Flatten();
+  node_type* merged = nullptr;
+  node_type* duplicates = nullptr;
+  node_type* merged_tail = nullptr;
+  node_type* duplicates_tail = nullptr;
+  size_type merged_count = 0;
+  size_type duplicates_count = 0;
+  bool splice = this->allocator_ == source.allocator_;
+
+  while (mine != nullptr || theirs != nullptr) {
+    node_type* next = nullptr;
+
+    if (theirs == nullptr ||
+        (mine != nullptr && compare_(mine->value, theirs->value))) {
+      next = mine;
+      mine = mine->right;
+    } else if (mine == nullptr || compare_(theirs->value, mine->value)) {
+      next = theirs;
+      theirs = theirs->right;
+
+      if (!splice) {
+        node_type* moved = Clone(next);
+        source.Destroy(next);
+        next = moved;
+      }
+    } else {
+      node_type* duplicate = theirs;
+      theirs = theirs->right;
+      Append(duplicates, duplicates_tail, duplicate);
+      ++duplicates_count;
+
+      continue;
+    }
+
+    Append(merged, merged_tail, next);
+    ++merged_count;
+  }
+
+  if (merged_tail != nullptr) merged_tail->right = nullptr;
+  if (duplicates_tail != nullptr) duplicates_tail->right = nullptr;
+
+  Relink(merged, merged_count);
+  source.Relink(duplicates, duplicates_count);
+}
+
+template <typename T, typename Allocator, typename Balance, typename Compare>
+void Tree<T, Allocator, Balance, Compare>::Union(const Tree& other,
+                                                 ExecutionPolicy policy) {
+  if (this == &other || other.root_ == nullptr) return;
+
+  node_type* copy = Copy(other.root_, other.size_);
+  Garbage garbage;
+
+  this->root_ = Union(this->root_, copy, garbage,
+                      Forks(policy, this->size_ + other.size_));
+  this->size_ += other.size_;
+  Collect(garbage);
+}
+
+template <typename T, typename Allocator, typename Balance, typename Compare>
+void Tree<T, Allocator, Balance, Compare>::Intersection(
+    const Tree& other, ExecutionPolicy policy) {
+  if (this == &other) return;
+
+  Garbage garbage;
+
+  this->root_ = Intersection(this->root_, other.root_, garbage,
+                             Forks(policy, this->size_));
+  Collect(garbage);
+}
+
+template <typename T, typename Allocator, typename Balance, typename Compare>
+void Tree<T, Allocator, Balance, Compare>::Difference(const Tree& other,
+                                                      ExecutionPolicy policy) {
+  if (this == &other) {
+    Deallocate();
+    return;
+  }
+
+  Garbage garbage;
+
+  this->root_ = Difference(this->root_, other.root_, garbage,
+                           Forks(policy, this->size_));
+  Collect(garbage);
+}
+
+template <typename T, typename Allocator, typename Balance, typename Compare>
+typename Tree<T, Allocator, Balance, Compare>::Pieces
+Tree<T, Allocator, Balance, Compare>::Split(node_type* root,
+                                            const T& value) const {
+  Pieces pieces{nullptr, nullptr, nullptr};
+  node_type* node = root;
+  node_type* above = nullptr;
+
+  while (node != nullptr) {
+    above = node;
+    auto order = Order(value, node->value);
+
+    if (order < 0) {
+      node = node->left;
+    } else if (order > 0) {
+      node = node->right;
+    } else {
+      break;
+    }
+  }
+
+  // Both children of a path node share the path child's rank, so the ranks
+  // of the pieces and of each sibling subtree are known on the way up.
+  int left_rank = 0;
+  int right_rank = 0;
+  int rank = 0;
+
+  if (node != nullptr) {
+    above = node->parent;
+    pieces.middle = node;
+    pieces.left = node->left;
+    pieces.right = node->right;
+
+    left_rank = right_rank = Balance::Rank(pieces.left);
+    rank = Balance::RankAbove(node, left_rank);
+
+    if (pieces.left != nullptr) pieces.left->parent = nullptr;
+    if (pieces.right != nullptr) pieces.right->parent = nullptr;
+    node->left = nullptr;
+    node->right = nullptr;
+    node->parent = nullptr;
+    Balance::UpdateCount(node);
+  }
+
+  while (above != nullptr) {
+    node_type* next = above->parent;
+    int above_rank = Balance::RankAbove(above, rank);
+
+    if (compare_(value, above->value)) {
+      node_type* right = above->right;
+      if (right != nullptr) right->parent = nullptr;
+
+      pieces.right = Balance::Join(pieces.right, above, right, right_rank,
+                                   rank, right_rank);
+    } else {
+      node_type* left = above->left;
+      if (left != nullptr) left->parent = nullptr;
+
+      pieces.left =
+          Balance::Join(left, above, pieces.left, rank, left_rank, left_rank);
+    }
+
+    above = next;
+    rank = above_rank;
+  }
+
+  return pieces;
+}
+
+template <typename T, typename Allocator, typename Balance, typename Compare>
+typename Tree<T, Allocator, Balance, Compare>::node_type*
+Tree<T, Allocator, Balance, Compare>::Join(node_type* left, node_type* right) {
+  if (left == nullptr) return right;
+  if (right == nullptr) return left;
+
+  node_type* pivot = Max(left);
+  Balance::Erase(left, pivot);
+
+  return Balance::Join(left, pivot, right);
+}
+
+template <typename T, typename Allocator, typename Balance, typename Compare>
+typename Tree<T, Allocator, Balance, Compare>::node_type*
+Tree<T, Allocator, Balance, Compare>::Union(node_type* first,
+                                            node_type* second,
+                                            Garbage& garbage,
+                                            int forks) const {
+  if (first == nullptr) return second;
+  if (second == nullptr) return first;
+
+  node_type* second_left = second->left;
+  node_type* second_right = second->right;
+  if (second_left != nullptr) second_left->parent = nullptr;
+  if (second_right != nullptr) second_right->parent = nullptr;
+
+  Pieces pieces = Split(first, second->value);
+  if (pieces.middle != nullptr) {
+    garbage.Add(pieces.middle);
+  }
+
+  Garbage right_garbage;
+  node_type* left = nullptr;
+  node_type* right = nullptr;
+
+  Fork(
+      forks,
+      [&] { left = Union(pieces.left, second_left, garbage, forks - 1); },
+      [&] {
+        right = Union(pieces.right, second_right, right_garbage, forks - 1);
+      });
+  garbage.Append(right_garbage);
+
+  return Balance::Join(left, second, right);
+}
+
+template <typename T, typename Allocator, typename Balance, typename Compare>
+typename Tree<T, Allocator, Balance, Compare>::node_type*
+Tree<T, Allocator, Balance, Compare>::Intersection(node_type* first,
+                                                   const node_type* second,
+                                                   Garbage& garbage,
+                                                   int forks) const {
+  if (first == nullptr) return nullptr;
+
+  if (second == nullptr) {
+    garbage.Add(first);
+    return nullptr;
+  }
+
+  Pieces pieces = Split(first, second->value);
+
+  Garbage right_garbage;
+  node_type* left = nullptr;
+  node_type* right = nullptr;
+
+  Fork(
+      forks,
+      [&] {
+        left = Intersection(pieces.left, second->left, garbage, forks - 1);
+      },
+      [&] {
+        right = Intersection(pieces.right, second->right, right_garbage,
+                             forks - 1);
+      });
+  garbage.Append(right_garbage);
+
+  if (pieces.middle == nullptr) return Join(left, right);
+
+  return Balance::Join(left, pieces.middle, right);
+}
+
+template <typename T, typename Allocator, typename Balance, typename Compare>
+typename Tree<T, Allocator, Balance, Compare>::node_type*
+Tree<T, Allocator, Balance, Compare>::Difference(node_type* first,
+                                                 const node_type* second,
+                                                 Garbage& garbage,
+                                                 int forks) const {
+  if (first == nullptr || second == nullptr) return first;
+
+  Pieces pieces = Split(first, second->value);
+  if (pieces.middle != nullptr) {
+    garbage.Add(pieces.middle);
+  }
+
+  Garbage right_garbage;
+  node_type* left = nullptr;
+  node_type* right = nullptr;
+
+  Fork(
+      forks,
+      [&] {
+        left = Difference(pieces.left, second->left, garbage, forks - 1);
+      },
+      [&] {
+        right = Difference(pieces.right, second->right, right_garbage,
+                           forks - 1);
+      });
+  garbage.Append(right_garbage);
+
+  return Join(left, right);
+}
+
+template <typename T, typename Allocator, typename Balance, typename Compare>
+template <typename Left, typename Right>
+void Tree<T, Allocator, Balance, Compare>::Fork(int forks, Left&& left,
+                                                Right&& right) {
+  if (forks <= 0) {
+    left();
+    right();
+
+    return;
+  }
+
+  std::future<void> pending;
+
+  try {
+    pending = std::async(std::launch::async, left);
+  } catch (const std::system_error&) {
+    left();
+    right();
+
+    return;
+  }
+
+  std::exception_ptr failure;
+
+  try {
+    right();
+  } catch (...) {
+    failure = std::current_exception();
+  }
+
+  try {
+    pending.get();
+  } catch (...) {
+    if (failure == nullptr) failure = std::current_exception();
+  }
+
+  if (failure != nullptr) std::rethrow_exception(failure);
+}
+
+template <typename T, typename Allocator, typename Balance, typename Compare>
+int Tree<T, Allocator, Balance, Compare>::Forks(ExecutionPolicy policy,
+                                                size_type size) {
+  if (policy == ExecutionPolicy::SEQUENTIAL) return 0;
+
+  int forks = 0;
+  size_type threads = std::thread::hardware_concurrency();
+
+  for (size_type rest = size; rest >= kParallelGrain && threads > 1;
+       rest /= 2, threads /= 2) {
+    ++forks;
+  }
+
+  return forks;
+}
+
+template <typename T, typename Allocator, typename Balance, typename Compare>
+int Tree<T, Allocator, Balance, Compare>::Forks(size_type size) const {
+  if (!kParallelAllocator || size < parallel_threshold_) return 0;
+
+  return Forks(ExecutionPolicy::PARALLEL, size);
+}
+
+template <typename T, typename Allocator, typename Balance, typename Compare>
+void Tree<T, Allocator, Balance, Compare>::Garbage::Add(node_type* node) {
+  node->parent = nullptr;
+
+  if (tail == nullptr) {
+    head = node;
+  } else {
+    tail->parent = node;
+  }
+
+  tail = node;
+}
+
+template <typename T, typename Allocator, typename Balance, typename Compare>
+void Tree<T, Allocator, Balance, Compare>::Garbage::Append(
+    const Garbage& other) {
+  if (other.head == nullptr) return;
+
+  if (tail == nullptr) {
+    head = other.head;
+  } else {
+    tail->parent = other.head;
+  }
+
+  tail = other.tail;
+}
+
+template <typename T, typename Allocator, typename Balance, typename Compare>
+void Tree<T, Allocator, Balance, Compare>::Collect(const Garbage& garbage) {
+  node_type* node = garbage.head;
+
+  while (node != nullptr) {
+    node_type* next = node->parent;
+    node->parent = nullptr;
+    Deallocate(node);
+    node = next;
+  }
+
+  if (this->root_ != nullptr) {
+    this->root_->parent = nullptr;
+    Balance::OnBuild(this->root_, 0, 0);
+  }
+  UpdateBounds();
+}
+
+template <typename T, typename Allocator, typename Balance, typename Compare>
+void Tree<T, Allocator, Balance, Compare>::Append(node_type*& head,
+                                                  node_type*& tail,
+                                                  node_type* node) {
+  if (tail == nullptr) {
+    head = node;
+  } else {
+    tail->right = node;
+  }
+
+  tail = node;
+}
+
+template <typename T, typename Allocator, typename Balance, typename Compare>
+typename Tree<T, Allocator, Balance, Compare>::node_type*
+Tree<T, Allocator, Balance, Compare>::Flatten() {
+  node_type* head = this->root_;
+  node_type* tail = nullptr;
+  node_type* rest = this->root_;
+
+  while (rest != nullptr) {
+    if (rest->left == nullptr) {
+      tail = rest;
+      rest = rest->right;
+    } else {
+      node_type* pivot = rest->left;
+      rest->left = pivot->right;
+      pivot->right = rest;
+      rest = pivot;
+
+      if (tail == nullptr) {
+        head = pivot;
+      } else {
+        tail->right = pivot;
+      }
+    }
+  }
+
+  this->root_ = nullptr;
+  this->size_ = 0;
+  UpdateBounds();
+
+  return head;
+}
+
+template <typename T, typename Allocator, typename Balance, typename Compare>
+void Tree<T, Allocator, Balance, Compare>::Relink(node_type* list,
+                                                  size_type count) {
+  this->root_ = Relink(list, count, 0, MaxDepth(count));
+  if (this->root_ != nullptr) {
+    this->root_->parent = nullptr;
+  }
+
+  this->size_ = count;
+  UpdateBounds();
+}
+
+template <typename T, typename Allocator, typename Balance, typename Compare>
+typename Tree<T, Allocator, Balance, Compare>::node_type*
+Tree<T, Allocator, Balance, Compare>::Relink(node_type*& list, size_type count,
+                                             int depth, int max_depth) {
+  if (count == 0) return nullptr;
+
+  size_type left_count = (count - 1) / 2;
+  node_type* left = Relink(list, left_count, depth + 1, max_depth);
+
+  node_type* node = list;
+  list = list->right;
+
+  node->left = left;
+  if (left != nullptr) {
+    left->parent = node;
+  }
+
+  node->right = Relink(list, count - left_count - 1, depth + 1, max_depth);
+  if (node->right != nullptr) {
+    node->right->parent = node;
+  }
+
+  Balance::UpdateCount(node);
+  Balance::OnBuild(node, depth, max_depth);
+
+  return node;
+}
+
+template <typename T, typename Allocator, typename Balance, typename Compare>
+void Tree<T, Allocator, Balance, Compare>::Destroy(node_type* node) {
+  node_allocator_traits::destroy(allocator_, node);
+  allocator_.deallocate(node, 1);
+}
+
+template <typename T, typename Allocator, typename Balance, typename Compare>
+void Tree<T, Allocator, Balance, Compare>::Deallocate(node_type* node) {
+  size_ -= Free(node);
+}
+
+template <typename T, typename Allocator, typename Balance, typename Compare>
+typename Tree<T, Allocator, Balance, Compare>::size_type
+Tree<T, Allocator, Balance, Compare>::Free(node_type* node, int forks) {
+  if (node == nullptr) return 0;
+  if (forks <= 0) return Free(node);
+
+  node_type* left = node->left;
+  node_type* right = node->right;
+  if (left != nullptr) left->parent = nullptr;
+  if (right != nullptr) right->parent = nullptr;
+
+  size_type left_count = 0;
+  size_type right_count = 0;
+
+  Fork(
+      forks, [&] { left_count = Free(left, forks - 1); },
+      [&] { right_count = Free(right, forks - 1); });
+  Destroy(node);
+
+  return left_count + right_count + 1;
+}
+
+template <typename T, typename Allocator, typename Balance, typename Compare>
+typename Tree<T, Allocator, Balance, Compare>::size_type
+Tree<T, Allocator, Balance, Compare>::Free(node_type* node) {
+  if (node == nullptr) return 0;
+
+  node_type* stop = node->parent;
+  size_type count = 0;
+
+  while (node != stop) {
+    if (node->left != nullptr) {
+      node = node->left;
+    } else if (node->right != nullptr) {
+      node = node->right;
+    } else {
+      node_type* parent = node->parent;
+
+      if (parent != nullptr) {
+        if (parent->left == node) {
+          parent->left = nullptr;
+        } else {
+          parent->right = nullptr;
+        }
+      }
+
+      ++count;
+      Destroy(node);
+      node = parent;
+    }
+  }
+
+  return count;
+}
+
+template <typename T, typename Allocator, typename Balance, typename Compare>
+void Tree<T, Allocator, Balance, Compare>::Deallocate() {
+  if constexpr (std::is_trivially_destructible_v<node_type> &&
+                requires(node_allocator_type& allocator) { allocator.release(); }) {
+    if (this->allocator_.release()) {
+      this->root_ = nullptr;
+      leftmost_ = nullptr;
+      rightmost_ = nullptr;
+      this->size_ = 0;
+
+      return;
+    }
+  }
+
+  size_ -= Free(this->root_, Forks(size_));
+  this->root_ = nullptr;
+  leftmost_ = nullptr;
+  rightmost_ = nullptr;
+}
+
+template <typename T, typename Allocator, typename Balance, typename Compare>
+void Tree<T, Allocator, Balance, Compare>::Reserve(size_type count) {
+  if constexpr (requires(node_allocator_type& allocator) { allocator.reserve(count); }) {
+    this->allocator_.reserve(count);
+  }
+}
+
+template <typename T, typename Allocator, typename Balance, typename Compare>
+Tree<T, Allocator, Balance, Compare>::Tree(Tree&& other) noexcept(
+    std::is_nothrow_copy_constructible_v<Compare>)
+    : allocator_(other.allocator_),
+      compare_(other.compare_),
+      parallel_threshold_(other.parallel_threshold_) {
+  Steal(other);
+}
+
+template <typename T, typename Allocator, typename Balance, typename Compare>
+Tree<T, Allocator, Balance, Compare>&
+Tree<T, Allocator, Balance, Compare>::operator=(Tree&& other) noexcept(
+    kStealsOnMove && std::is_nothrow_copy_assignable_v<Compare>) {
+  if (this == &other) return *this;
+
+  Deallocate();
+  compare_ = other.compare_;
+  parallel_threshold_ = other.parallel_threshold_;
+
+  if constexpr (node_allocator_traits::propagate_on_container_move_assignment::
+                    value) {
+    allocator_ = other.allocator_;
+  }
+
+  if (kStealsOnMove || allocator_ == other.allocator_) {
+    Steal(other);
+  } else {
+    SetRoot(Copy(other.root_, other.size_));
+    size_ = other.size_;
+  }
+
+  return *this;
+}
+
+template <typename T, typename Allocator, typename Balance, typename Compare>
+void Tree<T, Allocator, Balance, Compare>::Assign(const Tree& other) {
+  Deallocate();
+  compare_ = other.compare_;
+  parallel_threshold_ = other.parallel_threshold_;
+
+  if constexpr (node_allocator_traits::propagate_on_container_copy_assignment::
+                    value) {
+    allocator_ = other.allocator_;
+  }
+
+  SetRoot(Copy(other.root_, other.size_));
+  size_ = other.size_;
+}
+
+template <typename T, typename Allocator, typename Balance, typename Compare>
+void Tree<T, Allocator, Balance, Compare>::Steal(Tree& other) noexcept {
+  root_ = std::exchange(other.root_, nullptr);
+  leftmost_ = std::exchange(other.leftmost_, nullptr);
+  rightmost_ = std::exchange(other.rightmost_, nullptr);
+  size_ = std::exchange(other.size_, 0);
+}
+
+template <typename T, typename Allocator, typename Balance, typename Compare>
+void Tree<T, Allocator, Balance, Compare>::Swap(Tree& other) noexcept {
+  if constexpr (node_allocator_traits::propagate_on_container_swap::value) {
+    std::swap(this->allocator_, other.allocator_);
+  }
+  std::swap(compare_, other.compare_);
+  std::swap(parallel_threshold_, other.parallel_threshold_);
+  std::swap(this->root_, other.root_);
+  std::swap(leftmost_, other.leftmost_);
+  std::swap(rightmost_, other.rightmost_);
+  std::swap(this->size_, other.size_);
 }
-template <typename T, typename Allocator>
-Node<T>* Tree<T, Allocator>::Next(T value) { return Next(this->root_, value); }
@@ -2,6 +2,14 @@
 
 #include <gtest/gtest.h>
 
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <memory_resource>
+#include <set>
+#include <string>
+#include <string_view>
+#include <thread>
 #include <vector>
 
 class BSTTest : public ::testing::Test {
@@ -187,7 +195,7 @@ TEST_F(BSTTest, InsertTest) {
   bst.insert<IteratorType::INORDER>(1);
 
   ASSERT_EQ(bst.size(), 1);
-  ASSERT_EQ(bst.extract(1)->value, 1);
+  ASSERT_EQ(bst.extract(1).value(), 1);
 }
 
 TEST_F(BSTTest, InsertListTest) {
@@ -243,7 +251,7 @@ TEST_F(BSTTest, ClearTest) {
 }
 
 TEST_F(BSTTest, EmplaceTest) {
-  bst.emplace<IteratorType::INORDER>(5, 4, 1, 7, 2, 8, 6);
+  bst.insert_each<IteratorType::INORDER>(5, 4, 1, 7, 2, 8, 6);
   int expected_array[7] = {1, 2, 4, 5, 6, 7, 8};
   int i = 0;
   ASSERT_EQ(bst.size(), 7);
@@ -255,8 +263,28 @@ TEST_F(BSTTest, EmplaceTest) {
   }
 }
 
+TEST_F(BSTTest, InsertEachSkipsOnlyDuplicates) {
+  bst.insert({4});
+  auto last = bst.insert_each<IteratorType::INORDER>(5, 4, 1, 4, 7);
+
+  ASSERT_EQ(bst.size(), 4);
+  ASSERT_TRUE(bst.contains(1));
+  ASSERT_TRUE(bst.contains(7));
+  ASSERT_EQ(*last.first, 7);
+  ASSERT_TRUE(last.second);
+}
+
+TEST(EmplaceTest, BuildsOneValueFromArguments) {
+  BST<std::string> tree;
+  auto result = tree.emplace<IteratorType::INORDER>(3, 'x');
+
+  ASSERT_TRUE(result.second);
+  ASSERT_EQ(*result.first, "xxx");
+  ASSERT_EQ(tree.size(), 1);
+}
+
 TEST_F(BSTTest, EraseIteratorPosTest) {
-  auto aboba = bst.emplace<IteratorType::INORDER>(5, 4, 1, 7, 2, 8, 6);
+  auto aboba = bst.insert_each<IteratorType::INORDER>(5, 4, 1, 7, 2, 8, 6);
 
   auto it = bst.begin<IteratorType::INORDER>();
   ASSERT_EQ(*aboba.first, 6);
@@ -278,7 +306,7 @@ TEST_F(BSTTest, EraseIteratorPosTest) {
 }
 
 TEST_F(BSTTest, EraseInRangeTest) {
-  auto aboba = bst.emplace<IteratorType::INORDER>(5, 4, 1, 7, 2, 8, 6);
+  auto aboba = bst.insert_each<IteratorType::INORDER>(5, 4, 1, 7, 2, 8, 6);
 
   auto it = bst.begin<IteratorType::INORDER>();
   auto it1 = bst.begin<IteratorType::INORDER>();
@@ -307,7 +335,7 @@ TEST_F(BSTTest, EraseInRangeTest) {
 }
 
 TEST_F(BSTTest, EraseSuccessKeyTest) {
-  auto aboba = bst.emplace<IteratorType::INORDER>(5, 4, 1, 7, 2, 8, 6);
+  auto aboba = bst.insert_each<IteratorType::INORDER>(5, 4, 1, 7, 2, 8, 6);
   auto result = bst.erase(8);
   int expected_array[] = {1, 2, 4, 5, 6, 7};
   int i = 0;
@@ -323,7 +351,7 @@ TEST_F(BSTTest, EraseSuccessKeyTest) {
 }
 
 TEST_F(BSTTest, EraseNotSuccessKeyTest) {
-  auto aboba = bst.emplace<IteratorType::INORDER>(5, 4, 1, 7, 2, 8, 6);
+  auto aboba = bst.insert_each<IteratorType::INORDER>(5, 4, 1, 7, 2, 8, 6);
   auto result = bst.erase(0);
   int expected_array[] = {1, 2, 4, 5, 6, 7, 8};
   int i = 0;
@@ -339,9 +367,9 @@ TEST_F(BSTTest, EraseNotSuccessKeyTest) {
 }
 
 TEST_F(BSTTest, SwapTest) {
-  bst.emplace<IteratorType::INORDER>(5, 4, 1, 7, 2, 8, 6);
+  bst.insert_each<IteratorType::INORDER>(5, 4, 1, 7, 2, 8, 6);
   BST<int> bst2;
-  bst2.emplace<IteratorType::INORDER>(20, 30, 40, 50);
+  bst2.insert_each<IteratorType::INORDER>(20, 30, 40, 50);
 
   bst.swap(bst2);
 
@@ -365,14 +393,15 @@ TEST_F(BSTTest, SwapTest) {
 }
 
 TEST_F(BSTTest, ExtractTest) {
-  bst.emplace<IteratorType::INORDER>(5, 4, 1, 7, 2, 8, 6);
+  bst.insert_each<IteratorType::INORDER>(5, 4, 1, 7, 2, 8, 6);
 
-  Node<int>* node = bst.extract(4);
-  ASSERT_EQ(node->value, 4);
+  BST<int>::node_type node = bst.extract(4);
+  ASSERT_EQ(node.value(), 4);
+  ASSERT_FALSE(bst.contains(4));
 }
 
 TEST_F(BSTTest, MergeTest) {
-  bst.emplace<IteratorType::INORDER>(5, 4, 1, 7, 2, 8, 6);
+  bst.insert_each<IteratorType::INORDER>(5, 4, 1, 7, 2, 8, 6);
   BST<int> bst2;
   bst2 = {20, 30, 40, 50};
   bst.merge(bst2);
@@ -389,28 +418,28 @@ TEST_F(BSTTest, MergeTest) {
 }
 
 TEST_F(BSTTest, CountTest) {
-  bst.emplace<IteratorType::INORDER>(5, 4, 1, 7, 2, 8, 6);
+  bst.insert_each<IteratorType::INORDER>(5, 4, 1, 7, 2, 8, 6);
 
   ASSERT_EQ(bst.count(1), 1);
   ASSERT_EQ(bst.count(0), 0);
 }
 
 TEST_F(BSTTest, FindTest) {
-  bst.emplace<IteratorType::INORDER>(5, 4, 1, 7, 2, 8, 6);
+  bst.insert_each<IteratorType::INORDER>(5, 4, 1, 7, 2, 8, 6);
 
   auto result = bst.find<IteratorType::INORDER>(8);
   ASSERT_EQ(*result, 8);
 }
 
 TEST_F(BSTTest, ContainsTest) {
-  bst.emplace<IteratorType::INORDER>(5, 4, 1, 7, 2, 8, 6);
+  bst.insert_each<IteratorType::INORDER>(5, 4, 1, 7, 2, 8, 6);
 
   auto result = bst.contains(8);
   ASSERT_EQ(result, true);
 }
 
 TEST_F(BSTTest, LowerBoundEqualTest) {
-  bst.emplace<IteratorType::INORDER>(5, 4, 1, 7, 2, 8, 6);
+  bst.insert_each<IteratorType::INORDER>(5, 4, 1, 7, 2, 8, 6);
 
   auto result = bst.lower_bound<IteratorType::INORDER>(1);
 
@@ -418,7 +447,7 @@ TEST_F(BSTTest, LowerBoundEqualTest) {
 }
 
 TEST_F(BSTTest, LowerBoundNextTest) {
-  bst.emplace<IteratorType::INORDER>(5, 4, 1, 7, 2, 8, 6);
+  bst.insert_each<IteratorType::INORDER>(5, 4, 1, 7, 2, 8, 6);
 
   auto result = bst.lower_bound<IteratorType::INORDER>(3);
 
@@ -426,7 +455,7 @@ TEST_F(BSTTest, LowerBoundNextTest) {
 }
 
 TEST_F(BSTTest, UpperBoundTest) {
-  bst.emplace<IteratorType::INORDER>(5, 4, 1, 7, 2, 8, 6);
+  bst.insert_each<IteratorType::INORDER>(5, 4, 1, 7, 2, 8, 6);
 
   auto result = bst.upper_bound<IteratorType::INORDER>(4);
 
@@ -478,4 +507,1229 @@ TEST_F(BSTTest, NotEqualTest2) {
   bst2 = {18, 3, 4, 1};
 
   ASSERT_EQ(bst != bst2, true);
-}
\ No newline at end of file
+}
+TEST_F(BSTTest, CopyConstructorTest) {
+  bst.insert({5, 4, 1, 7, 2, 8, 6});
+  BST<int> copy(bst);
+
+  ASSERT_EQ(copy.size(), 7);
+  ASSERT_EQ(copy == bst, true);
+
+  copy.erase(5);
+  ASSERT_EQ(bst.contains(5), true);
+}
+
+TEST_F(BSTTest, CopyAssignmentTest) {
+  bst.insert({5, 4, 1, 7, 2, 8, 6});
+  BST<int> copy;
+  copy = {100, 200};
+  copy = bst;
+
+  ASSERT_EQ(copy.size(), 7);
+  ASSERT_EQ(copy == bst, true);
+}
+
+TEST_F(BSTTest, DegenerateCopyAndClearTest) {
+  for (int i = 0; i < 10000; ++i) {
+    bst.insert<IteratorType::INORDER>(i);
+  }
+
+  BST<int> copy(bst);
+  ASSERT_EQ(copy.size(), 10000);
+  ASSERT_EQ(*copy.rbegin<IteratorType::INORDER>(), 9999);
+
+  bst.clear();
+  ASSERT_EQ(bst.size(), 0);
+  ASSERT_EQ(bst.empty(), true);
+}
+
+TEST(BalanceTest, RedBlackSortedInsertShape) {
+  BST<int, std::allocator<Node<int>>, RedBlack> tree;
+  for (int i = 1; i <= 7; ++i) {
+    tree.insert<IteratorType::INORDER>(i);
+  }
+
+  int expected_array[] = {2, 1, 4, 3, 6, 5, 7};
+  int i = 0;
+
+  for (auto it = tree.begin<IteratorType::PREORDER>();
+       it != tree.end<IteratorType::PREORDER>(); ++it) {
+    EXPECT_EQ(*it, expected_array[i]);
+    ++i;
+  }
+  ASSERT_EQ(i, 7);
+}
+
+TEST(BalanceTest, AVLSortedInsertShape) {
+  BST<int, std::allocator<Node<int>>, AVL> tree;
+  for (int i = 1; i <= 7; ++i) {
+    tree.insert<IteratorType::INORDER>(i);
+  }
+
+  int expected_array[] = {4, 2, 1, 3, 6, 5, 7};
+  int i = 0;
+
+  for (auto it = tree.begin<IteratorType::PREORDER>();
+       it != tree.end<IteratorType::PREORDER>(); ++it) {
+    EXPECT_EQ(*it, expected_array[i]);
+    ++i;
+  }
+  ASSERT_EQ(i, 7);
+}
+
+TEST(BalanceTest, RedBlackLargeSortedInsertAndErase) {
+  BST<int, std::allocator<Node<int>>, RedBlack> tree;
+  for (int i = 0; i < 200000; ++i) {
+    tree.insert<IteratorType::INORDER>(i);
+  }
+  for (int i = 0; i < 200000; i += 2) {
+    tree.erase(i);
+  }
+
+  ASSERT_EQ(tree.size(), 100000);
+  int expected = 1;
+  for (auto it = tree.begin<IteratorType::INORDER>();
+       it != tree.end<IteratorType::INORDER>(); ++it) {
+    EXPECT_EQ(*it, expected);
+    expected += 2;
+  }
+}
+
+TEST(BalanceTest, AVLMergeAndExtract) {
+  BST<int, std::allocator<Node<int>>, AVL> tree;
+  BST<int, std::allocator<Node<int>>, AVL> other;
+  for (int i = 0; i < 1000; ++i) {
+    tree.insert<IteratorType::INORDER>(2 * i);
+    other.insert<IteratorType::INORDER>(2 * i + 1);
+  }
+
+  tree.merge(other);
+  tree.extract(0);
+
+  ASSERT_EQ(tree.size(), 1999);
+  int expected = 1;
+  for (auto it = tree.begin<IteratorType::INORDER>();
+       it != tree.end<IteratorType::INORDER>(); ++it) {
+    EXPECT_EQ(*it, expected);
+    ++expected;
+  }
+}
+
+TEST(PoolAllocatorTest, InsertEraseReuse) {
+  BST<int, PoolAllocator<Node<int>>> tree;
+  tree.reserve(1000);
+
+  for (int i = 0; i < 1000; ++i) {
+    tree.insert<IteratorType::INORDER>((i * 7919) % 1000);
+  }
+  for (int i = 0; i < 1000; i += 2) {
+    tree.erase(i);
+  }
+  for (int i = 0; i < 1000; i += 2) {
+    tree.insert<IteratorType::INORDER>(i);
+  }
+
+  ASSERT_EQ(tree.size(), 1000);
+  int expected = 0;
+  for (auto it = tree.begin<IteratorType::INORDER>();
+       it != tree.end<IteratorType::INORDER>(); ++it) {
+    EXPECT_EQ(*it, expected);
+    ++expected;
+  }
+}
+
+TEST(PoolAllocatorTest, BulkClearAndRefill) {
+  BST<int, PoolAllocator<Node<int>>, RedBlack> tree;
+  for (int i = 0; i < 5000; ++i) {
+    tree.insert<IteratorType::INORDER>(i);
+  }
+
+  tree.clear();
+  ASSERT_EQ(tree.size(), 0);
+  ASSERT_EQ(tree.empty(), true);
+
+  tree.insert({3, 1, 2});
+  ASSERT_EQ(tree.size(), 3);
+  ASSERT_EQ(*tree.begin<IteratorType::INORDER>(), 1);
+}
+
+TEST(PoolAllocatorTest, SwapKeepsNodesWithTheirPool) {
+  BST<int, PoolAllocator<Node<int>>> first;
+  BST<int, PoolAllocator<Node<int>>> second;
+  first.insert({1, 2, 3});
+  second.insert({10, 20});
+
+  first.swap(second);
+  second.clear();
+
+  ASSERT_EQ(first.size(), 2);
+  ASSERT_EQ(*first.begin<IteratorType::INORDER>(), 10);
+}
+
+TEST(PoolAllocatorTest, RebindSharesThePool) {
+  typedef Node<int, true> CountedNode;
+
+  PoolAllocator<Node<int>> nodes;
+  PoolAllocator<CountedNode> counted(nodes);
+  ASSERT_TRUE(counted == nodes);
+  ASSERT_TRUE(PoolAllocator<Node<int>>(counted) == nodes);
+  ASSERT_TRUE(PoolAllocator<Node<int>>() != nodes);
+
+  CountedNode* node = counted.allocate(1);
+  Node<int>* other = nodes.allocate(1);
+  PoolAllocator<CountedNode>(nodes).deallocate(node, 1);
+  ASSERT_EQ(counted.allocate(1), node);
+  nodes.deallocate(other, 1);
+
+  BST<int, PoolAllocator<Node<int>>, OrderStatistics<AVL>> tree(nodes);
+  tree.insert({3, 1, 2});
+  ASSERT_TRUE(tree.get_allocator() == nodes);
+}
+
+TEST_F(BSTTest, InsertReturnsExistingTest) {
+  bst.insert({5, 4, 1});
+  auto result = bst.insert<IteratorType::INORDER>(4);
+
+  ASSERT_EQ(result.second, false);
+  ASSERT_EQ(*result.first, 4);
+  ASSERT_EQ(bst.size(), 3);
+}
+
+TEST_F(BSTTest, HintInsertAppendTest) {
+  for (int i = 0; i < 1000; ++i) {
+    bst.insert(bst.end<IteratorType::INORDER>(), i);
+  }
+
+  auto it = bst.begin<IteratorType::INORDER>();
+  for (int i = 0; i < 1000; ++i) {
+    it = bst.insert(it, 1000 + i);
+  }
+
+  ASSERT_EQ(bst.size(), 2000);
+  int expected = 0;
+  for (auto it = bst.begin<IteratorType::INORDER>();
+       it != bst.end<IteratorType::INORDER>(); ++it) {
+    EXPECT_EQ(*it, expected);
+    ++expected;
+  }
+}
+
+TEST_F(BSTTest, HintInsertWrongHintTest) {
+  bst.insert({10, 20, 30, 40});
+  auto hint = bst.find<IteratorType::INORDER>(40);
+
+  auto result = bst.insert(hint, 15);
+  ASSERT_EQ(*result, 15);
+
+  result = bst.insert(hint, 20);
+  ASSERT_EQ(*result, 20);
+  ASSERT_EQ(bst.size(), 5);
+
+  int expected_array[] = {10, 15, 20, 30, 40};
+  int i = 0;
+  for (auto it = bst.begin<IteratorType::INORDER>();
+       it != bst.end<IteratorType::INORDER>(); ++it) {
+    EXPECT_EQ(*it, expected_array[i]);
+    ++i;
+  }
+}
+
+TEST(BalanceTest, RedBlackHintInsertAppend) {
+  BST<int, std::allocator<Node<int>>, RedBlack> tree;
+  for (int i = 0; i < 100000; ++i) {
+    tree.insert(tree.end<IteratorType::INORDER>(), i);
+  }
+
+  ASSERT_EQ(tree.size(), 100000);
+  ASSERT_EQ(*tree.begin<IteratorType::PREORDER>() > 1000, true);
+}
+
+TEST(SortedBuildTest, SortedRangeBuildsBalancedTree) {
+  std::vector<int> values = {1, 2, 3, 4, 5, 6, 7};
+  BST<int> tree(sorted_unique, values.begin(), values.end());
+
+  int expected_array[] = {4, 2, 1, 3, 6, 5, 7};
+  int i = 0;
+
+  ASSERT_EQ(tree.size(), 7);
+  for (auto it = tree.begin<IteratorType::PREORDER>();
+       it != tree.end<IteratorType::PREORDER>(); ++it) {
+    EXPECT_EQ(*it, expected_array[i]);
+    ++i;
+  }
+}
+
+TEST(SortedBuildTest, InsertDetectsSortedInput) {
+  std::vector<int> values(100000);
+  for (int i = 0; i < 100000; ++i) {
+    values[i] = i;
+  }
+
+  BST<int, std::allocator<Node<int>>, RedBlack> tree;
+  tree.insert(values.begin(), values.end());
+  tree.erase(50000);
+  tree.insert<IteratorType::INORDER>(100000);
+
+  ASSERT_EQ(tree.size(), 100000);
+  ASSERT_EQ(*tree.begin<IteratorType::PREORDER>(), 49999);
+}
+
+TEST(SortedBuildTest, AssignChecksSortedness) {
+  std::vector<int> unsorted = {3, 1, 2, 2};
+  std::vector<int> sorted = {10, 20, 30};
+  BST<int, std::allocator<Node<int>>, AVL> tree(unsorted.begin(),
+                                                unsorted.end());
+  ASSERT_EQ(tree.size(), 3);
+
+  tree.assign(sorted.begin(), sorted.end());
+  ASSERT_EQ(tree.size(), 3);
+  ASSERT_EQ(*tree.begin<IteratorType::INORDER>(), 10);
+  ASSERT_EQ(tree.contains(1), false);
+}
+
+TEST(SortedBuildTest, SortedInsertIntoNonEmptyTree) {
+  std::vector<int> values = {2, 4, 6, 8};
+  BST<int> tree = {5, 1, 9};
+  tree.insert(values.begin(), values.end());
+
+  int expected_array[] = {1, 2, 4, 5, 6, 8, 9};
+  int i = 0;
+
+  ASSERT_EQ(tree.size(), 7);
+  for (auto it = tree.begin<IteratorType::INORDER>();
+       it != tree.end<IteratorType::INORDER>(); ++it) {
+    EXPECT_EQ(*it, expected_array[i]);
+    ++i;
+  }
+}
+
+TEST(OrderStatisticsTest, RankAndNth) {
+  BST<int64_t, std::allocator<Node<int64_t>>, OrderStatistics<RedBlack>> tree;
+  for (int64_t i = 0; i < 1000; ++i) {
+    tree.insert<IteratorType::INORDER>(i * 10);
+  }
+  tree.erase(500);
+
+  ASSERT_EQ(tree.rank(0), 0);
+  ASSERT_EQ(tree.rank(505), 50);
+  ASSERT_EQ(tree.rank(510), 50);
+  ASSERT_EQ(tree.rank(100000), 999);
+
+  ASSERT_EQ(*tree.nth<IteratorType::INORDER>(0), 0);
+  ASSERT_EQ(*tree.nth<IteratorType::INORDER>(50), 510);
+  ASSERT_EQ(*tree.nth<IteratorType::INORDER>(998), 9990);
+  ASSERT_EQ(tree.nth<IteratorType::INORDER>(999),
+            tree.end<IteratorType::INORDER>());
+}
+
+TEST(OrderStatisticsTest, IteratorArithmetic) {
+  std::vector<int> values(100);
+  for (int i = 0; i < 100; ++i) {
+    values[i] = i;
+  }
+  BST<int, std::allocator<Node<int>>, OrderStatistics<AVL>> tree(
+      values.begin(), values.end());
+
+  auto first = tree.begin<IteratorType::INORDER>();
+  auto last = tree.end<IteratorType::INORDER>();
+  ASSERT_EQ(std::distance(first, last), 100);
+
+  auto it = first + 42;
+  ASSERT_EQ(*it, 42);
+  ASSERT_EQ(it - first, 42);
+  ASSERT_EQ(last - it, 58);
+
+  it -= 40;
+  ASSERT_EQ(*it, 2);
+  it += 98;
+  ASSERT_EQ(it, last);
+}
+
+TEST(OrderStatisticsTest, RandomAccessFromEnd) {
+  BST<int, std::allocator<Node<int>>, OrderStatistics<AVL>> tree;
+  for (int i = 0; i < 100; ++i) {
+    tree.insert<IteratorType::INORDER>(i * 2);
+  }
+
+  auto first = tree.begin<IteratorType::INORDER>();
+  auto last = tree.end<IteratorType::INORDER>();
+  ASSERT_EQ(*(last - 1), 198);
+  ASSERT_EQ(*std::prev(last), 198);
+  ASSERT_EQ(*std::prev(last, 100), 0);
+  ASSERT_EQ(last[-3], 194);
+  ASSERT_EQ(first[7], 14);
+  ASSERT_EQ(*(5 + first), 10);
+
+  ASSERT_TRUE(first < last);
+  ASSERT_TRUE(first + 3 > first + 2);
+  ASSERT_TRUE(last <= last);
+  ASSERT_FALSE(first >= first + 1);
+
+  ASSERT_EQ(*std::lower_bound(first, last, 51), 52);
+  ASSERT_TRUE(std::binary_search(first, last, 120));
+
+  auto missing = tree.lower_bound<IteratorType::INORDER>(500);
+  ASSERT_EQ(missing, last);
+  ASSERT_EQ(*--missing, 198);
+}
+
+TEST_F(BSTTest, DecrementFromEnd) {
+  bst.insert({5, 4, 1, 7, 2});
+
+  auto last = bst.end<IteratorType::INORDER>();
+  ASSERT_EQ(*std::prev(last), 7);
+  ASSERT_EQ(*std::prev(bst.find<IteratorType::INORDER>(3)), 7);
+}
+
+TEST(OrderStatisticsTest, SampleIsUniformOverElements) {
+  BST<int, std::allocator<Node<int>>, OrderStatistics<RedBlack>> tree = {
+      1, 2, 3, 4};
+  std::mt19937 generator(7);
+  int hits[5] = {};
+
+  for (int i = 0; i < 4000; ++i) {
+    ++hits[*tree.sample<IteratorType::INORDER>(generator)];
+  }
+
+  for (int value = 1; value <= 4; ++value) {
+    EXPECT_GT(hits[value], 800);
+  }
+}
+
+TEST_F(BSTTest, RankWithoutAugmentationTest) {
+  bst.insert({5, 4, 1, 7, 2, 8, 6});
+
+  ASSERT_EQ(bst.rank(5), 3);
+  ASSERT_EQ(*bst.nth<IteratorType::INORDER>(4), 6);
+  ASSERT_EQ(std::distance(bst.begin<IteratorType::INORDER>(),
+                          bst.end<IteratorType::INORDER>()),
+            7);
+}
+
+TEST_F(BSTTest, MergeKeepsDuplicatesInSourceTest) {
+  bst.insert({5, 4, 1, 7, 2, 8, 6});
+  BST<int> bst2 = {4, 10, 1, 3};
+  bst.merge(bst2);
+
+  int expected_array[] = {1, 2, 3, 4, 5, 6, 7, 8, 10};
+  int i = 0;
+
+  ASSERT_EQ(bst.size(), 9);
+  for (auto it = bst.begin<IteratorType::INORDER>();
+       it != bst.end<IteratorType::INORDER>(); ++it) {
+    EXPECT_EQ(*it, expected_array[i]);
+    ++i;
+  }
+
+  ASSERT_EQ(bst2.size(), 2);
+  ASSERT_EQ(*bst2.begin<IteratorType::INORDER>(), 1);
+  ASSERT_EQ(*bst2.rbegin<IteratorType::INORDER>(), 4);
+}
+
+TEST(MergeTest, LargeRedBlackMergeStaysBalanced) {
+  BST<int, std::allocator<Node<int>>, OrderStatistics<RedBlack>> tree;
+  BST<int, std::allocator<Node<int>>, OrderStatistics<RedBlack>> other;
+  for (int i = 0; i < 50000; ++i) {
+    tree.insert<IteratorType::INORDER>(2 * i);
+    other.insert<IteratorType::INORDER>(3 * i);
+  }
+
+  tree.merge(other);
+
+  ASSERT_EQ(tree.size(), 50000 + 50000 - 16667);
+  ASSERT_EQ(other.size(), 16667);
+  ASSERT_EQ(*tree.nth<IteratorType::INORDER>(3), 4);
+
+  tree.insert<IteratorType::INORDER>(-1);
+  other.erase(0);
+  ASSERT_EQ(*tree.begin<IteratorType::INORDER>(), -1);
+  ASSERT_EQ(*other.begin<IteratorType::INORDER>(), 6);
+}
+
+TEST(MergeTest, PoolAllocatorsMergeByCopy) {
+  BST<int, PoolAllocator<Node<int>>, AVL> tree = {1, 3, 5};
+  BST<int, PoolAllocator<Node<int>>, AVL> other = {2, 3, 4};
+
+  tree.merge(other);
+  other.clear();
+
+  ASSERT_EQ(tree.size(), 5);
+  ASSERT_EQ(*tree.rbegin<IteratorType::INORDER>(), 5);
+}
+
+TEST(SetAlgebraTest, UnionIntersectionDifference) {
+  BST<int, std::allocator<Node<int>>, RedBlack> first = {1, 2, 3, 5, 8, 13};
+  BST<int, std::allocator<Node<int>>, RedBlack> second = {2, 3, 4, 5, 6};
+
+  auto united = set_union(first, second);
+  auto common = set_intersection(first, second);
+  auto rest = set_difference(first, second);
+
+  std::vector<int> united_values(united.begin<IteratorType::INORDER>(),
+                                 united.end<IteratorType::INORDER>());
+  std::vector<int> common_values(common.begin<IteratorType::INORDER>(),
+                                 common.end<IteratorType::INORDER>());
+  std::vector<int> rest_values(rest.begin<IteratorType::INORDER>(),
+                               rest.end<IteratorType::INORDER>());
+
+  ASSERT_EQ(united_values, std::vector<int>({1, 2, 3, 4, 5, 6, 8, 13}));
+  ASSERT_EQ(common_values, std::vector<int>({2, 3, 5}));
+  ASSERT_EQ(rest_values, std::vector<int>({1, 8, 13}));
+  ASSERT_EQ(first.size(), 6);
+  ASSERT_EQ(second.size(), 5);
+}
+
+TEST(SetAlgebraTest, InPlaceOperationsKeepOtherIntact) {
+  BST<int, std::allocator<Node<int>>, OrderStatistics<AVL>> tree;
+  BST<int, std::allocator<Node<int>>, OrderStatistics<AVL>> other;
+  for (int i = 0; i < 1000; ++i) {
+    tree.insert<IteratorType::INORDER>(2 * i);
+    other.insert<IteratorType::INORDER>(3 * i);
+  }
+
+  tree.set_union(other);
+  ASSERT_EQ(tree.size(), 1000 + 1000 - 334);
+  ASSERT_EQ(tree.rank(9), 6);
+
+  tree.set_difference(other);
+  ASSERT_EQ(tree.size(), 1000 - 334);
+  ASSERT_FALSE(tree.contains(6));
+  ASSERT_TRUE(tree.contains(4));
+
+  tree.set_intersection(other);
+  ASSERT_TRUE(tree.empty());
+  ASSERT_EQ(other.size(), 1000);
+}
+
+TEST(SetAlgebraTest, ParallelMatchesSequential) {
+  BST<int, std::allocator<Node<int>>, RedBlack> first;
+  BST<int, std::allocator<Node<int>>, RedBlack> second;
+  for (int i = 0; i < 100000; ++i) {
+    first.insert<IteratorType::INORDER>(i * 7 % 100003);
+    second.insert<IteratorType::INORDER>(i * 11 % 100019);
+  }
+
+  auto parallel = set_union<ExecutionPolicy::PARALLEL>(first, second);
+  auto sequential = set_union(first, second);
+  ASSERT_EQ(parallel.size(), sequential.size());
+  ASSERT_TRUE(std::equal(parallel.begin<IteratorType::INORDER>(),
+                         parallel.end<IteratorType::INORDER>(),
+                         sequential.begin<IteratorType::INORDER>()));
+
+  parallel.set_intersection<ExecutionPolicy::PARALLEL>(second);
+  ASSERT_EQ(parallel.size(), second.size());
+
+  parallel.set_difference<ExecutionPolicy::PARALLEL>(first);
+  sequential = set_difference(second, first);
+  ASSERT_EQ(parallel.size(), sequential.size());
+}
+
+struct Probe {
+  int key;
+};
+
+struct ProbeLess {
+  typedef void is_transparent;
+
+  bool operator()(int lhs, int rhs) const { return lhs < rhs; }
+  bool operator()(int lhs, const Probe& rhs) const { return lhs < rhs.key; }
+  bool operator()(const Probe& lhs, int rhs) const { return lhs.key < rhs; }
+};
+
+TEST(CompareTest, GreaterOrdersDescending) {
+  BST<int, std::allocator<Node<int>>, RedBlack, std::greater<int>> tree = {
+      3, 1, 4, 1, 5, 9, 2, 6};
+
+  std::vector<int> values(tree.begin<IteratorType::INORDER>(),
+                          tree.end<IteratorType::INORDER>());
+  ASSERT_EQ(values, std::vector<int>({9, 6, 5, 4, 3, 2, 1}));
+  ASSERT_EQ(*tree.lower_bound<IteratorType::INORDER>(7), 6);
+  ASSERT_EQ(*tree.upper_bound<IteratorType::INORDER>(6), 5);
+  ASSERT_EQ(tree.rank(4), 3);
+  ASSERT_TRUE(tree.contains(9));
+
+  tree.erase(9);
+  ASSERT_EQ(*tree.begin<IteratorType::INORDER>(), 6);
+}
+
+TEST(CompareTest, TransparentLookupUsesKeyType) {
+  BST<int, std::allocator<Node<int>>, AVL, ProbeLess> tree = {10, 20, 30};
+
+  ASSERT_TRUE(tree.contains(Probe{20}));
+  ASSERT_FALSE(tree.contains(Probe{25}));
+  ASSERT_EQ(tree.count(Probe{30}), 1);
+  ASSERT_EQ(*tree.find<IteratorType::INORDER>(Probe{10}), 10);
+  ASSERT_EQ(*tree.lower_bound<IteratorType::INORDER>(Probe{15}), 20);
+  ASSERT_EQ(*tree.upper_bound<IteratorType::INORDER>(Probe{20}), 30);
+  ASSERT_TRUE(tree.find<IteratorType::INORDER>(Probe{40}) ==
+              tree.end<IteratorType::INORDER>());
+}
+
+struct Record {
+  static inline int copies = 0;
+
+  Record(int key_, char fill) : key(key_) { payload.fill(fill); }
+  Record(const Record& other) : key(other.key), payload(other.payload) {
+    ++copies;
+  }
+  Record(Record&& other) = default;
+
+  bool operator<(const Record& other) const { return key < other.key; }
+
+  int key;
+  std::array<char, 200> payload;
+};
+
+TEST(GenericValueTest, EmplaceConstructsInPlace) {
+  BST<Record, std::allocator<Node<Record>>, RedBlack> tree;
+  Record::copies = 0;
+
+  for (int i = 0; i < 100; ++i) {
+    ASSERT_TRUE(tree.emplace<IteratorType::INORDER>(i, 'x').second);
+  }
+  auto duplicate = tree.emplace<IteratorType::INORDER>(7, 'y');
+  tree.insert<IteratorType::INORDER>(Record(100, 'z'));
+  tree.erase<IteratorType::INORDER>(tree.begin<IteratorType::INORDER>());
+
+  ASSERT_FALSE(duplicate.second);
+  ASSERT_EQ((*duplicate.first).payload[0], 'x');
+  ASSERT_EQ(tree.size(), 100);
+  ASSERT_EQ(Record::copies, 0);
+}
+
+TEST(GenericValueTest, StringKeysWithStringViewLookup) {
+  BST<std::string, std::allocator<Node<std::string>>, AVL, std::less<>> tree;
+  std::string moved(64, 'm');
+
+  tree.insert<IteratorType::INORDER>(std::string("pear"));
+  tree.insert<IteratorType::INORDER>(std::move(moved));
+  tree.emplace<IteratorType::INORDER>(3, 'a');
+  tree.insert({"apple", "fig"});
+
+  ASSERT_EQ(tree.size(), 5);
+  ASSERT_TRUE(tree.contains(std::string_view("fig")));
+  ASSERT_EQ(*tree.lower_bound<IteratorType::INORDER>(std::string_view("b")),
+            "fig");
+  ASSERT_EQ(*tree.begin<IteratorType::INORDER>(), "aaa");
+
+  tree.erase("pear");
+  ASSERT_FALSE(tree.contains(std::string_view("pear")));
+}
+
+TEST(GenericValueTest, DoubleValuesAreNotTruncated) {
+  BST<double> tree = {0.5, 0.25, 0.75};
+
+  ASSERT_EQ(tree.size(), 3);
+  ASSERT_TRUE(tree.contains(0.25));
+  ASSERT_FALSE(tree.contains(0.0));
+}
+
+TEST(NodeHandleTest, MovesNodeBetweenTrees) {
+  BST<int, std::allocator<Node<int>>, OrderStatistics<RedBlack>> from = {
+      1, 2, 3, 4, 5};
+  BST<int, std::allocator<Node<int>>, OrderStatistics<RedBlack>> to = {10, 20};
+
+  auto node = from.extract(3);
+  const int* address = &node.value();
+  auto result = to.insert<IteratorType::INORDER>(std::move(node));
+
+  ASSERT_TRUE(result.second);
+  ASSERT_TRUE(node.empty());
+  ASSERT_EQ(&*result.first, address);
+  ASSERT_EQ(from.size(), 4);
+  ASSERT_EQ(to.size(), 3);
+  ASSERT_EQ(to.rank(10), 1);
+  ASSERT_FALSE(from.contains(3));
+}
+
+TEST(NodeHandleTest, DuplicateKeepsNodeInHandle) {
+  BST<int> from = {1, 2, 3};
+  BST<int> to = {2};
+
+  auto node = from.extract<IteratorType::INORDER>(
+      from.find<IteratorType::INORDER>(2));
+  auto result = to.insert<IteratorType::INORDER>(std::move(node));
+
+  ASSERT_FALSE(result.second);
+  ASSERT_FALSE(node.empty());
+  ASSERT_EQ(node.value(), 2);
+  ASSERT_TRUE(from.extract(42).empty());
+}
+
+TEST(NodeHandleTest, UnequalAllocatorsMoveValue) {
+  BST<int, PoolAllocator<Node<int>>, AVL> from = {1, 2, 3};
+  BST<int, PoolAllocator<Node<int>>, AVL> to = {4};
+
+  to.insert<IteratorType::INORDER>(from.extract(1));
+  from.clear();
+
+  ASSERT_EQ(to.size(), 2);
+  ASSERT_EQ(*to.begin<IteratorType::INORDER>(), 1);
+}
+
+TEST(CompactTest, NodesUseIndexLinks) {
+  ASSERT_LT(sizeof(Node<int, false, true>), sizeof(Node<int>));
+  ASSERT_LT(sizeof(Node<int, true, true>), sizeof(Node<int, true>));
+
+  BST<int, std::allocator<Node<int>>, Compact<RedBlack>> bst;
+  std::vector<int> expected;
+  for (int i = 0; i < 5000; ++i) {
+    bst.insert<IteratorType::INORDER>(i * 37 % 5003);
+  }
+  for (int i = 0; i < 5003; i += 3) {
+    bst.erase(i);
+  }
+  for (int i = 0; i < 5003; ++i) {
+    if (i % 3 != 0 && bst.contains(i)) expected.push_back(i);
+  }
+
+  ASSERT_EQ(bst.size(), expected.size());
+  ASSERT_TRUE(std::equal(bst.begin<IteratorType::INORDER>(),
+                         bst.end<IteratorType::INORDER>(), expected.begin(),
+                         expected.end()));
+  ASSERT_EQ(std::distance(bst.begin<IteratorType::PREORDER>(),
+                          bst.end<IteratorType::PREORDER>()),
+            expected.size());
+  ASSERT_EQ(std::distance(bst.begin<IteratorType::POSTORDER>(),
+                          bst.end<IteratorType::POSTORDER>()),
+            expected.size());
+}
+
+TEST(CompactTest, OrderStatisticsAndSetAlgebra) {
+  typedef BST<int, std::allocator<Node<int>>, Compact<OrderStatistics<AVL>>>
+      CompactBST;
+
+  CompactBST first;
+  CompactBST second;
+  for (int i = 0; i < 20000; ++i) {
+    first.insert<IteratorType::INORDER>(i * 2);
+    second.insert<IteratorType::INORDER>(i * 3);
+  }
+
+  ASSERT_EQ(first.rank(1000), 500);
+  ASSERT_EQ(*first.nth<IteratorType::INORDER>(10), 20);
+
+  CompactBST merged = set_union<ExecutionPolicy::PARALLEL>(first, second);
+  ASSERT_EQ(merged.size(), 20000 + 20000 - 6667);
+  ASSERT_EQ(*merged.nth<IteratorType::INORDER>(3), 4);
+
+  merged.set_difference(second);
+  CompactBST expected = set_difference(first, second);
+  ASSERT_TRUE(merged == expected);
+}
+
+TEST(CompactTest, PoolSharesSlotsAcrossThreadsAndTrimsWhenEmpty) {
+  struct Slot {
+    int64_t owner[2];
+  };
+  typedef CompactPool<Slot> Pool;
+
+  std::vector<std::thread> threads;
+  std::atomic<int> failures = 0;
+  for (int t = 0; t < 4; ++t) {
+    threads.emplace_back([&failures, t] {
+      for (int round = 0; round < 20; ++round) {
+        std::vector<Slot*> slots;
+        for (int i = 0; i < 5000; ++i) {
+          slots.push_back(Pool::Allocate());
+          slots.back()->owner[0] = slots.back()->owner[1] = t;
+        }
+        for (Slot* slot : slots) {
+          if (slot->owner[0] != t || slot->owner[1] != t) ++failures;
+          Pool::Deallocate(slot);
+        }
+      }
+    });
+  }
+  for (std::thread& thread : threads) {
+    thread.join();
+  }
+  ASSERT_EQ(failures, 0);
+
+  Slot* first = Pool::Allocate();
+  ASSERT_EQ(Pool::Index(first), 1);
+  Pool::Deallocate(first);
+}
+
+TEST(ThreadedTest, InorderFollowsThreads) {
+  typedef BST<int, std::allocator<Node<int>>, Threaded<RedBlack>> ThreadedBST;
+
+  ThreadedBST bst;
+  std::set<int> expected;
+  for (int i = 0; i < 3000; ++i) {
+    int value = i * 7919 % 3001;
+    bst.insert<IteratorType::INORDER>(value);
+    expected.insert(value);
+  }
+  for (int i = 0; i < 3001; i += 4) {
+    bst.erase(i);
+    expected.erase(i);
+  }
+
+  ASSERT_TRUE(std::equal(bst.begin<IteratorType::INORDER>(),
+                         bst.end<IteratorType::INORDER>(), expected.begin(),
+                         expected.end()));
+
+  auto it = bst.rbegin<IteratorType::INORDER>();
+  for (auto expected_it = expected.rbegin(); expected_it != expected.rend();
+       ++expected_it, ++it) {
+    ASSERT_EQ(*it, *expected_it);
+  }
+}
+
+TEST(ThreadedTest, BulkOperationsRethread) {
+  typedef BST<int, std::allocator<Node<int>>, Threaded<OrderStatistics<AVL>>>
+      ThreadedBST;
+
+  std::vector<int> evens;
+  std::vector<int> odds;
+  for (int i = 0; i < 1000; ++i) {
+    evens.push_back(i * 2);
+    odds.push_back(i * 2 + 1);
+  }
+
+  ThreadedBST first(sorted_unique, evens.begin(), evens.end());
+  ThreadedBST second(sorted_unique, odds.begin(), odds.end());
+  ThreadedBST copy(first);
+  copy.set_union(second);
+
+  first.merge(second);
+  ASSERT_EQ(first.size(), 2000);
+  int expected = 0;
+  for (auto it = first.begin<IteratorType::INORDER>();
+       it != first.end<IteratorType::INORDER>(); ++it) {
+    ASSERT_EQ(*it, expected++);
+  }
+
+  ASSERT_TRUE(std::equal(copy.begin<IteratorType::INORDER>(),
+                         copy.end<IteratorType::INORDER>(),
+                         first.begin<IteratorType::INORDER>(),
+                         first.end<IteratorType::INORDER>()));
+
+  auto last = first.find<IteratorType::INORDER>(1999);
+  ASSERT_EQ(*first.insert<IteratorType::INORDER>(last, 5000), 5000);
+  ASSERT_EQ(*std::prev(first.find<IteratorType::INORDER>(5000)), 1999);
+}
+
+TEST(TraversalTest, ForEachMatchesIterators) {
+  BST<int, std::allocator<Node<int>>, AVL> tree = {50, 30, 70, 20, 40, 60,
+                                                   80, 35, 65, 10};
+
+  std::vector<int> preorder(tree.begin<IteratorType::PREORDER>(),
+                            tree.end<IteratorType::PREORDER>());
+  std::vector<int> postorder(tree.begin<IteratorType::POSTORDER>(),
+                             tree.end<IteratorType::POSTORDER>());
+  std::vector<int> inorder(tree.begin<IteratorType::INORDER>(),
+                           tree.end<IteratorType::INORDER>());
+
+  std::vector<int> visited;
+  tree.for_each<IteratorType::PREORDER>(
+      [&visited](int value) { visited.push_back(value); });
+
+  ASSERT_EQ(visited, preorder);
+  ASSERT_EQ(tree.to_vector<IteratorType::POSTORDER>(), postorder);
+  ASSERT_EQ(tree.to_vector<IteratorType::INORDER>(), inorder);
+}
+
+TEST(TraversalTest, CopyToSpan) {
+  BST<int, std::allocator<Node<int>>, Threaded<RedBlack>> tree = {5, 3, 8, 1};
+
+  std::array<int, 4> out{};
+  ASSERT_EQ(tree.copy_to<IteratorType::INORDER>(out), 4);
+  ASSERT_EQ(out, (std::array<int, 4>{1, 3, 5, 8}));
+
+  std::array<int, 2> small{};
+  ASSERT_THROW(tree.copy_to<IteratorType::INORDER>(small), std::out_of_range);
+
+  BST<int> empty;
+  ASSERT_TRUE(empty.to_vector<IteratorType::PREORDER>().empty());
+}
+
+TEST(RangeTest, EraseRangeSplitsAndJoins) {
+  typedef BST<int, std::allocator<Node<int>>, Threaded<OrderStatistics<RedBlack>>>
+      RangeBST;
+
+  RangeBST tree;
+  for (int i = 0; i < 10000; ++i) {
+    tree.insert<IteratorType::INORDER>(i);
+  }
+
+  ASSERT_EQ(tree.count_range(100, 600), 500);
+  ASSERT_EQ(tree.erase_range(100, 600), 500);
+  ASSERT_EQ(tree.size(), 9500);
+  ASSERT_EQ(tree.count_range(0, 10000), 9500);
+  ASSERT_FALSE(tree.contains(100));
+  ASSERT_FALSE(tree.contains(599));
+  ASSERT_TRUE(tree.contains(600));
+  ASSERT_EQ(*std::prev(tree.find<IteratorType::INORDER>(600)), 99);
+  ASSERT_EQ(*tree.nth<IteratorType::INORDER>(100), 600);
+
+  ASSERT_EQ(tree.erase_range(9000, 20000), 1000);
+  ASSERT_EQ(*tree.rbegin<IteratorType::INORDER>(), 8999);
+  ASSERT_EQ(tree.erase_range(-5, 50), 50);
+  ASSERT_EQ(*tree.begin<IteratorType::INORDER>(), 50);
+  ASSERT_EQ(tree.erase_range(700, 700), 0);
+
+  tree.insert<IteratorType::INORDER>(300);
+  std::vector<int> values = tree.to_vector<IteratorType::INORDER>();
+  ASSERT_EQ(values.size(), tree.size());
+  ASSERT_TRUE(std::is_sorted(values.begin(), values.end()));
+}
+
+TEST(RangeTest, IteratorEraseAndCount) {
+  BST<int, std::allocator<Node<int>>, AVL> tree;
+  BST<int> unbalanced = {8, 3, 10, 1, 6, 14, 4, 7, 13};
+  for (int i = 0; i < 1000; ++i) {
+    tree.insert<IteratorType::INORDER>(i * 2);
+  }
+
+  auto last = tree.erase(tree.find<IteratorType::INORDER>(200),
+                         tree.find<IteratorType::INORDER>(400));
+  ASSERT_EQ(*last, 400);
+  ASSERT_EQ(tree.size(), 900);
+  ASSERT_EQ(tree.count_range(0, 2000), 900);
+  ASSERT_EQ(tree.count_range(150, 450), 50);
+
+  tree.erase(tree.find<IteratorType::INORDER>(1000),
+             tree.end<IteratorType::INORDER>());
+  ASSERT_EQ(tree.size(), 400);
+  ASSERT_EQ(*tree.rbegin<IteratorType::INORDER>(), 998);
+
+  unbalanced.erase(unbalanced.find<IteratorType::PREORDER>(6),
+                   unbalanced.find<IteratorType::PREORDER>(10));
+  ASSERT_EQ(unbalanced.to_vector<IteratorType::INORDER>(),
+            (std::vector<int>{1, 3, 8, 10, 13, 14}));
+  ASSERT_EQ(unbalanced.count_range(2, 11), 3);
+}
+
+struct CountedKey {
+  static inline int comparisons = 0;
+
+  int key;
+
+  std::strong_ordering operator<=>(const CountedKey& other) const {
+    ++comparisons;
+    return key <=> other.key;
+  }
+  bool operator==(const CountedKey& other) const = default;
+};
+
+TEST(SearchTest, OneComparisonPerNode) {
+  std::vector<CountedKey> keys;
+  for (int i = 0; i < 1023; ++i) {
+    keys.push_back(CountedKey{i * 2});
+  }
+  BST<CountedKey, std::allocator<Node<CountedKey>>, RedBlack> tree(
+      sorted_unique, keys.begin(), keys.end());
+
+  CountedKey::comparisons = 0;
+  ASSERT_FALSE(tree.contains(CountedKey{511}));
+  ASSERT_EQ(CountedKey::comparisons, 10);
+
+  CountedKey::comparisons = 0;
+  ASSERT_EQ((*tree.lower_bound<IteratorType::INORDER>(CountedKey{511})).key,
+            512);
+  ASSERT_LE(CountedKey::comparisons, 10);
+
+  CountedKey::comparisons = 0;
+  ASSERT_EQ(tree.erase(CountedKey{512}), 1);
+  ASSERT_LE(CountedKey::comparisons, 10);
+}
+
+TEST(SearchTest, EqualRange) {
+  BST<std::string, std::allocator<Node<std::string>>, AVL, std::less<>> tree =
+      {"apple", "banana", "cherry", "date"};
+
+  auto hit = tree.equal_range<IteratorType::INORDER>(std::string("banana"));
+  ASSERT_EQ(*hit.first, "banana");
+  ASSERT_EQ(*hit.second, "cherry");
+
+  auto miss = tree.equal_range<IteratorType::INORDER>(std::string_view("c"));
+  ASSERT_EQ(*miss.first, "cherry");
+  ASSERT_TRUE(miss.first == miss.second);
+
+  auto last = tree.equal_range<IteratorType::INORDER>(std::string("date"));
+  ASSERT_TRUE(last.second == tree.end<IteratorType::INORDER>());
+}
+
+TEST(BatchTest, FindBatchMatchesFind) {
+  BST<int, std::allocator<Node<int>>, RedBlack> tree;
+  for (int i = 0; i < 5000; ++i) {
+    tree.insert<IteratorType::INORDER>(i * 3);
+  }
+
+  std::vector<int> keys;
+  for (int i = 0; i < 100; ++i) {
+    keys.push_back(i * 7);
+  }
+
+  std::vector<BST<int, std::allocator<Node<int>>,
+                  RedBlack>::const_iterator<IteratorType::INORDER>>
+      found(keys.size());
+  tree.find_batch<IteratorType::INORDER>(keys, found);
+
+  std::array<bool, 100> present{};
+  tree.contains_batch(keys, present);
+
+  for (size_t i = 0; i < keys.size(); ++i) {
+    ASSERT_TRUE(found[i] == tree.find<IteratorType::INORDER>(keys[i]));
+    ASSERT_EQ(present[i], keys[i] % 3 == 0);
+  }
+
+  std::array<bool, 10> small{};
+  ASSERT_THROW(tree.contains_batch(keys, small), std::out_of_range);
+}
+
+TEST(BatchTest, TransparentKeysAndEmptyTree) {
+  BST<std::string, std::allocator<Node<std::string>>, AVL, std::less<>> tree =
+      {"alpha", "beta", "gamma"};
+  std::array<std::string_view, 4> keys = {"beta", "delta", "gamma", "omega"};
+  std::array<bool, 4> present{};
+
+  tree.contains_batch(std::span<const std::string_view>(keys), present);
+  ASSERT_EQ(present, (std::array<bool, 4>{true, false, true, false}));
+
+  BST<int> empty;
+  std::array<int, 2> missing = {1, 2};
+  std::array<bool, 2> none = {true, true};
+  empty.contains_batch(missing, none);
+  ASSERT_EQ(none, (std::array<bool, 2>{false, false}));
+}
+
+TEST(ParallelCopyTest, CopyMatchesSourceShape) {
+  BST<int, std::allocator<Node<int>>, RedBlack> source;
+  for (int i = 0; i < 200000; ++i) {
+    source.insert<IteratorType::INORDER>(i * 7919 % 200003);
+  }
+  source.set_parallel_threshold(1);
+
+  BST<int, std::allocator<Node<int>>, RedBlack> copy(source);
+  ASSERT_EQ(copy.parallel_threshold(), 1);
+  ASSERT_EQ(copy.size(), source.size());
+  ASSERT_TRUE(std::equal(copy.begin<IteratorType::PREORDER>(),
+                         copy.end<IteratorType::PREORDER>(),
+                         source.begin<IteratorType::PREORDER>()));
+  ASSERT_TRUE(std::equal(copy.begin<IteratorType::INORDER>(),
+                         copy.end<IteratorType::INORDER>(),
+                         source.begin<IteratorType::INORDER>()));
+
+  BST<int, std::allocator<Node<int>>, RedBlack> assigned = {1, 2, 3};
+  assigned.set_parallel_threshold(1);
+  assigned = source;
+  ASSERT_TRUE(std::equal(assigned.begin<IteratorType::POSTORDER>(),
+                         assigned.end<IteratorType::POSTORDER>(),
+                         source.begin<IteratorType::POSTORDER>()));
+
+  BST<int, std::allocator<Node<int>>, RedBlack> swapped;
+  swapped.swap(assigned);
+  ASSERT_EQ(swapped.parallel_threshold(), 1);
+  ASSERT_NE(assigned.parallel_threshold(), 1);
+
+  assigned = swapped;
+  ASSERT_EQ(assigned.parallel_threshold(), 1);
+
+  copy.clear();
+  ASSERT_TRUE(copy.empty());
+  ASSERT_EQ(copy.begin<IteratorType::INORDER>(),
+            copy.end<IteratorType::INORDER>());
+
+  copy.insert<IteratorType::INORDER>(5);
+  ASSERT_EQ(copy.size(), 1);
+}
+
+BST<int, std::allocator<Node<int>>, AVL> MakeTree(int count) {
+  BST<int, std::allocator<Node<int>>, AVL> tree;
+  for (int i = 0; i < count; ++i) {
+    tree.insert<IteratorType::INORDER>(i);
+  }
+
+  return tree;
+}
+
+TEST(MoveTest, MoveStealsNodes) {
+  static_assert(std::is_nothrow_move_constructible_v<BST<int>>);
+  static_assert(std::is_nothrow_move_assignable_v<BST<int>>);
+  static_assert(std::is_nothrow_swappable_v<BST<int>>);
+  static_assert(
+      std::is_nothrow_move_constructible_v<BST<int, PoolAllocator<Node<int>>>>);
+
+  BST<int, std::allocator<Node<int>>, AVL> source = MakeTree(100);
+  const int* address = &*source.find<IteratorType::INORDER>(42);
+
+  BST<int, std::allocator<Node<int>>, AVL> moved(std::move(source));
+  ASSERT_EQ(moved.size(), 100);
+  ASSERT_EQ(&*moved.find<IteratorType::INORDER>(42), address);
+  ASSERT_TRUE(source.empty());
+
+  source.insert<IteratorType::INORDER>(7);
+  ASSERT_EQ(*source.begin<IteratorType::INORDER>(), 7);
+
+  source = std::move(moved);
+  ASSERT_EQ(source.size(), 100);
+  ASSERT_EQ(&*source.find<IteratorType::INORDER>(42), address);
+  ASSERT_TRUE(source.contains(99));
+}
+
+TEST(MoveTest, VectorGrowthRelocatesTrees) {
+  std::vector<BST<int, std::allocator<Node<int>>, AVL>> trees;
+  std::vector<const int*> addresses;
+
+  for (int i = 0; i < 50; ++i) {
+    trees.push_back(MakeTree(i + 1));
+    addresses.push_back(&*trees.back().begin<IteratorType::INORDER>());
+  }
+
+  for (int i = 0; i < 50; ++i) {
+    ASSERT_EQ(trees[i].size(), i + 1);
+    ASSERT_EQ(&*trees[i].begin<IteratorType::INORDER>(), addresses[i]);
+  }
+}
+
+TEST(MoveTest, PoolAllocatorMoveAssignment) {
+  BST<int, PoolAllocator<Node<int>>, RedBlack> first = {1, 2, 3};
+  BST<int, PoolAllocator<Node<int>>, RedBlack> second = {4, 5};
+
+  first = std::move(second);
+  ASSERT_EQ(first.size(), 2);
+  ASSERT_EQ(*first.begin<IteratorType::INORDER>(), 4);
+
+  second.insert<IteratorType::INORDER>(9);
+  ASSERT_EQ(second.size(), 1);
+
+  swap(first, second);
+  ASSERT_EQ(first.size(), 1);
+  ASSERT_EQ(second.size(), 2);
+}
+
+class CountingResource : public std::pmr::memory_resource {
+ public:
+  explicit CountingResource(std::pmr::memory_resource* upstream)
+      : upstream_(upstream) {}
+
+  size_t allocations = 0;
+  size_t deallocations = 0;
+
+ private:
+  void* do_allocate(size_t bytes, size_t alignment) override {
+    ++allocations;
+    return upstream_->allocate(bytes, alignment);
+  }
+
+  void do_deallocate(void* ptr, size_t bytes, size_t alignment) override {
+    ++deallocations;
+    upstream_->deallocate(ptr, bytes, alignment);
+  }
+
+  bool do_is_equal(const memory_resource& other) const noexcept override {
+    return this == &other;
+  }
+
+  std::pmr::memory_resource* upstream_;
+};
+
+TEST(AllocatorTest, PmrTreeDrawsFromResource) {
+  CountingResource fallback(std::pmr::new_delete_resource());
+  std::pmr::memory_resource* previous =
+      std::pmr::set_default_resource(&fallback);
+
+  std::pmr::monotonic_buffer_resource arena(std::pmr::new_delete_resource());
+  CountingResource counting(&arena);
+  {
+    pmr::BST<int, OrderStatistics<RedBlack>> tree(&counting);
+    for (int i = 0; i < 1000; ++i) {
+      tree.insert<IteratorType::INORDER>(i * 7 % 1009);
+    }
+    ASSERT_EQ(tree.get_allocator().resource(), &counting);
+    ASSERT_EQ(*tree.nth<IteratorType::INORDER>(500), 500);
+
+    pmr::BST<int, OrderStatistics<RedBlack>> copy(tree, &counting);
+    ASSERT_EQ(copy.get_allocator().resource(), &counting);
+
+    pmr::BST<int, OrderStatistics<RedBlack>> moved(std::move(copy));
+    ASSERT_EQ(moved.get_allocator().resource(), &counting);
+    ASSERT_EQ(moved.size(), 1000);
+
+    tree.swap(moved);
+    tree.erase(5);
+    ASSERT_EQ(tree.size(), 999);
+
+    std::vector<int> sorted = {1, 3, 5, 7, 9};
+    pmr::BST<int, OrderStatistics<RedBlack>> built(
+        sorted_unique, sorted.begin(), sorted.end(), &counting);
+    ASSERT_EQ(built.get_allocator().resource(), &counting);
+    ASSERT_EQ(built.size(), 5);
+
+    built.assign(sorted_unique, sorted.begin(), sorted.begin() + 2);
+    ASSERT_EQ(built.get_allocator().resource(), &counting);
+    ASSERT_EQ(built.size(), 2);
+  }
+  ASSERT_EQ(counting.allocations, counting.deallocations);
+  ASSERT_GE(counting.allocations, 2000);
+  ASSERT_EQ(fallback.allocations, 0);
+
+  std::pmr::set_default_resource(previous);
+}
+
+TEST(AllocatorTest, PmrAllocatorDoesNotPropagate) {
+  std::pmr::monotonic_buffer_resource first_arena;
+  std::pmr::monotonic_buffer_resource second_arena;
+
+  pmr::BST<std::string, AVL> first({"a", "b", "c"}, &first_arena);
+  pmr::BST<std::string, AVL> second(&second_arena);
+
+  second = first;
+  ASSERT_EQ(second.get_allocator().resource(), &second_arena);
+  ASSERT_EQ(second.size(), 3);
+
+  second = std::move(first);
+  ASSERT_EQ(second.get_allocator().resource(), &second_arena);
+  ASSERT_TRUE(second.contains("b"));
+
+  pmr::BST<std::string, AVL> copy(second);
+  ASSERT_EQ(copy.get_allocator().resource(),
+            std::pmr::get_default_resource());
+  ASSERT_TRUE(std::equal(copy.begin<IteratorType::INORDER>(),
+                         copy.end<IteratorType::INORDER>(),
+                         second.begin<IteratorType::INORDER>()));
+}
+
+struct Fragile {
+  static inline std::atomic<int> live = 0;
+  static inline std::atomic<int> copies_left = -1;
+
+  Fragile(int key_) : key(key_) { ++live; }
+  Fragile(const Fragile& other) : key(other.key) {
+    if (copies_left.load() >= 0 && copies_left.fetch_sub(1) <= 0) {
+      throw std::bad_alloc();
+    }
+    ++live;
+  }
+  ~Fragile() { --live; }
+
+  Fragile& operator=(const Fragile& other) = default;
+
+  bool operator<(const Fragile& other) const { return key < other.key; }
+
+  int key;
+};
+
+TEST(ParallelCopyTest, FailedCopyFreesClonedNodes) {
+  {
+    BST<Fragile, std::allocator<Node<Fragile>>, AVL> source;
+    for (int i = 0; i < 50000; ++i) {
+      source.insert<IteratorType::INORDER>(Fragile(i * 7919 % 50021));
+    }
+    source.set_parallel_threshold(1);
+    int live = Fragile::live.load();
+
+    Fragile::copies_left = 30000;
+    ASSERT_THROW(
+        (BST<Fragile, std::allocator<Node<Fragile>>, AVL>(source)),
+        std::bad_alloc);
+    Fragile::copies_left = -1;
+
+    ASSERT_EQ(Fragile::live.load(), live);
+  }
+
+  ASSERT_EQ(Fragile::live.load(), 0);
+}
@@ -0,0 +1,274 @@
+#include "../lib/BST.hpp"
+
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <memory_resource>
+#include <random>
+#include <set>
+#include <string>
+#include <vector>
+
+template <typename T>
+using BTreeSet = BST<T, std::allocator<Node<T>>, BTree>;
+
+template <typename T, typename Make>
+void CheckAgainstSet(Make make) {
+  BTreeSet<T> tree;
+  std::set<T> expected;
+  std::mt19937 random(42);
+
+  for (int step = 0; step < 20000; ++step) {
+    T value = make(random() % 3000);
+
+    if (random() % 3 == 0) {
+      ASSERT_EQ(tree.erase(value), expected.erase(value));
+    } else {
+      auto result = tree.template insert<IteratorType::INORDER>(value);
+      ASSERT_EQ(result.second, expected.insert(value).second);
+      ASSERT_EQ(*result.first, value);
+    }
+  }
+
+  ASSERT_EQ(tree.size(), expected.size());
+  ASSERT_TRUE(std::equal(tree.template begin<IteratorType::INORDER>(),
+                         tree.template end<IteratorType::INORDER>(),
+                         expected.begin(), expected.end()));
+
+  for (int i = 0; i < 3001; ++i) {
+    T key = make(i);
+    ASSERT_EQ(tree.contains(key), expected.count(key) == 1);
+
+    auto lower = tree.template lower_bound<IteratorType::INORDER>(key);
+    if (expected.lower_bound(key) == expected.end()) {
+      ASSERT_TRUE(lower == tree.template end<IteratorType::INORDER>());
+    } else {
+      ASSERT_EQ(*lower, *expected.lower_bound(key));
+    }
+
+    auto upper = tree.template upper_bound<IteratorType::INORDER>(key);
+    if (expected.upper_bound(key) == expected.end()) {
+      ASSERT_TRUE(upper == tree.template end<IteratorType::INORDER>());
+    } else {
+      ASSERT_EQ(*upper, *expected.upper_bound(key));
+    }
+  }
+}
+
+struct Counted {
+  static inline int live = 0;
+
+  explicit Counted(int key_) : key(key_) { ++live; }
+  Counted(const Counted& other) : key(other.key) { ++live; }
+  Counted& operator=(const Counted& other) = default;
+  ~Counted() { --live; }
+
+  bool operator<(const Counted& other) const { return key < other.key; }
+
+  int key;
+};
+
+TEST(BTreeTest, MatchesStdSet) {
+  CheckAgainstSet<int32_t>([](int i) { return int32_t(i - 1500); });
+  CheckAgainstSet<uint32_t>([](int i) { return uint32_t(i) * 0x10001u; });
+  CheckAgainstSet<int64_t>([](int i) { return int64_t(i - 1500) << 33; });
+  CheckAgainstSet<uint64_t>([](int i) { return uint64_t(i) << 52; });
+  CheckAgainstSet<float>([](int i) { return float(i) / 4 - 300; });
+  CheckAgainstSet<double>([](int i) { return double(i) / 8 - 100; });
+  CheckAgainstSet<std::string>([](int i) { return std::to_string(i); });
+}
+
+TEST(BTreeTest, IterationAndErase) {
+  BTreeSet<int> tree;
+  for (int i = 999; i >= 0; --i) {
+    tree.insert<IteratorType::INORDER>(i);
+  }
+
+  int expected = 1000;
+  for (auto it = tree.end<IteratorType::INORDER>();
+       it != tree.begin<IteratorType::INORDER>();) {
+    ASSERT_EQ(*--it, --expected);
+  }
+
+  auto it = tree.find<IteratorType::INORDER>(500);
+  while (it != tree.end<IteratorType::INORDER>()) {
+    it = tree.erase(it);
+  }
+  ASSERT_EQ(tree.size(), 500);
+
+  for (int i = 0; i < 500; i += 2) {
+    ASSERT_EQ(tree.erase(i), 1);
+  }
+  ASSERT_EQ(tree.size(), 250);
+  ASSERT_EQ(*tree.begin<IteratorType::INORDER>(), 1);
+
+  BTreeSet<int> copy = tree;
+  tree.clear();
+  ASSERT_TRUE(tree.empty());
+  ASSERT_EQ(copy.size(), 250);
+  ASSERT_EQ(*--copy.end<IteratorType::INORDER>(), 499);
+}
+
+TEST(BTreeTest, NodesFitTwoCacheLines) {
+  ASSERT_LE(sizeof(BTreeIndex<int>::Leaf), 128);
+  ASSERT_LE(sizeof(BTreeIndex<int>::Inner), 128);
+  ASSERT_LE(sizeof(BTreeIndex<double>::Leaf), 128);
+  ASSERT_LE(sizeof(BTreeIndex<double>::Inner), 128);
+}
+
+TEST(BTreeTest, RangeEraseAndReverseIteration) {
+  BTreeSet<int> tree;
+  std::set<int> expected;
+  for (int i = 0; i < 3000; ++i) {
+    tree.insert<IteratorType::INORDER>(i);
+    expected.insert(i);
+  }
+
+  auto next = tree.erase(tree.find<IteratorType::INORDER>(1000),
+                         tree.find<IteratorType::INORDER>(2500));
+  expected.erase(expected.find(1000), expected.find(2500));
+  ASSERT_EQ(*next, 2500);
+
+  for (auto it = tree.begin<IteratorType::INORDER>();
+       it != tree.end<IteratorType::INORDER>();) {
+    it = *it % 3 == 0 ? tree.erase(it) : std::next(it);
+  }
+  std::erase_if(expected, [](int value) { return value % 3 == 0; });
+
+  ASSERT_EQ(tree.size(), expected.size());
+  ASSERT_TRUE(std::equal(tree.rbegin<IteratorType::INORDER>(),
+                         tree.rend<IteratorType::INORDER>(), expected.rbegin(),
+                         expected.rend()));
+
+  auto range = tree.equal_range<IteratorType::INORDER>(2501);
+  ASSERT_EQ(*range.first, 2501);
+  ASSERT_EQ(*range.second, 2503);
+  range = tree.equal_range<IteratorType::INORDER>(1500);
+  ASSERT_TRUE(range.first == range.second);
+  ASSERT_EQ(*range.first, 2500);
+
+  ASSERT_TRUE(tree.erase(tree.begin<IteratorType::INORDER>(),
+                         tree.end<IteratorType::INORDER>()) ==
+              tree.end<IteratorType::INORDER>());
+  ASSERT_TRUE(tree.empty());
+}
+
+TEST(BTreeTest, ExtractAndMerge) {
+  BTreeSet<std::string> tree = {"a", "b", "c"};
+  BTreeSet<std::string> source = {"b", "d", "e"};
+
+  auto node = tree.extract("a");
+  ASSERT_FALSE(node.empty());
+  ASSERT_EQ(node.value(), "a");
+  ASSERT_EQ(tree.size(), 2);
+  ASSERT_TRUE(tree.extract("z").empty());
+
+  node.value() = "f";
+  auto inserted = tree.insert<IteratorType::INORDER>(std::move(node));
+  ASSERT_TRUE(inserted.second);
+  ASSERT_EQ(*inserted.first, "f");
+  ASSERT_TRUE(node.empty());
+
+  tree.merge(source);
+  ASSERT_EQ(tree.size(), 5);
+  ASSERT_EQ(source.size(), 1);
+  ASSERT_EQ(*source.begin<IteratorType::INORDER>(), "b");
+  ASSERT_EQ(*tree.rbegin<IteratorType::INORDER>(), "f");
+}
+
+TEST(BTreeTest, KeySearchMatchesScalar) {
+  std::vector<int64_t> keys;
+  for (int64_t i = -40; i < 40; i += 3) {
+    keys.push_back(i);
+  }
+
+  std::less<int64_t> less;
+  for (size_t count = 0; count <= keys.size(); ++count) {
+    for (int64_t key = -45; key < 45; ++key) {
+      size_t lower = std::lower_bound(keys.begin(), keys.begin() + count, key) -
+                     keys.begin();
+      size_t upper = std::upper_bound(keys.begin(), keys.begin() + count, key) -
+                     keys.begin();
+
+      ASSERT_EQ((KeySearch<int64_t, std::less<int64_t>>::LowerBound(
+                    keys.data(), count, key, less)),
+                lower);
+      ASSERT_EQ((KeySearch<int64_t, std::less<int64_t>>::UpperBound(
+                    keys.data(), count, key, less)),
+                upper);
+    }
+  }
+}
+
+TEST(BTreeTest, MoveStealsIndex) {
+  static_assert(std::is_nothrow_move_constructible_v<BTreeSet<int>>);
+
+  BTreeSet<int> source = {3, 1, 2};
+  const int* address = &*source.begin<IteratorType::INORDER>();
+
+  BTreeSet<int> moved(std::move(source));
+  ASSERT_EQ(moved.size(), 3);
+  ASSERT_EQ(&*moved.begin<IteratorType::INORDER>(), address);
+  ASSERT_TRUE(source.empty());
+
+  source = {7};
+  source = std::move(moved);
+  ASSERT_EQ(source.size(), 3);
+  ASSERT_EQ(*source.begin<IteratorType::INORDER>(), 1);
+}
+
+TEST(BTreeTest, PmrIndexDrawsFromResource) {
+  std::pmr::monotonic_buffer_resource arena;
+  pmr::BST<int, BTree> tree(&arena);
+  for (int i = 0; i < 10000; ++i) {
+    tree.insert<IteratorType::INORDER>(i);
+  }
+  ASSERT_EQ(tree.get_allocator().resource(), &arena);
+
+  pmr::BST<int, BTree> moved(std::move(tree));
+  ASSERT_EQ(moved.get_allocator().resource(), &arena);
+  ASSERT_EQ(moved.size(), 10000);
+
+  std::pmr::monotonic_buffer_resource other_arena;
+  pmr::BST<int, BTree> other(&other_arena);
+  other = std::move(moved);
+  ASSERT_EQ(other.get_allocator().resource(), &other_arena);
+  ASSERT_EQ(other.size(), 10000);
+}
+
+TEST(BTreeTest, OnlyStoredKeysAreAlive) {
+  {
+    BTreeSet<Counted> tree;
+    tree.insert<IteratorType::INORDER>(Counted(1));
+    ASSERT_EQ(Counted::live, 1);
+
+    std::mt19937 random(7);
+    for (int step = 0; step < 20000; ++step) {
+      Counted key(random() % 3000);
+
+      if (random() % 3 == 0) {
+        tree.erase(key);
+      } else {
+        tree.insert<IteratorType::INORDER>(key);
+      }
+    }
+
+    // Leaves hold every key once; inner nodes hold copies as separators.
+    int stored = Counted::live;
+    ASSERT_GE(stored, int(tree.size()));
+
+    BTreeSet<Counted> copy = tree;
+    ASSERT_EQ(Counted::live, 2 * stored);
+
+    tree.merge(copy);
+    ASSERT_EQ(copy.size(), tree.size());
+
+    copy.clear();
+    ASSERT_EQ(Counted::live, stored);
+
+    tree.clear();
+    ASSERT_EQ(Counted::live, 0);
+  }
+
+  ASSERT_EQ(Counted::live, 0);
+}
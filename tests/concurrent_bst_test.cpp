@@ -0,0 +1,394 @@
+#include "../lib/ConcurrentBST.hpp"
+#include "../lib/FineGrainedBST.hpp"
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <cstdint>
+#include <iterator>
+#include <memory_resource>
+#include <random>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+TEST(ConcurrentBSTTest, SingleThreadedOperations) {
+  ConcurrentBST<int> tree;
+
+  for (int i = 0; i < 1000; ++i) {
+    ASSERT_TRUE(tree.insert(i * 2));
+  }
+  ASSERT_FALSE(tree.insert(10));
+  ASSERT_EQ(tree.size(), 1000);
+
+  ASSERT_TRUE(tree.contains(500));
+  ASSERT_FALSE(tree.contains(501));
+  ASSERT_EQ(tree.find(42), 42);
+  ASSERT_EQ(tree.find(43), std::nullopt);
+  ASSERT_EQ(tree.lower_bound(43), 44);
+  ASSERT_EQ(tree.lower_bound(5000), std::nullopt);
+
+  for (int i = 0; i < 1000; i += 2) {
+    ASSERT_EQ(tree.erase(i * 2), 1);
+  }
+  ASSERT_EQ(tree.erase(0), 0);
+  ASSERT_EQ(tree.size(), 500);
+
+  int expected = 2;
+  tree.for_each([&expected](int value) {
+    ASSERT_EQ(value, expected);
+    expected += 4;
+  });
+  ASSERT_EQ(expected, 2002);
+}
+
+TEST(ConcurrentBSTTest, ReadersRunAlongsideWriter) {
+  ConcurrentBST<int> tree;
+  for (int i = 0; i < 20000; i += 2) {
+    tree.insert(i);
+  }
+
+  std::atomic<bool> done = false;
+  std::atomic<int> failures = 0;
+  std::vector<std::thread> readers;
+
+  for (int r = 0; r < 4; ++r) {
+    readers.emplace_back([&tree, &done, &failures, r] {
+      while (!done.load()) {
+        for (int i = r * 2; i < 20000; i += 64) {
+          if (!tree.contains(i)) failures.fetch_add(1);
+        }
+
+        int previous = -1;
+        tree.for_each([&previous, &failures](int value) {
+          if (value <= previous) failures.fetch_add(1);
+          previous = value;
+        });
+      }
+    });
+  }
+
+  for (int round = 0; round < 20; ++round) {
+    for (int i = 1; i < 20000; i += 2) {
+      tree.insert(i);
+    }
+    for (int i = 1; i < 20000; i += 2) {
+      tree.erase(i);
+    }
+  }
+
+  done.store(true);
+  for (std::thread& reader : readers) {
+    reader.join();
+  }
+
+  ASSERT_EQ(failures.load(), 0);
+  ASSERT_EQ(tree.size(), 10000);
+}
+
+TEST(FineGrainedBSTTest, SingleThreadedOperations) {
+  FineGrainedBST<int> tree;
+
+  for (int i = 0; i < 1000; ++i) {
+    ASSERT_TRUE(tree.insert((i * 7919) % 1000 * 2).second);
+  }
+  ASSERT_FALSE(tree.insert(10).second);
+  ASSERT_EQ(tree.size(), 1000);
+
+  ASSERT_TRUE(tree.contains(500));
+  ASSERT_FALSE(tree.contains(501));
+  ASSERT_EQ(*tree.find(42), 42);
+  ASSERT_EQ(tree.find(43), tree.end());
+  ASSERT_EQ(*tree.lower_bound(43), 44);
+  ASSERT_EQ(*tree.lower_bound(-5), 0);
+  ASSERT_EQ(tree.lower_bound(5000), tree.end());
+
+  for (int i = 0; i < 1000; i += 2) {
+    ASSERT_EQ(tree.erase(i * 2), 1);
+  }
+  ASSERT_EQ(tree.erase(0), 0);
+  ASSERT_EQ(tree.size(), 500);
+
+  int expected = 2;
+  tree.for_each([&expected](int value) {
+    ASSERT_EQ(value, expected);
+    expected += 4;
+  });
+  ASSERT_EQ(expected, 2002);
+}
+
+TEST(FineGrainedBSTTest, IteratesLikeBST) {
+  FineGrainedBST<int> tree;
+  tree.insert({9, 3, 7, 1, 5});
+  ASSERT_EQ(tree.begin(), tree.cbegin());
+
+  std::vector<int> values(tree.begin(), tree.end());
+  ASSERT_EQ(values, (std::vector<int>{1, 3, 5, 7, 9}));
+
+  std::pair<FineGrainedBST<int>::const_iterator, bool> result =
+      tree.insert(4);
+  ASSERT_TRUE(result.second);
+  ASSERT_EQ(*result.first, 4);
+  ASSERT_EQ(*std::next(result.first), 5);
+
+  result = tree.emplace(7);
+  ASSERT_FALSE(result.second);
+  ASSERT_EQ(*result.first, 7);
+
+  ASSERT_EQ(*tree.upper_bound(5), 7);
+  ASSERT_EQ(*tree.upper_bound(0), 1);
+  ASSERT_EQ(tree.upper_bound(9), tree.end());
+  ASSERT_EQ(tree.count(3), 1);
+  ASSERT_EQ(tree.count(2), 0);
+
+  auto range = tree.equal_range(5);
+  ASSERT_EQ(*range.first, 5);
+  ASSERT_EQ(*range.second, 7);
+  range = tree.equal_range(6);
+  ASSERT_EQ(range.first, range.second);
+  ASSERT_EQ(*range.first, 7);
+
+  FineGrainedBST<int>::const_iterator next = tree.erase(tree.find(5));
+  ASSERT_EQ(*next, 7);
+  ASSERT_EQ(tree.erase(tree.find(9)), tree.end());
+
+  values.assign(tree.begin(), tree.end());
+  ASSERT_EQ(values, (std::vector<int>{1, 3, 4, 7}));
+}
+
+TEST(FineGrainedBSTTest, TransparentLookup) {
+  FineGrainedBST<std::string, std::less<>> tree;
+  tree.insert({"apple", "cherry", "banana"});
+
+  ASSERT_TRUE(tree.contains(std::string_view("banana")));
+  ASSERT_EQ(tree.count("durian"), 0);
+  ASSERT_EQ(*tree.find("cherry"), "cherry");
+  ASSERT_EQ(*tree.lower_bound("b"), "banana");
+  ASSERT_EQ(*tree.upper_bound("banana"), "cherry");
+  ASSERT_EQ(*tree.equal_range("apple").second, "banana");
+}
+
+TEST(FineGrainedBSTTest, AscendingInsertsStayBalanced) {
+  constexpr uint64_t kKeys = 1 << 16;
+  FineGrainedBST<uint64_t> tree;
+
+  for (uint64_t id = 0; id < kKeys; ++id) {
+    tree.insert(id);
+  }
+
+  // An AVL tree over kKeys + 1 leaves is at most 1.44 * 17 levels tall.
+  ASSERT_LE(tree.height(), 25);
+
+  for (uint64_t id = 0; id < kKeys; id += 2) {
+    tree.erase(id);
+  }
+  ASSERT_LE(tree.height(), 24);
+  ASSERT_EQ(*tree.begin(), 1);
+}
+
+TEST(FineGrainedBSTTest, ConcurrentAscendingInsertsStayBalanced) {
+  constexpr int kThreads = 16;
+  constexpr uint64_t kKeys = 1 << 16;
+  FineGrainedBST<uint64_t> tree;
+  std::atomic<uint64_t> next_id = 0;
+  std::vector<std::thread> writers;
+
+  for (int t = 0; t < kThreads; ++t) {
+    writers.emplace_back([&tree, &next_id] {
+      for (uint64_t id = next_id.fetch_add(1); id < kKeys;
+           id = next_id.fetch_add(1)) {
+        tree.insert(id);
+      }
+    });
+  }
+
+  for (std::thread& writer : writers) {
+    writer.join();
+  }
+
+  ASSERT_EQ(tree.size(), kKeys);
+  ASSERT_LE(tree.height(), 34);
+
+  uint64_t expected = 0;
+  for (uint64_t id : tree) {
+    ASSERT_EQ(id, expected);
+    ++expected;
+  }
+  ASSERT_EQ(expected, kKeys);
+}
+
+TEST(FineGrainedBSTTest, DrawsNodesFromAllocator) {
+  std::pmr::synchronized_pool_resource pool;
+  std::pmr::polymorphic_allocator<int> allocator(&pool);
+  std::pmr::memory_resource* previous =
+      std::pmr::set_default_resource(std::pmr::null_memory_resource());
+
+  {
+    FineGrainedBST<int, std::less<int>, std::pmr::polymorphic_allocator<int>>
+        tree(allocator);
+    ASSERT_EQ(tree.get_allocator().resource(), &pool);
+
+    for (int i = 0; i < 1000; ++i) {
+      tree.insert(i);
+    }
+    for (int i = 0; i < 1000; i += 3) {
+      tree.erase(i);
+    }
+    ASSERT_EQ(tree.size(), 666);
+  }
+
+  std::pmr::set_default_resource(previous);
+}
+
+TEST(FineGrainedBSTTest, WritersRunConcurrently) {
+  constexpr int kThreads = 16;
+  constexpr uint64_t kKeys = 1 << 14;
+  FineGrainedBST<uint64_t> tree;
+  std::atomic<int> churning = kThreads;
+  std::vector<std::thread> writers;
+
+  for (int t = 0; t < kThreads; ++t) {
+    writers.emplace_back([&tree, &churning, t] {
+      for (uint64_t i = t; i < kKeys; i += kThreads) {
+        tree.insert(i * 7919 % kKeys);
+      }
+
+      std::mt19937_64 random(t);
+      for (int i = 0; i < 20000; ++i) {
+        uint64_t key = kKeys + random() % kKeys;
+        if (random() % 2) {
+          tree.insert(key);
+        } else {
+          tree.erase(key);
+        }
+        tree.contains(random() % (kKeys * 2));
+      }
+
+      churning.fetch_sub(1);
+      while (churning.load() != 0) {
+        std::this_thread::yield();
+      }
+
+      for (uint64_t key = kKeys + t; key < kKeys * 2; key += kThreads) {
+        tree.erase(key);
+      }
+    });
+  }
+
+  for (std::thread& writer : writers) {
+    writer.join();
+  }
+
+  ASSERT_EQ(tree.size(), kKeys);
+
+  uint64_t expected = 0;
+  tree.for_each([&expected](uint64_t value) {
+    ASSERT_EQ(value, expected);
+    ++expected;
+  });
+  ASSERT_EQ(expected, kKeys);
+}
+
+TEST(FineGrainedBSTTest, ReadersSeeStableKeys) {
+  FineGrainedBST<int> tree;
+  for (int i = 0; i < 10000; ++i) {
+    tree.insert(i * 7919 % 10000 * 2);
+  }
+
+  std::atomic<bool> done = false;
+  std::atomic<int> failures = 0;
+  std::vector<std::thread> threads;
+
+  for (int r = 0; r < 4; ++r) {
+    threads.emplace_back([&tree, &done, &failures, r] {
+      while (!done.load()) {
+        for (int i = r * 2; i < 20000; i += 64) {
+          if (!tree.contains(i)) failures.fetch_add(1);
+          if (*tree.lower_bound(i) != i) failures.fetch_add(1);
+        }
+
+        int previous = -1;
+        int stable = 0;
+        tree.for_each([&previous, &stable, &failures](int value) {
+          if (value <= previous) failures.fetch_add(1);
+          if (value % 2 == 0) ++stable;
+          previous = value;
+        });
+        if (stable != 10000) failures.fetch_add(1);
+      }
+    });
+  }
+
+  for (int w = 0; w < 4; ++w) {
+    threads.emplace_back([&tree, w] {
+      for (int round = 0; round < 10; ++round) {
+        for (int i = w * 2 + 1; i < 20000; i += 8) {
+          tree.insert(i);
+        }
+        for (int i = w * 2 + 1; i < 20000; i += 8) {
+          tree.erase(i);
+        }
+      }
+    });
+  }
+
+  for (size_t i = 4; i < threads.size(); ++i) {
+    threads[i].join();
+  }
+  done.store(true);
+  for (size_t i = 0; i < 4; ++i) {
+    threads[i].join();
+  }
+
+  ASSERT_EQ(failures.load(), 0);
+  ASSERT_EQ(tree.size(), 10000);
+}
+
+TEST(EpochDomainTest, CollectsListsLeftByIdleThreads) {
+  struct Tracked {
+    explicit Tracked(std::atomic<int>& freed_) : freed(freed_) {}
+    ~Tracked() { freed.fetch_add(1); }
+
+    std::atomic<int>& freed;
+  };
+
+  std::atomic<int> idle_freed = 0;
+  std::atomic<int> busy_freed = 0;
+  EpochDomain domain;
+
+  std::thread([&domain, &idle_freed] {
+    EpochDomain::Guard guard = domain.Pin();
+    for (int i = 0; i < 3; ++i) {
+      domain.Retire(guard, new Tracked(idle_freed));
+    }
+  }).join();
+
+  for (int i = 0; i < 256; ++i) {
+    EpochDomain::Guard guard = domain.Pin();
+    domain.Retire(guard, new Tracked(busy_freed));
+  }
+
+  ASSERT_EQ(idle_freed.load(), 3);
+  ASSERT_GT(busy_freed.load(), 0);
+}
+
+TEST(FineGrainedBSTTest, KeysNeedNoDefaultConstructor) {
+  struct Key {
+    explicit Key(int id_) : id(id_) {}
+
+    bool operator<(const Key& other) const { return id < other.id; }
+
+    int id;
+  };
+
+  FineGrainedBST<Key> tree;
+  for (int i = 0; i < 100; ++i) {
+    ASSERT_TRUE(tree.insert(Key(i * 37 % 100)).second);
+  }
+
+  ASSERT_EQ(tree.size(), 100);
+  ASSERT_EQ(tree.find(Key(42))->id, 42);
+  ASSERT_EQ(tree.erase(Key(42)), 1);
+  ASSERT_FALSE(tree.contains(Key(42)));
+}
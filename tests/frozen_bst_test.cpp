@@ -0,0 +1,75 @@
+#include "../lib/BST.hpp"
+
+#include <gtest/gtest.h>
+
+#include <string>
+#include <string_view>
+#include <vector>
+
+TEST(FrozenBSTTest, LookupsMatchSourceTree) {
+  BST<int, std::allocator<Node<int>>, RedBlack> tree;
+  for (int i = 0; i < 1000; ++i) {
+    tree.insert<IteratorType::INORDER>(3 * i);
+  }
+
+  FrozenBST<int> frozen = tree.freeze();
+
+  ASSERT_EQ(frozen.size(), 1000);
+  for (int key = -2; key < 3005; ++key) {
+    ASSERT_EQ(frozen.contains(key), tree.contains(key));
+
+    auto lower = frozen.lower_bound(key);
+    auto expected_lower = tree.lower_bound<IteratorType::INORDER>(key);
+    if (expected_lower == tree.end<IteratorType::INORDER>()) {
+      ASSERT_TRUE(lower == frozen.end<IteratorType::INORDER>());
+    } else {
+      ASSERT_EQ(*lower, *expected_lower);
+    }
+
+    auto upper = frozen.upper_bound(key);
+    auto expected_upper = tree.upper_bound<IteratorType::INORDER>(key);
+    if (expected_upper == tree.end<IteratorType::INORDER>()) {
+      ASSERT_TRUE(upper == frozen.end<IteratorType::INORDER>());
+    } else {
+      ASSERT_EQ(*upper, *expected_upper);
+    }
+  }
+}
+
+TEST(FrozenBSTTest, InorderIterationBothWays) {
+  BST<int> tree = {5, 4, 1, 7, 2, 8, 6, 3};
+  FrozenBST<int> frozen = tree.freeze();
+
+  std::vector<int> forward(frozen.begin<IteratorType::INORDER>(),
+                           frozen.end<IteratorType::INORDER>());
+  ASSERT_EQ(forward, std::vector<int>({1, 2, 3, 4, 5, 6, 7, 8}));
+
+  std::vector<int> backward;
+  auto it = frozen.end<IteratorType::INORDER>();
+  while (it != frozen.begin<IteratorType::INORDER>()) {
+    --it;
+    backward.push_back(*it);
+  }
+  ASSERT_EQ(backward, std::vector<int>({8, 7, 6, 5, 4, 3, 2, 1}));
+
+  ASSERT_EQ(*frozen.find(6), 6);
+  ASSERT_TRUE(frozen.find(9) == frozen.end<IteratorType::INORDER>());
+}
+
+TEST(FrozenBSTTest, EmptyAndTransparent) {
+  BST<std::string, std::allocator<Node<std::string>>, AVL, std::less<>> tree;
+  FrozenBST<std::string, std::less<>> empty = tree.freeze();
+
+  ASSERT_TRUE(empty.empty());
+  ASSERT_TRUE(empty.begin<IteratorType::INORDER>() ==
+              empty.end<IteratorType::INORDER>());
+  ASSERT_FALSE(empty.contains(std::string_view("a")));
+
+  tree.insert({"kiwi", "apple", "plum"});
+  FrozenBST<std::string, std::less<>> frozen = tree.freeze();
+  tree.clear();
+
+  ASSERT_TRUE(frozen.contains(std::string_view("plum")));
+  ASSERT_EQ(*frozen.lower_bound(std::string_view("b")), "kiwi");
+  ASSERT_EQ(*frozen.begin<IteratorType::INORDER>(), "apple");
+}
@@ -0,0 +1,208 @@
+#include "../lib/BST.hpp"
+
+#include <gtest/gtest.h>
+
+#include <set>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace {
+
+struct Tracked {
+  static inline int live = 0;
+
+  Tracked(int key_) : key(key_) { ++live; }
+  Tracked(const Tracked& other) : key(other.key) { ++live; }
+  ~Tracked() { --live; }
+
+  bool operator<(const Tracked& other) const { return key < other.key; }
+
+  int key;
+};
+
+struct Fragile {
+  static inline int live = 0;
+  static inline int copies_left = -1;
+
+  Fragile(int key_) : key(key_) { ++live; }
+  Fragile(const Fragile& other) : key(other.key) {
+    if (copies_left == 0) throw std::runtime_error("copy");
+    if (copies_left > 0) --copies_left;
+    ++live;
+  }
+  ~Fragile() { --live; }
+
+  bool operator<(const Fragile& other) const { return key < other.key; }
+
+  int key;
+};
+
+}  // namespace
+
+TEST(PersistentBSTTest, MatchesStdSet) {
+  PersistentBST<int> tree;
+  std::set<int> expected;
+
+  for (int i = 0; i < 5000; ++i) {
+    int key = i * 7919 % 3001;
+    ASSERT_EQ(tree.insert(key), expected.insert(key).second);
+  }
+  for (int i = 0; i < 5000; i += 3) {
+    ASSERT_EQ(tree.erase(i % 3001), expected.erase(i % 3001));
+  }
+
+  ASSERT_EQ(tree.size(), expected.size());
+  ASSERT_TRUE(std::equal(tree.begin<IteratorType::INORDER>(),
+                         tree.end<IteratorType::INORDER>(), expected.begin(),
+                         expected.end()));
+
+  for (int key = -1; key < 3003; ++key) {
+    ASSERT_EQ(tree.contains(key), expected.contains(key));
+
+    auto lower = tree.lower_bound(key);
+    auto reference = expected.lower_bound(key);
+    if (reference == expected.end()) {
+      ASSERT_EQ(lower, tree.end<IteratorType::INORDER>());
+    } else {
+      ASSERT_EQ(*lower, *reference);
+      if (++reference != expected.end()) {
+        ASSERT_EQ(*++lower, *reference);
+      }
+    }
+  }
+}
+
+TEST(PersistentBSTTest, SnapshotsAreUnaffectedByLaterUpdates) {
+  PersistentBST<int> tree;
+  for (int i = 0; i < 100; ++i) {
+    tree.insert(i);
+  }
+
+  PersistentBST<int> before = tree.snapshot();
+
+  for (int i = 0; i < 100; i += 2) {
+    tree.erase(i);
+  }
+  tree.insert(500);
+
+  PersistentBST<int> after = tree.snapshot();
+  tree.clear();
+
+  ASSERT_EQ(before.size(), 100);
+  ASSERT_TRUE(before.contains(0));
+  ASSERT_FALSE(before.contains(500));
+
+  ASSERT_EQ(after.size(), 51);
+  ASSERT_FALSE(after.contains(0));
+  ASSERT_TRUE(after.contains(1));
+  ASSERT_TRUE(after.contains(500));
+
+  ASSERT_TRUE(tree.empty());
+
+  int expected = 0;
+  before.for_each([&expected](int value) { ASSERT_EQ(value, expected++); });
+  ASSERT_EQ(expected, 100);
+}
+
+TEST(PersistentBSTTest, NodesAreReclaimedWithLastVersion) {
+  {
+    PersistentBST<Tracked> tree;
+    std::vector<PersistentBST<Tracked>> versions;
+
+    for (int i = 0; i < 200; ++i) {
+      tree.insert(Tracked(i * 37 % 200));
+      if (i % 10 == 0) versions.push_back(tree.snapshot());
+    }
+    for (int i = 0; i < 200; i += 3) {
+      tree.erase(Tracked(i));
+      if (i % 10 == 0) versions.push_back(tree.snapshot());
+    }
+
+    ASSERT_GT(Tracked::live, 0);
+
+    versions.erase(versions.begin(), versions.begin() + versions.size() / 2);
+    tree = versions.back();
+  }
+
+  ASSERT_EQ(Tracked::live, 0);
+}
+
+TEST(PersistentBSTTest, PersistFromBST) {
+  BST<std::string, std::allocator<Node<std::string>>, RedBlack, std::less<>>
+      tree;
+  tree.insert<IteratorType::INORDER>("b");
+  tree.insert<IteratorType::INORDER>("a");
+  tree.insert<IteratorType::INORDER>("c");
+
+  PersistentBST<std::string, std::less<>> persistent = tree.persist();
+  tree.clear();
+
+  ASSERT_EQ(persistent.size(), 3);
+  ASSERT_TRUE(persistent.contains(std::string_view("a")));
+  ASSERT_EQ(*persistent.find(std::string_view("c")), "c");
+  ASSERT_EQ(persistent.erase(std::string_view("b")), 1);
+  ASSERT_EQ(*++persistent.begin<IteratorType::INORDER>(), "c");
+}
+
+TEST(PersistentBSTTest, SortedBuildIsBalanced) {
+  std::vector<int> keys;
+  for (int i = 0; i < 1000; ++i) {
+    keys.push_back(i * 2);
+  }
+
+  PersistentBST<int> tree(sorted_unique, keys.begin(), keys.end());
+
+  ASSERT_EQ(tree.size(), 1000);
+  ASSERT_TRUE(std::equal(tree.begin<IteratorType::INORDER>(),
+                         tree.end<IteratorType::INORDER>(), keys.begin(),
+                         keys.end()));
+
+  ASSERT_TRUE(tree.insert(1001));
+  ASSERT_EQ(tree.erase(0), 1);
+  ASSERT_EQ(*tree.lower_bound(1000), 1000);
+  ASSERT_EQ(*++tree.lower_bound(1000), 1001);
+
+  PersistentBST<int> empty(sorted_unique, keys.end(), keys.end());
+  ASSERT_TRUE(empty.empty());
+}
+
+TEST(PersistentBSTTest, ThrowingCopyLeavesTreeIntact) {
+  {
+    PersistentBST<Fragile> tree;
+    for (int i = 0; i < 100; ++i) {
+      tree.insert(Fragile(i));
+    }
+
+    bool inserted = false;
+    for (int copies = 0; !inserted; ++copies) {
+      Fragile::copies_left = copies;
+      try {
+        inserted = tree.insert(Fragile(-1));
+      } catch (const std::runtime_error&) {
+        ASSERT_EQ(tree.size(), 100);
+        ASSERT_FALSE(tree.contains(Fragile(-1)));
+      }
+      Fragile::copies_left = -1;
+    }
+
+    bool erased = false;
+    for (int copies = 0; !erased; ++copies) {
+      Fragile::copies_left = copies;
+      try {
+        erased = tree.erase(Fragile(50)) == 1;
+      } catch (const std::runtime_error&) {
+        ASSERT_EQ(tree.size(), 101);
+        ASSERT_TRUE(tree.contains(Fragile(50)));
+      }
+      Fragile::copies_left = -1;
+    }
+
+    ASSERT_EQ(tree.size(), 100);
+    ASSERT_TRUE(tree.contains(Fragile(-1)));
+    ASSERT_FALSE(tree.contains(Fragile(50)));
+  }
+
+  ASSERT_EQ(Fragile::live, 0);
+}